@@ -114,17 +114,18 @@ int main()
     };
     auto* grass_shader = context->CreateShader(grass_shader_create_info);
 
-    constexpr Swift::BufferCreateInfo constant_create_info{
-        .size = k_constant_buffer_aligned_size * 3,
+    const uint32_t frames_in_flight = context->GetFramesInFlight();
+    const Swift::BufferCreateInfo constant_create_info{
+        .size = k_constant_buffer_aligned_size * frames_in_flight,
     };
     auto* const constant_buffer = context->CreateBuffer(constant_create_info);
 
-    constexpr Swift::BufferCreateInfo frustum_create_info{
-        .size = sizeof(Frustum) * 3,
+    const Swift::BufferCreateInfo frustum_create_info{
+        .size = static_cast<uint32_t>(sizeof(Frustum)) * frames_in_flight,
     };
     auto* frustum_buffer = context->CreateBuffer(frustum_create_info);
-    std::array<Swift::IBufferView*, 3> frustum_buffer_srvs;
-    for (uint32_t i = 0; i < 3; i++)
+    std::vector<Swift::IBufferView*> frustum_buffer_srvs(frames_in_flight);
+    for (uint32_t i = 0; i < frames_in_flight; i++)
     {
         frustum_buffer_srvs[i] = context->CreateBufferView(frustum_buffer,
                                                            {
@@ -6,6 +6,7 @@
 #include "glm/gtc/type_ptr.hpp"
 #include "glm/gtx/compatibility.hpp"
 #include "chrono"
+#include "format"
 #include "imgui.h"
 #include "imgui.hpp"
 #include "mesh_renderer.hpp"
@@ -28,6 +29,9 @@ struct ConstantBufferInfo
     glm::float3 padding;
 };
 static constexpr uint32_t k_constant_buffer_aligned_size = (sizeof(ConstantBufferInfo) + 255) & ~255;
+static constexpr uint32_t k_cull_constant_aligned_size = (sizeof(MeshletCullConstants) + 255) & ~255;
+// The command count and the meshlet count of every frame in flight, padded to 16 bytes.
+static constexpr uint32_t k_cull_counter_stride = 4;
 
 int main()
 {
@@ -46,13 +50,24 @@ int main()
                               .Build();
     auto* depth_stencil = context->CreateTextureView(depth_texture, {.type = Swift::TextureViewType::eDepthStencil});
 
+    constexpr ImportSettings import_settings{
+        .quantize_vertices = true,
+        .lod_count = 4,
+        .optimize_vertex_cache = true,
+        .optimize_overdraw = true,
+        .optimize_vertex_fetch = true,
+        .sort_meshlets = true,
+    };
+
     ShaderCompiler compiler{};
 
-    auto mesh_shader = compiler.CompileShader("hello_pbr.slang", ShaderStage::eMesh);
-    auto pixel_shader = compiler.CompileShader("hello_pbr.slang", ShaderStage::ePixel);
+    const auto meshlet_defines = GetMeshletShaderDefines(import_settings.meshlets);
+    auto mesh_shader = compiler.CompileShader("hello_pbr.slang", ShaderStage::eMesh, meshlet_defines);
+    auto pixel_shader = compiler.CompileShader("hello_pbr.slang", ShaderStage::ePixel, meshlet_defines);
+    auto cull_code = compiler.CompileShader("meshlet_cull.slang", ShaderStage::eCompute, meshlet_defines);
 
     Importer importer{};
-    auto helmet = importer.LoadModel("assets/damaged_helmet.glb");
+    auto helmet = importer.LoadModel("assets/damaged_helmet.glb", import_settings);
 
     std::vector<Swift::ISampler*> samplers;
     for (const auto& sampler : helmet.samplers)
@@ -77,13 +92,16 @@ int main()
                              .SetPolygonMode(Swift::PolygonMode::eTriangle)
                              .SetName("PBR Shader")
                              .Build();
+    auto* const cull_shader = Swift::ComputeShaderBuilder(context, cull_code).SetName("Meshlet Cull Shader").Build();
 
     const auto mesh_buffers = CreateMeshBuffers(context, helmet.meshes);
-    std::vector<MeshRenderer> mesh_renderers = CreateMeshRenderers(helmet.nodes, helmet.meshes, mesh_buffers);
+    std::vector<MeshRenderer> mesh_renderers =
+        CreateMeshRenderers(helmet.mesh_instances, helmet.meshes, mesh_buffers, import_settings.meshlets);
 
     const auto textures = CreateTextures(context, helmet.textures, helmet.materials);
 
-    auto* const constant_buffer = Swift::BufferBuilder(context, k_constant_buffer_aligned_size * 3).Build();
+    auto* const constant_buffer =
+        Swift::BufferBuilder(context, k_constant_buffer_aligned_size * context->GetFramesInFlight()).Build();
 
     auto* const material_buffer =
         Swift::BufferBuilder(context, sizeof(Material) * helmet.materials.size()).SetData(helmet.materials.data()).Build();
@@ -91,12 +109,106 @@ int main()
         context->CreateBufferView(material_buffer,
                                   Swift::BufferViewCreateInfo{.num_elements = static_cast<uint32_t>(helmet.materials.size()),
                                                               .element_size = sizeof(Material)});
-    auto* const transforms_buffer =
-        Swift::BufferBuilder(context, sizeof(glm::mat4) * helmet.transforms.size()).SetData(helmet.transforms.data()).Build();
-    auto* const transforms_buffer_srv =
-        context->CreateBufferView(transforms_buffer,
-                                  Swift::BufferViewCreateInfo{.num_elements = static_cast<uint32_t>(helmet.transforms.size()),
-                                                              .element_size = sizeof(glm::mat4)});
+    auto* const transforms_buffer = Swift::BufferBuilder(context, sizeof(glm::mat4) * helmet.instance_transforms.size())
+                                        .SetData(helmet.instance_transforms.data())
+                                        .Build();
+    auto* const transforms_buffer_srv = context->CreateBufferView(
+        transforms_buffer,
+        Swift::BufferViewCreateInfo{.num_elements = static_cast<uint32_t>(helmet.instance_transforms.size()),
+                                    .element_size = sizeof(glm::mat4)});
+
+    // GPU driven path: meshlet_cull.slang tests every instance and its meshlets and writes one draw per instance that has
+    // meshlets left, which a single ExecuteIndirect draws with the count it wrote.
+    const auto cull_instances = CreateMeshletCullInstances(mesh_renderers);
+    auto cull_meshes = CreateMeshletCullMeshes(mesh_renderers, samplers[0]->GetDescriptorIndex());
+    const auto cull_instance_count = static_cast<uint32_t>(cull_instances.size());
+    const uint32_t max_cull_commands = GetMaxMeshletCommands(cull_instances);
+    const uint32_t max_cull_meshlets = std::max(GetMaxMeshletListSize(cull_meshes, cull_instances), 1u);
+
+    auto* const meshlet_list_buffer = Swift::BufferBuilder(context, sizeof(uint32_t) * max_cull_meshlets)
+                                          .SetName("Meshlet List Buffer")
+                                          .Build();
+    auto* const meshlet_list_srv = context->CreateBufferView(
+        meshlet_list_buffer,
+        Swift::BufferViewCreateInfo{.num_elements = max_cull_meshlets, .element_size = sizeof(uint32_t)});
+    auto* const meshlet_list_uav = context->CreateBufferView(meshlet_list_buffer,
+                                                             Swift::BufferViewCreateInfo{
+                                                                 .type = Swift::BufferViewType::eUnorderedAccess,
+                                                                 .num_elements = max_cull_meshlets,
+                                                                 .element_size = sizeof(uint32_t),
+                                                             });
+    for (auto& cull_mesh : cull_meshes)
+    {
+        cull_mesh.constants.meshlet_list = meshlet_list_srv->GetDescriptorIndex();
+    }
+
+    auto* const cull_mesh_buffer = Swift::BufferBuilder(context, sizeof(MeshletCullMesh) * cull_meshes.size())
+                                       .SetData(cull_meshes.data())
+                                       .Build();
+    auto* const cull_mesh_buffer_srv = context->CreateBufferView(
+        cull_mesh_buffer,
+        Swift::BufferViewCreateInfo{.num_elements = static_cast<uint32_t>(cull_meshes.size()),
+                                    .element_size = sizeof(MeshletCullMesh)});
+    auto* const cull_instance_buffer = Swift::BufferBuilder(context, sizeof(MeshletCullInstance) * cull_instance_count)
+                                           .SetData(cull_instances.data())
+                                           .Build();
+    auto* const cull_instance_buffer_srv = context->CreateBufferView(
+        cull_instance_buffer,
+        Swift::BufferViewCreateInfo{.num_elements = cull_instance_count, .element_size = sizeof(MeshletCullInstance)});
+    auto* const cull_data_buffer = Swift::BufferBuilder(context, sizeof(CullData) * helmet.cull_datas.size())
+                                       .SetData(helmet.cull_datas.data())
+                                       .Build();
+    auto* const cull_data_buffer_srv =
+        context->CreateBufferView(cull_data_buffer,
+                                  Swift::BufferViewCreateInfo{.num_elements = static_cast<uint32_t>(helmet.cull_datas.size()),
+                                                              .element_size = sizeof(CullData)});
+    auto* const instance_cull_data_buffer =
+        Swift::BufferBuilder(context, sizeof(InstanceCullData) * helmet.instance_cull_datas.size())
+            .SetData(helmet.instance_cull_datas.data())
+            .Build();
+    auto* const instance_cull_data_buffer_srv = context->CreateBufferView(
+        instance_cull_data_buffer,
+        Swift::BufferViewCreateInfo{.num_elements = static_cast<uint32_t>(helmet.instance_cull_datas.size()),
+                                    .element_size = sizeof(InstanceCullData)});
+
+    const uint32_t cull_command_capacity = std::max(max_cull_commands, 1u);
+    auto* const cull_command_buffer = Swift::BufferBuilder(context, sizeof(MeshletDrawCommand) * cull_command_capacity)
+                                          .SetName("Meshlet Command Buffer")
+                                          .Build();
+    auto* const cull_command_buffer_uav = context->CreateBufferView(cull_command_buffer,
+                                                                    Swift::BufferViewCreateInfo{
+                                                                        .type = Swift::BufferViewType::eUnorderedAccess,
+                                                                        .num_elements = cull_command_capacity,
+                                                                        .element_size = sizeof(MeshletDrawCommand),
+                                                                    });
+    const uint32_t cull_counter_count = k_cull_counter_stride * context->GetFramesInFlight();
+    auto* const cull_counter_buffer = Swift::BufferBuilder(context, sizeof(uint32_t) * cull_counter_count)
+                                          .SetName("Meshlet Counter Buffer")
+                                          .Build();
+    auto* const cull_counter_buffer_uav = context->CreateBufferView(cull_counter_buffer,
+                                                                    Swift::BufferViewCreateInfo{
+                                                                        .type = Swift::BufferViewType::eUnorderedAccess,
+                                                                        .num_elements = cull_counter_count,
+                                                                        .element_size = sizeof(uint32_t),
+                                                                    });
+    auto* const cull_constant_buffer =
+        Swift::BufferBuilder(context, k_cull_constant_aligned_size * context->GetFramesInFlight()).Build();
+    auto* const meshlet_signature = Swift::CommandSignatureBuilder(context, sizeof(MeshletDrawCommand))
+                                        .AddPushConstants(sizeof(MeshletDrawConstants))
+                                        .AddMeshDispatch()
+                                        .Build();
+    bool gpu_driven = meshlet_signature != nullptr;
+    bool cull_frustum = true;
+    bool cull_cone = true;
+    bool compare_cull = false;
+    // What CullMeshlets reads to check the cull pass, the same data its buffers hold.
+    const MeshletCullInput cull_input{
+        .meshes = cull_meshes,
+        .instances = cull_instances,
+        .cull_datas = helmet.cull_datas,
+        .transforms = helmet.instance_transforms,
+        .instance_cull_datas = helmet.instance_cull_datas,
+    };
 
     auto* const point_light_buffer = Swift::BufferBuilder(context, sizeof(PointLight) * 100).Build();
     auto* const point_light_buffer_srv =
@@ -172,6 +284,59 @@ int main()
         const uint32_t frame_index = context->GetFrameIndex();
         command->BindConstantBuffer(constant_buffer, 1, k_constant_buffer_aligned_size * frame_index);
         window_size = window.GetSize();
+        const float projection_scale = GetLodProjectionScale(camera.m_fov, static_cast<float>(window_size.y));
+
+        const uint32_t counter_index = k_cull_counter_stride * frame_index;
+        EnumFlags<MeshletCullFlags> cull_flags = MeshletCullFlags::eNone;
+        if (cull_frustum) cull_flags |= MeshletCullFlags::eFrustum;
+        if (cull_cone) cull_flags |= MeshletCullFlags::eCone;
+        const MeshletCullView cull_view{
+            .view_proj = scene_buffer_data.view_proj,
+            .camera_position = camera.m_position,
+            .projection_scale = projection_scale,
+            .flags = cull_flags,
+        };
+        const bool cull_recorded = gpu_driven;
+        if (cull_recorded)
+        {
+            // The counters of this frame were last read by the ExecuteIndirect NewFrame waited for.
+            constexpr std::array<uint32_t, 2> zero_counters{};
+            cull_counter_buffer->Write(zero_counters.data(), sizeof(uint32_t) * counter_index, sizeof(zero_counters));
+
+            auto cull_constants = GetMeshletCullConstants(cull_view);
+            cull_constants.instance_count = cull_instance_count;
+            cull_constants.max_commands = max_cull_commands;
+            cull_constants.mesh_buffer = cull_mesh_buffer_srv->GetDescriptorIndex();
+            cull_constants.instance_buffer = cull_instance_buffer_srv->GetDescriptorIndex();
+            cull_constants.cull_data_buffer = cull_data_buffer_srv->GetDescriptorIndex();
+            cull_constants.transform_buffer = transforms_buffer_srv->GetDescriptorIndex();
+            cull_constants.instance_cull_data_buffer = instance_cull_data_buffer_srv->GetDescriptorIndex();
+            cull_constants.command_buffer = cull_command_buffer_uav->GetDescriptorIndex();
+            cull_constants.meshlet_list_buffer = meshlet_list_uav->GetDescriptorIndex();
+            cull_constants.max_meshlets = max_cull_meshlets;
+            cull_constants.counter_buffer = cull_counter_buffer_uav->GetDescriptorIndex();
+            cull_constants.counter_index = counter_index;
+            cull_constant_buffer->Write(&cull_constants,
+                                        k_cull_constant_aligned_size * frame_index,
+                                        sizeof(MeshletCullConstants));
+
+            const std::array<Swift::BufferTransition, 3> write_transitions{{
+                {.buffer = cull_command_buffer, .state = Swift::ResourceState::eUnorderedAccess},
+                {.buffer = cull_counter_buffer, .state = Swift::ResourceState::eUnorderedAccess},
+                {.buffer = meshlet_list_buffer, .state = Swift::ResourceState::eUnorderedAccess},
+            }};
+            command->TransitionResources({}, write_transitions);
+            command->BindShader(cull_shader);
+            command->BindConstantBuffer(cull_constant_buffer, 2, k_cull_constant_aligned_size * frame_index);
+            // Instances past 65535 groups continue in the next row, MAX_DISPATCH_GROUPS in the shader.
+            command->DispatchCompute(std::min(cull_instance_count, 65535u), (cull_instance_count + 65534) / 65535, 1);
+            const std::array<Swift::BufferTransition, 3> read_transitions{{
+                {.buffer = cull_command_buffer, .state = Swift::ResourceState::eIndirectArgument},
+                {.buffer = cull_counter_buffer, .state = Swift::ResourceState::eIndirectArgument},
+                {.buffer = meshlet_list_buffer, .state = Swift::ResourceState::eShaderResource},
+            }};
+            command->TransitionResources({}, read_transitions);
+        }
 
         render_graph.AddRenderPass("PBR Pass", shader)
             .WriteRenderTarget(render_target)
@@ -182,34 +347,51 @@ int main()
             .SetExecute(
                 [&](Swift::ICommand* cmd)
                 {
+                    if (gpu_driven)
+                    {
+                        cmd->ExecuteIndirect(meshlet_signature,
+                                             max_cull_commands,
+                                             cull_command_buffer,
+                                             0,
+                                             cull_counter_buffer,
+                                             sizeof(uint32_t) * counter_index);
+                        return;
+                    }
+
                     for (auto& mesh : mesh_renderers)
                     {
-                        const struct PushConstants
+                        // The instances share a dispatch, so they share the level the closest one needs.
+                        uint32_t lod = k_max_lod_count;
+                        for (uint32_t i = 0; i < mesh.m_instance_count; ++i)
                         {
-                            uint32_t sampler_index;
-                            uint32_t vertex_buffer;
-                            uint32_t meshlet_buffer;
-                            uint32_t mesh_vertex_buffer;
-                            uint32_t mesh_triangle_buffer;
-                            int material_index;
-                            uint32_t transform_index;
-                        } push_constants{
-                            .sampler_index = samplers[0]->GetDescriptorIndex(),
-                            .vertex_buffer = mesh.m_vertex_buffer,
-                            .meshlet_buffer = mesh.m_mesh_buffer,
-                            .mesh_vertex_buffer = mesh.m_mesh_vertex_buffer,
-                            .mesh_triangle_buffer = mesh.m_mesh_triangle_buffer,
-                            .material_index = mesh.m_material_index,
-                            .transform_index = mesh.m_transform_index,
-                        };
-                        cmd->PushConstants(&push_constants, sizeof(PushConstants));
-                        mesh.Draw(command);
+                            lod = std::min(lod,
+                                           SelectLod(mesh.GetLods(),
+                                                     mesh.m_center,
+                                                     mesh.m_radius,
+                                                     helmet.instance_transforms[mesh.m_instance_offset + i],
+                                                     camera.m_position,
+                                                     projection_scale));
+                        }
+                        const auto push_constants = mesh.GetDrawConstants(samplers[0]->GetDescriptorIndex(), lod);
+                        cmd->PushConstants(&push_constants, sizeof(MeshletDrawConstants));
+                        mesh.Draw(command, false, false, 0, lod);
                     }
                 });
 
         render_graph.Execute();
 
         imgui.BeginFrame();
+        ImGui::Begin("Culling");
+        ImGui::BeginDisabled(meshlet_signature == nullptr);
+        ImGui::Checkbox("GPU Driven", &gpu_driven);
+        ImGui::EndDisabled();
+        ImGui::Checkbox("Frustum", &cull_frustum);
+        ImGui::Checkbox("Backface Cones", &cull_cone);
+        ImGui::BeginDisabled(!cull_recorded);
+        compare_cull |= ImGui::Button("Compare With CPU");
+        ImGui::EndDisabled();
+        ImGui::End();
+
         ImGui::Begin("Lights");
         if (ImGui::Button("Add Point Light"))
         {
@@ -254,6 +436,38 @@ int main()
         command->End();
 
         context->Present(false);
+
+        if (compare_cull && cull_recorded)
+        {
+            // The buffers live in the GPU upload heap, once the frame is done they can be read in place.
+            compare_cull = false;
+            context->GetGraphicsQueue()->WaitIdle();
+            cull_counter_buffer->Map();
+            cull_command_buffer->Map();
+            meshlet_list_buffer->Map();
+            const auto* counters = static_cast<const uint32_t*>(cull_counter_buffer->GetMapped()) + counter_index;
+            const std::span gpu_commands(static_cast<const MeshletDrawCommand*>(cull_command_buffer->GetMapped()),
+                                         std::min(counters[0], max_cull_commands));
+            const std::span gpu_meshlets(static_cast<const uint32_t*>(meshlet_list_buffer->GetMapped()), max_cull_meshlets);
+
+            MeshletCullOutput expected;
+            CullMeshlets(cull_view, cull_input, expected);
+            const auto mismatches = GetMeshletCullMismatches(expected, gpu_commands, gpu_meshlets);
+            printf(std::format("Meshlet cull: {} commands on the GPU, {} commands and {} meshlets on the CPU, {} of {} "
+                               "instances differ\n",
+                               gpu_commands.size(),
+                               expected.commands.size(),
+                               expected.meshlet_list.size(),
+                               mismatches.size(),
+                               cull_instance_count)
+                       .c_str());
+            for (const uint32_t instance_index : mismatches)
+            {
+                printf(std::format("  instance {}\n", instance_index).c_str());
+            }
+            cull_command_buffer->Unmap();
+            meshlet_list_buffer->Unmap();
+        }
     }
 
     context->GetGraphicsQueue()->WaitIdle();
@@ -266,6 +480,27 @@ int main()
     context->DestroyBuffer(transforms_buffer);
     context->DestroyBufferView(transforms_buffer_srv);
     context->DestroyBuffer(constant_buffer);
+    context->DestroyBuffer(meshlet_list_buffer);
+    context->DestroyBufferView(meshlet_list_srv);
+    context->DestroyBufferView(meshlet_list_uav);
+    context->DestroyBuffer(cull_mesh_buffer);
+    context->DestroyBufferView(cull_mesh_buffer_srv);
+    context->DestroyBuffer(cull_instance_buffer);
+    context->DestroyBufferView(cull_instance_buffer_srv);
+    context->DestroyBuffer(cull_data_buffer);
+    context->DestroyBufferView(cull_data_buffer_srv);
+    context->DestroyBuffer(instance_cull_data_buffer);
+    context->DestroyBufferView(instance_cull_data_buffer_srv);
+    context->DestroyBuffer(cull_command_buffer);
+    context->DestroyBufferView(cull_command_buffer_uav);
+    context->DestroyBuffer(cull_counter_buffer);
+    context->DestroyBufferView(cull_counter_buffer_uav);
+    context->DestroyBuffer(cull_constant_buffer);
+    if (meshlet_signature)
+    {
+        context->DestroyCommandSignature(meshlet_signature);
+    }
+    context->DestroyShader(cull_shader);
     context->DestroyShader(shader);
     DestroyTextures(context, textures);
     DestroyMeshBuffers(context, mesh_buffers);
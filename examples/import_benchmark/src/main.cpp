@@ -0,0 +1,169 @@
+#include "importer.hpp"
+#include "algorithm"
+#include "array"
+#include "atomic"
+#include "chrono"
+#include "cstdlib"
+#include "format"
+#include "limits"
+#include "new"
+#include "string"
+
+namespace
+{
+    // Only the C++ heap is tracked, every operator new of the process goes through the replacements below and a small
+    // header in front of each block remembers its size so the live byte count can be tracked. stb_image and mikktspace
+    // call malloc directly, so decoded images and tangent generation scratch are not counted.
+    constexpr size_t k_allocation_header = alignof(std::max_align_t);
+    std::atomic<size_t> g_allocation_count = 0;
+    std::atomic<size_t> g_allocated_bytes = 0;
+    std::atomic<size_t> g_live_bytes = 0;
+    std::atomic<size_t> g_peak_bytes = 0;
+
+    void* TrackedAllocate(const size_t size)
+    {
+        auto* const block = static_cast<char*>(std::malloc(size + k_allocation_header));
+        if (!block)
+        {
+            throw std::bad_alloc();
+        }
+        *reinterpret_cast<size_t*>(block) = size;
+        g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+        g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+        const size_t live = g_live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+        size_t peak = g_peak_bytes.load(std::memory_order_relaxed);
+        while (live > peak && !g_peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+        return block + k_allocation_header;
+    }
+
+    void TrackedFree(void* const pointer)
+    {
+        if (!pointer)
+        {
+            return;
+        }
+        auto* const block = static_cast<char*>(pointer) - k_allocation_header;
+        g_live_bytes.fetch_sub(*reinterpret_cast<size_t*>(block), std::memory_order_relaxed);
+        std::free(block);
+    }
+
+    struct MemoryReport
+    {
+        size_t allocation_count;
+        size_t allocated_bytes;
+        // Highest C++ heap usage above what was live before the import, the returned model included.
+        size_t peak_bytes;
+    };
+
+    MemoryReport MeasureImport(const std::string_view path, const ImportSettings& settings)
+    {
+        Importer importer;
+        const size_t start_count = g_allocation_count.load();
+        const size_t start_bytes = g_allocated_bytes.load();
+        const size_t start_live = g_live_bytes.load();
+        g_peak_bytes = start_live;
+        const auto model = importer.LoadModel(path, settings);
+        return MemoryReport{
+            .allocation_count = g_allocation_count.load() - start_count,
+            .allocated_bytes = g_allocated_bytes.load() - start_bytes,
+            .peak_bytes = g_peak_bytes.load() - start_live,
+        };
+    }
+
+    struct BenchmarkCase
+    {
+        const char* name;
+        ImportSettings settings;
+    };
+
+    // Fastest and mean time of a number of imports in milliseconds.
+    std::pair<double, double> TimeImport(const std::string_view path, const ImportSettings& settings, const int iterations)
+    {
+        double best = std::numeric_limits<double>::max();
+        double total = 0.0;
+        for (int i = 0; i < iterations; ++i)
+        {
+            Importer importer;
+            const auto start = std::chrono::steady_clock::now();
+            const auto model = importer.LoadModel(path, settings);
+            const auto end = std::chrono::steady_clock::now();
+            const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            best = std::min(best, ms);
+            total += ms;
+        }
+        return {best, total / iterations};
+    }
+} // namespace
+
+void* operator new(const size_t size) { return TrackedAllocate(size); }
+void* operator new[](const size_t size) { return TrackedAllocate(size); }
+void operator delete(void* pointer) noexcept { TrackedFree(pointer); }
+void operator delete[](void* pointer) noexcept { TrackedFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept { TrackedFree(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { TrackedFree(pointer); }
+
+// Imports the bundled assets serially and in parallel, with and without the texture baking, and from the scene cache,
+// and prints the timings with the C++ heap allocation count, bytes allocated and peak usage of one import. The vertex
+// cache, overdraw and fetch statistics of every asset are printed before and after the mesh optimizations.
+// The optional argument is the number of imports per measurement.
+int main(const int argc, char** argv)
+{
+    const int iterations = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 3;
+    constexpr std::array assets = {"assets/cathedral.glb", "assets/chess.glb", "assets/damaged_helmet.glb"};
+    constexpr ImportSettings geometry = {.generate_mips = false, .compress_textures = false, .use_scene_cache = false};
+    ImportSettings geometry_serial = geometry;
+    geometry_serial.thread_count = 1;
+    ImportSettings geometry_optimized = geometry;
+    geometry_optimized.optimize_vertex_cache = true;
+    geometry_optimized.optimize_overdraw = true;
+    geometry_optimized.optimize_vertex_fetch = true;
+    geometry_optimized.sort_meshlets = true;
+    const std::array<BenchmarkCase, 7> cases = {
+        BenchmarkCase{"geometry serial", geometry_serial},
+        BenchmarkCase{"geometry parallel", geometry},
+        BenchmarkCase{"geometry optimized", geometry_optimized},
+        BenchmarkCase{"full serial", {.thread_count = 1, .use_scene_cache = false}},
+        BenchmarkCase{"full parallel", {.use_scene_cache = false}},
+        BenchmarkCase{"full streaming", {.use_scene_cache = false, .streaming = true}},
+        // Timed after one import has written the cache.
+        BenchmarkCase{"full cached", {}},
+    };
+
+    for (const auto* asset : assets)
+    {
+        printf(std::format("{}\n", asset).c_str());
+        double serial_mean = 0.0;
+        for (const auto& [name, settings] : cases)
+        {
+            if (settings.use_scene_cache)
+            {
+                Importer().LoadModel(asset, settings);
+            }
+            const auto [best, mean] = TimeImport(asset, settings, iterations);
+            const bool is_serial = settings.thread_count == 1;
+            if (is_serial)
+            {
+                serial_mean = mean;
+            }
+            const double speedup = is_serial ? 1.0 : serial_mean / mean;
+            const auto [allocation_count, allocated_bytes, peak_bytes] = MeasureImport(asset, settings);
+            printf(std::format("  {:<18} best {:>9.2f} ms  mean {:>9.2f} ms  {:>5.2f}x  {:>9} C++ allocations "
+                               "{:>9.1f} MB allocated {:>8.1f} MB peak\n",
+                               name,
+                               best,
+                               mean,
+                               speedup,
+                               allocation_count,
+                               static_cast<double>(allocated_bytes) / (1024.0 * 1024.0),
+                               static_cast<double>(peak_bytes) / (1024.0 * 1024.0))
+                       .c_str());
+        }
+
+        ImportSettings report_settings = geometry_optimized;
+        report_settings.report_mesh_optimization = true;
+        Importer().LoadModel(asset, report_settings);
+    }
+    return 0;
+}
@@ -66,6 +66,7 @@ void ImguiBackend::Render(Swift::ICommand* command)
 {
     ImGui::Render();
     ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), static_cast<ID3D12GraphicsCommandList*>(command->GetCommandList()));
+    command->InvalidateState();
 }
 
 void ImguiBackend::SetupStyle()
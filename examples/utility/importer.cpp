@@ -1,66 +1,592 @@
 #include "importer.hpp"
+#include "mapped_file.hpp"
+#include "meshlet_statistics.hpp"
+#include "parallel.hpp"
+#include "scene_cache.hpp"
+#include "texture_loader.hpp"
 #include "format"
 #include "mikktspace.h"
 #include "span"
 #include "algorithm"
-#define STB_IMAGE_IMPLEMENTATION
+#include "array"
+#include "cstring"
+#include "filesystem"
+#include "functional"
+#include "limits"
+#include "numeric"
 #include "tiny_gltf.h"
+#include "json.hpp"
+#include "stb_image.h"
 #include "glm/gtc/quaternion.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
-Model Importer::LoadModel(const std::string_view path)
+namespace
+{
+    constexpr uint32_t k_glb_magic = 0x46546C67;
+    constexpr uint32_t k_glb_json_chunk = 0x4E4F534A;
+    constexpr uint32_t k_glb_bin_chunk = 0x004E4942;
+
+    struct StreamedBinary
+    {
+        // The BIN chunk inside the mapping, it stands in for the buffer tinygltf would have copied it into.
+        std::span<const uint8_t> bin;
+        int bin_buffer = -1;
+        // Per image, the buffer view holding its encoded bytes or -1 when it is stored elsewhere.
+        std::vector<int> image_buffer_views;
+    };
+
+    // tinygltf copies the whole BIN chunk into a buffer and every embedded image into a vector of its own. The JSON is
+    // rewritten so it only sees a 4 byte BIN chunk and images without buffer views, everything is then read straight
+    // from the mapping instead.
+    bool LoadStreamedBinary(tinygltf::TinyGLTF& loader,
+                            const std::span<const uint8_t> file,
+                            const std::string& base_dir,
+                            tinygltf::Model& model,
+                            StreamedBinary& streamed,
+                            std::string& error,
+                            std::string& warn)
+    {
+        // Magic, version, length, then the JSON chunk length and type.
+        std::array<uint32_t, 5> header{};
+        if (file.size() < sizeof(header))
+        {
+            error = "File is too small to be a GLB";
+            return false;
+        }
+        std::memcpy(header.data(), file.data(), sizeof(header));
+        if (header[0] != k_glb_magic || header[4] != k_glb_json_chunk || header[3] > file.size() - sizeof(header))
+        {
+            error = "Invalid GLB header";
+            return false;
+        }
+
+        const auto json_chunk = file.subspan(sizeof(header), header[3]);
+        const size_t bin_header_offset = sizeof(header) + json_chunk.size();
+        std::array<uint32_t, 2> bin_header{};
+        if (bin_header_offset + sizeof(bin_header) <= file.size())
+        {
+            std::memcpy(bin_header.data(), file.data() + bin_header_offset, sizeof(bin_header));
+        }
+        if (bin_header[1] == k_glb_bin_chunk && bin_header[0] <= file.size() - bin_header_offset - sizeof(bin_header))
+        {
+            streamed.bin = file.subspan(bin_header_offset + sizeof(bin_header), bin_header[0]);
+        }
+
+        auto json = nlohmann::json::parse(json_chunk.begin(), json_chunk.end(), nullptr, false);
+        if (json.is_discarded())
+        {
+            error = "Invalid GLB JSON chunk";
+            return false;
+        }
+
+        if (const auto buffers = json.find("buffers"); buffers != json.end() && buffers->is_array())
+        {
+            for (size_t i = 0; i < buffers->size(); ++i)
+            {
+                if (auto& buffer = (*buffers)[i]; !buffer.contains("uri"))
+                {
+                    streamed.bin_buffer = static_cast<int>(i);
+                    buffer["byteLength"] = 4;
+                }
+            }
+        }
+
+        // Only images inside the BIN chunk are redirected, anything else is still loaded by tinygltf.
+        const auto is_in_bin = [&](const int view)
+        {
+            const auto buffer_views = json.find("bufferViews");
+            if (buffer_views == json.end() || !buffer_views->is_array() || view < 0 ||
+                view >= static_cast<int>(buffer_views->size()))
+            {
+                return false;
+            }
+            return (*buffer_views)[view].value("buffer", -1) == streamed.bin_buffer;
+        };
+
+        if (const auto images = json.find("images"); images != json.end() && images->is_array())
+        {
+            streamed.image_buffer_views.assign(images->size(), -1);
+            for (size_t i = 0; i < images->size(); ++i)
+            {
+                auto& image = (*images)[i];
+                if (const auto view = image.find("bufferView");
+                    view != image.end() && view->is_number_integer() && is_in_bin(view->get<int>()))
+                {
+                    streamed.image_buffer_views[i] = view->get<int>();
+                    image.erase("bufferView");
+                    // tinygltf only warns when it cannot find an external image.
+                    image["uri"] = "swift-streamed-image";
+                }
+            }
+        }
+
+        std::string rewritten = json.dump();
+        rewritten.resize((rewritten.size() + 3) & ~size_t(3), ' ');
+        constexpr std::array<uint32_t, 3> placeholder_bin = {4, k_glb_bin_chunk, 0};
+        std::vector<uint8_t> glb(sizeof(header) + rewritten.size() + sizeof(placeholder_bin));
+        header = {k_glb_magic, 2, static_cast<uint32_t>(glb.size()), static_cast<uint32_t>(rewritten.size()), k_glb_json_chunk};
+        std::memcpy(glb.data(), header.data(), sizeof(header));
+        std::memcpy(glb.data() + sizeof(header), rewritten.data(), rewritten.size());
+        std::memcpy(glb.data() + sizeof(header) + rewritten.size(), placeholder_bin.data(), sizeof(placeholder_bin));
+        return loader.LoadBinaryFromMemory(&model, &error, &warn, glb.data(), static_cast<uint32_t>(glb.size()), base_dir);
+    }
+
+    void AddStatistics(MeshStatistics& total, const MeshStatistics& statistics)
+    {
+        total.triangle_count += statistics.triangle_count;
+        total.vertex_count += statistics.vertex_count;
+        total.vertices_transformed += statistics.vertices_transformed;
+        total.pixels_covered += statistics.pixels_covered;
+        total.pixels_shaded += statistics.pixels_shaded;
+        total.bytes_fetched += statistics.bytes_fetched;
+    }
+
+    void PrintStatistics(const std::string_view label, const MeshStatistics& statistics)
+    {
+        const auto ratio = [](const size_t numerator, const size_t denominator)
+        { return denominator != 0 ? static_cast<double>(numerator) / static_cast<double>(denominator) : 0.0; };
+        printf(std::format("{}: ACMR {:.3f}, ATVR {:.3f}, overdraw {:.3f}, overfetch {:.3f} ({} triangles, {} vertices)\n",
+                           label,
+                           ratio(statistics.vertices_transformed, statistics.triangle_count),
+                           ratio(statistics.vertices_transformed, statistics.vertex_count),
+                           ratio(statistics.pixels_shaded, statistics.pixels_covered),
+                           ratio(statistics.bytes_fetched, statistics.vertex_count * sizeof(Vertex)),
+                           statistics.triangle_count,
+                           statistics.vertex_count)
+                   .c_str());
+    }
+
+    // Appends meshlets built on their own, moving their offsets past what is already there.
+    void AppendMeshlets(std::vector<meshopt_Meshlet>& meshlets,
+                        std::vector<uint32_t>& meshlet_vertices,
+                        std::vector<uint8_t>& meshlet_triangles,
+                        std::span<meshopt_Meshlet> new_meshlets,
+                        std::span<const uint32_t> new_vertices,
+                        std::span<const uint8_t> new_triangles)
+    {
+        for (auto& meshlet : new_meshlets)
+        {
+            meshlet.vertex_offset += static_cast<uint32_t>(meshlet_vertices.size());
+            meshlet.triangle_offset += static_cast<uint32_t>(meshlet_triangles.size());
+        }
+        meshlets.insert(meshlets.end(), new_meshlets.begin(), new_meshlets.end());
+        meshlet_vertices.insert(meshlet_vertices.end(), new_vertices.begin(), new_vertices.end());
+        meshlet_triangles.insert(meshlet_triangles.end(), new_triangles.begin(), new_triangles.end());
+    }
+
+    std::vector<uint32_t> GetMeshletIndices(const meshopt_Meshlet& meshlet,
+                                            std::span<const uint32_t> meshlet_vertices,
+                                            std::span<const uint8_t> meshlet_triangles)
+    {
+        std::vector<uint32_t> indices(meshlet.triangle_count * 3);
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            indices[i] = meshlet_vertices[meshlet.vertex_offset + meshlet_triangles[meshlet.triangle_offset + i]];
+        }
+        return indices;
+    }
+
+    // Center of the bounding box and the distance to the farthest vertex, in xyz and w.
+    glm::vec4 ComputeSphere(std::span<const Vertex> vertices, std::span<const uint32_t> indices)
+    {
+        glm::vec3 min(std::numeric_limits<float>::max());
+        glm::vec3 max(-std::numeric_limits<float>::max());
+        for (const uint32_t index : indices)
+        {
+            min = glm::min(min, vertices[index].position);
+            max = glm::max(max, vertices[index].position);
+        }
+        const glm::vec3 center = indices.empty() ? glm::vec3(0.f) : (min + max) * 0.5f;
+        float radius = 0.f;
+        for (const uint32_t index : indices)
+        {
+            radius = std::max(radius, glm::distance(center, vertices[index].position));
+        }
+        return {center, radius};
+    }
+
+    // Grows the first sphere until it encloses every other one.
+    glm::vec4 MergeSpheres(std::span<const glm::vec4> spheres)
+    {
+        glm::vec4 merged = spheres[0];
+        for (const auto& sphere : spheres.subspan(1))
+        {
+            const glm::vec3 offset = glm::vec3(sphere) - glm::vec3(merged);
+            const float distance = glm::length(offset);
+            if (distance + sphere.w <= merged.w)
+            {
+                continue;
+            }
+            if (distance + merged.w <= sphere.w)
+            {
+                merged = sphere;
+                continue;
+            }
+            const float radius = (distance + merged.w + sphere.w) * 0.5f;
+            merged = glm::vec4(glm::vec3(merged) + offset * ((radius - merged.w) / distance), radius);
+        }
+        return merged;
+    }
+}  // namespace
+
+Model Importer::LoadModel(const std::string_view path, const ImportSettings& settings)
 {
     tinygltf::Model model;
     std::string warn, error;
     const std::string filepath(path);
+
+    // Streaming needs the mapping for the whole import, the cache only to hash the source.
+    const bool is_binary = path.ends_with(".glb");
+    MappedFile source;
+    if (settings.use_scene_cache || (settings.streaming && is_binary))
+    {
+        source = MappedFile(path);
+    }
+
+    // The cache is keyed on the source bytes and settings, a hit skips parsing, decoding and meshlet building entirely.
+    const std::string cache_path = filepath + ".swiftcache";
+    uint64_t source_hash = 0;
+    const bool use_scene_cache = settings.use_scene_cache && source.IsOpen();
+    if (use_scene_cache)
+    {
+        source_hash = HashSceneSource(source.GetData(), path, settings);
+        if (auto cached = ReadSceneCache(cache_path, source_hash))
+        {
+            return std::move(*cached);
+        }
+        source.Evict(source.GetData());
+    }
+
+    const bool streaming = settings.streaming && is_binary && source.IsOpen();
+    if (!streaming)
+    {
+        source.Close();
+    }
+
+    m_loader.SetImageLoader(&LoadImageData, nullptr);
+    bool loaded = false;
+    StreamedBinary streamed;
     if (path.ends_with(".gltf"))
     {
-        if (const auto result = m_loader.LoadASCIIFromFile(&model, &error, &warn, filepath); !result)
+        loaded = m_loader.LoadASCIIFromFile(&model, &error, &warn, filepath);
+        if (!loaded)
         {
             printf(std::format(" Error: {} ", error, " Warn: {}", warn).c_str());
         }
     }
 
-    if (path.ends_with(".glb"))
+    if (is_binary)
     {
-        if (const auto result = m_loader.LoadBinaryFromFile(&model, &error, &warn, filepath); !result)
+        if (streaming)
+        {
+            const auto base_dir = std::filesystem::path(filepath).parent_path().string();
+            loaded = LoadStreamedBinary(m_loader, source.GetData(), base_dir, model, streamed, error, warn);
+        }
+        else
+        {
+            loaded = m_loader.LoadBinaryFromFile(&model, &error, &warn, filepath);
+        }
+        if (!loaded)
         {
             printf(std::format(" Error: {} ", error, " Warn: {}", warn).c_str());
         }
     }
 
+    std::vector<std::span<const uint8_t>> buffers(model.buffers.size());
+    for (size_t i = 0; i < buffers.size(); ++i)
+    {
+        buffers[i] = static_cast<int>(i) == streamed.bin_buffer ? streamed.bin : std::span(model.buffers[i].data);
+    }
+
     Model m{};
-    for (auto& mesh : model.meshes)
+
+    // Every primitive is its own job. Results land in fixed slots so the output order matches the file no matter which
+    // thread finishes first, the biggest primitives are handed out first to keep the tail short.
+    struct PrimitiveJob
     {
-        auto meshes = LoadMesh(m, model, mesh);
-        m.meshes.insert(m.meshes.end(), meshes.begin(), meshes.end());
+        const tinygltf::Mesh* mesh;
+        const tinygltf::Primitive* primitive;
+        uint32_t output_index;
+        size_t index_count;
+    };
+    std::vector<PrimitiveJob> jobs;
+    for (const auto& mesh : model.meshes)
+    {
+        for (const auto& primitive : mesh.primitives)
+        {
+            const size_t index_count = primitive.indices != -1 ? model.accessors[primitive.indices].count : 0;
+            jobs.push_back({
+                .mesh = &mesh,
+                .primitive = &primitive,
+                .output_index = static_cast<uint32_t>(jobs.size()),
+                .index_count = index_count,
+            });
+        }
     }
+    std::ranges::stable_sort(jobs, std::greater{}, &PrimitiveJob::index_count);
+
+    m.meshes.resize(jobs.size());
+    std::vector<std::vector<CullData>> cull_datas(jobs.size());
+    std::vector<std::vector<ClusterLod>> cluster_lods(jobs.size());
+    std::vector<QuantizationReport> quantization_reports(settings.quantize_vertices ? jobs.size() : 0);
+    std::vector<MeshOptimizationReport> optimization_reports(settings.report_mesh_optimization ? jobs.size() : 0);
+    ParallelFor(
+        static_cast<uint32_t>(jobs.size()),
+        [&](const uint32_t i)
+        {
+            const auto& job = jobs[i];
+            auto& mesh = m.meshes[job.output_index];
+            mesh = LoadMesh(model,
+                            buffers,
+                            *job.mesh,
+                            *job.primitive,
+                            settings,
+                            cull_datas[job.output_index],
+                            cluster_lods[job.output_index],
+                            optimization_reports.empty() ? nullptr : &optimization_reports[job.output_index]);
 
-    for (auto& texture : model.textures)
+            if (settings.quantize_vertices)
+            {
+                auto& report = quantization_reports[job.output_index];
+                report = QuantizeVertices(mesh);
+                // The bounds were computed from the exact positions, they have to cover the decoded ones too.
+                for (auto& cull_data : cull_datas[job.output_index])
+                {
+                    cull_data.radius += report.max_position_error;
+                }
+                mesh.radius += report.max_position_error;
+                // Growing a cluster and its parent by the same amount keeps the parent enclosing it.
+                for (auto& cluster_lod : cluster_lods[job.output_index])
+                {
+                    cluster_lod.radius += report.max_position_error;
+                    cluster_lod.parent_radius += report.max_position_error;
+                }
+            }
+
+            // The primitive's vertices and indices have been copied out, its pages can leave the working set.
+            if (streaming)
+            {
+                for (const auto& [name, accessor] : job.primitive->attributes)
+                {
+                    source.Evict(GetAccessorData(model, buffers, accessor));
+                }
+                source.Evict(GetAccessorData(model, buffers, job.primitive->indices));
+            }
+        },
+        settings.thread_count);
+
+    if (settings.report_mesh_optimization)
+    {
+        MeshOptimizationReport total{};
+        for (const auto& [before, after] : optimization_reports)
+        {
+            AddStatistics(total.before, before);
+            AddStatistics(total.after, after);
+        }
+        PrintStatistics(std::format("{} before", filepath), total.before);
+        PrintStatistics(std::format("{} after", filepath), total.after);
+    }
+
+    for (size_t i = 0; settings.report_quantization && i < quantization_reports.size(); ++i)
+    {
+        const auto& report = quantization_reports[i];
+        printf(std::format("{}: position error {:.3g}, normal {:.3f} deg, tangent {:.3f} deg, uv {:.3g}\n",
+                           m.meshes[i].name,
+                           report.max_position_error,
+                           report.max_normal_error,
+                           report.max_tangent_error,
+                           report.max_uv_error)
+                   .c_str());
+    }
+
+    size_t cull_data_count = 0;
+    for (const auto& mesh_cull_datas : cull_datas)
+    {
+        cull_data_count += mesh_cull_datas.size();
+    }
+    m.cull_datas.reserve(cull_data_count);
+    for (const auto& mesh_cull_datas : cull_datas)
+    {
+        m.cull_datas.insert(m.cull_datas.end(), mesh_cull_datas.begin(), mesh_cull_datas.end());
+    }
+    for (const auto& mesh_cluster_lods : cluster_lods)
+    {
+        m.cluster_lods.insert(m.cluster_lods.end(), mesh_cluster_lods.begin(), mesh_cluster_lods.end());
+    }
+
+    if (settings.report_meshlets)
+    {
+        const auto statistics = GetMeshletStatistics(m, settings.meshlets);
+        printf(std::format("{}: {} meshlets, vertex fill {:.3f}, triangle fill {:.3f}, bounds tightness {:.3f}, "
+                           "cone cullable {:.3f}, cone cull rate {:.3f}\n",
+                           filepath,
+                           statistics.meshlet_count,
+                           statistics.vertex_fill,
+                           statistics.triangle_fill,
+                           statistics.bounds_tightness,
+                           statistics.cone_cullable,
+                           statistics.cone_cull_rate)
+                   .c_str());
+    }
+
+    // Vertex and index data has been copied out and the encoded images were copied by LoadImageData or live in the
+    // mapping, so the buffers can go before the images are decoded.
+    std::vector<tinygltf::Buffer>().swap(model.buffers);
+    const std::span<const uint8_t> bin = streamed.bin;
+    buffers.clear();
+
+    // Images were kept encoded by LoadImageData and are decoded once each, decoding them is the other half of the
+    // import time. The image of a texture extension is tried first, the core source it may ship as a fallback is only
+    // decoded when it fails. Textures sharing an image copy it, the last one takes it.
+    const auto is_image = [&model](const int image) { return image >= 0 && image < static_cast<int>(model.images.size()); };
+    std::vector<std::optional<Texture>> images(model.images.size());
+    std::vector<uint8_t> decoded(model.images.size());
+    const auto decode_images = [&](const std::vector<uint8_t>& wanted)
+    {
+        ParallelFor(
+            static_cast<uint32_t>(model.images.size()),
+            [&](const uint32_t i)
+            {
+                if (!wanted[i] || decoded[i])
+                {
+                    return;
+                }
+                decoded[i] = true;
+
+                auto& image = model.images[i];
+                const std::string name = !image.name.empty() ? image.name : std::format("image {}", i);
+                if (const int view = i < streamed.image_buffer_views.size() ? streamed.image_buffer_views[i] : -1;
+                    view >= 0 && view < static_cast<int>(model.bufferViews.size()))
+                {
+                    const auto& buffer_view = model.bufferViews[view];
+                    std::span<const uint8_t> encoded;
+                    if (buffer_view.byteOffset + buffer_view.byteLength <= bin.size())
+                    {
+                        encoded = bin.subspan(buffer_view.byteOffset, buffer_view.byteLength);
+                    }
+                    images[i] = DecodeImage(encoded, name);
+                    source.Evict(encoded);
+                }
+                else
+                {
+                    // The encoded bytes are released as soon as they are decoded to keep the peak down.
+                    const auto encoded = std::move(image.image);
+                    images[i] = DecodeImage(encoded, name);
+                }
+            },
+            settings.thread_count);
+    };
+
+    std::vector<std::array<int, 2>> texture_sources;
+    texture_sources.reserve(model.textures.size());
+    std::vector<uint8_t> wanted(model.images.size());
+    for (const auto& texture : model.textures)
+    {
+        const auto& sources = texture_sources.emplace_back(GetImageSources(texture));
+        if (is_image(sources[0]))
+        {
+            wanted[sources[0]] = true;
+        }
+    }
+    decode_images(wanted);
+
+    std::ranges::fill(wanted, 0);
+    for (const auto& [preferred, fallback] : texture_sources)
+    {
+        if ((!is_image(preferred) || !images[preferred]) && is_image(fallback))
+        {
+            wanted[fallback] = true;
+        }
+    }
+    decode_images(wanted);
+
+    std::vector<int> texture_images(model.textures.size(), -1);
+    std::vector<uint32_t> image_users(model.images.size());
+    for (size_t i = 0; i < model.textures.size(); ++i)
+    {
+        for (const int image : texture_sources[i])
+        {
+            if (is_image(image) && images[image])
+            {
+                texture_images[i] = image;
+                ++image_users[image];
+                break;
+            }
+        }
+    }
+
+    m.textures.reserve(model.textures.size());
+    for (size_t i = 0; i < model.textures.size(); ++i)
+    {
+        m.textures.emplace_back(LoadTexture(model.textures[i], texture_images[i], images, image_users));
+    }
+
+    m.materials.reserve(model.materials.size());
+    for (const auto& material : model.materials)
+    {
+        m.materials.emplace_back(LoadMaterial(material));
+    }
+
+    m.samplers.reserve(model.samplers.size());
+    for (const auto& sampler : model.samplers)
     {
-        auto tex = LoadTexture(model, texture);
-        m.textures.emplace_back(tex);
+        m.samplers.emplace_back(LoadSampler(sampler));
     }
 
-    for (auto& material : model.materials)
+    if (settings.generate_mips)
     {
-        auto mat = LoadMaterial(material);
-        m.materials.emplace_back(mat);
+        const auto mip_infos = GetMipGenerationInfos(m, settings.mip_filter);
+        GenerateMipChains(m.textures, mip_infos, settings.thread_count);
     }
 
-    for (auto& sampler : model.samplers)
+    if (settings.compress_textures)
     {
-        auto samp = LoadSampler(sampler);
-        m.samplers.emplace_back(samp);
+        const auto formats = GetCompressionFormats(m);
+        const auto reports = CompressTextures(m.textures, formats, settings.compression_quality, settings.thread_count);
+        for (size_t i = 0; settings.report_compression && i < reports.size(); ++i)
+        {
+            const auto format = static_cast<uint32_t>(reports[i].format);
+            printf(std::format("{}: format {} PSNR {:.2f} dB\n", m.textures[i].name, format, reports[i].psnr).c_str());
+        }
     }
 
     std::tie(m.nodes, m.transforms) = LoadNodes(model);
+    BuildInstances(m);
+
+    if (use_scene_cache && loaded)
+    {
+        WriteSceneCache(cache_path, m, source_hash);
+    }
 
     return m;
 }
 
+std::span<const uint8_t> Importer::GetAccessorData(const tinygltf::Model& model,
+                                                   const std::span<const std::span<const uint8_t>> buffers,
+                                                   const int accessor_index)
+{
+    if (accessor_index < 0 || accessor_index >= static_cast<int>(model.accessors.size()))
+    {
+        return {};
+    }
+    const auto& accessor = model.accessors[accessor_index];
+    if (accessor.bufferView < 0 || accessor.bufferView >= static_cast<int>(model.bufferViews.size()))
+    {
+        return {};
+    }
+    const auto& bufferView = model.bufferViews[accessor.bufferView];
+    const auto& buffer = buffers[bufferView.buffer];
+    const size_t offset = bufferView.byteOffset + accessor.byteOffset;
+    if (bufferView.byteOffset + bufferView.byteLength > buffer.size() || offset > bufferView.byteOffset + bufferView.byteLength)
+    {
+        return {};
+    }
+    return buffer.subspan(offset, bufferView.byteOffset + bufferView.byteLength - offset);
+}
+
 const float* Importer::GetAttributeData(const std::string& name,
                                         const tinygltf::Model& model,
+                                        const std::span<const std::span<const uint8_t>> buffers,
                                         const tinygltf::Primitive& primitive,
                                         uint32_t& numAttributes)
 {
@@ -70,48 +596,66 @@ const float* Importer::GetAttributeData(const std::string& name,
     }
     const auto attribute = primitive.attributes.at(name);
     const auto& accessor = model.accessors[attribute];
-    const auto& bufferView = model.bufferViews[accessor.bufferView];
-    const auto& buffer = model.buffers[bufferView.buffer];
     numAttributes = uint32_t(accessor.count);
-    return reinterpret_cast<const float*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
+    return reinterpret_cast<const float*>(GetAccessorData(model, buffers, attribute).data());
 }
 
 std::vector<Vertex> Importer::LoadVertices(const tinygltf::Model& model,
+                                           const std::span<const std::span<const uint8_t>> buffers,
                                            const tinygltf::Primitive& primitive,
-                                           std::vector<uint32_t>& indices)
+                                           const std::span<const uint32_t> indices)
 {
     std::vector<Vertex> vertices;
     uint32_t num_pos = 0;
     uint32_t num_waste = 0;
-    const float* const positions = GetAttributeData("POSITION", model, primitive, num_pos);
-    const float* const normals = GetAttributeData("NORMAL", model, primitive, num_waste);
-    const float* const tex_coords = GetAttributeData("TEXCOORD_0", model, primitive, num_waste);
+    const float* const positions = GetAttributeData("POSITION", model, buffers, primitive, num_pos);
+    const float* const normals = GetAttributeData("NORMAL", model, buffers, primitive, num_waste);
+    const float* const tex_coords = GetAttributeData("TEXCOORD_0", model, buffers, primitive, num_waste);
+    const float* tangents = GetAttributeData("TANGENT", model, buffers, primitive, num_waste);
+
+    // Authored tangents are used as they are, MikkTSpace only runs for primitives without them and reads the
+    // attributes straight from the accessors.
+    std::vector<glm::vec4> generated_tangents;
+    if (!tangents && normals && tex_coords && num_pos != 0)
+    {
+        generated_tangents.resize(num_pos);
+        LoadTangents({positions, num_pos * 3}, {normals, num_pos * 3}, {tex_coords, num_pos * 2}, indices, generated_tangents);
+        tangents = glm::value_ptr(generated_tangents[0]);
+    }
+
     vertices.resize(num_pos);
     for (size_t i = 0; i < num_pos; ++i)
     {
         auto& [position, uv_x, normal, uv_y, tangent] = vertices[i];
 
         std::memcpy(glm::value_ptr(position), positions + i * 3, sizeof(float) * 3);
-        std::memcpy(glm::value_ptr(normal), normals + i * 3, sizeof(float) * 3);
+        normal = {0.f, 0.f, 0.f};
+        if (normals)
+        {
+            std::memcpy(glm::value_ptr(normal), normals + i * 3, sizeof(float) * 3);
+        }
 
-        uv_x = tex_coords[i * 2 + 0];
-        uv_y = tex_coords[i * 2 + 1];
+        uv_x = tex_coords ? tex_coords[i * 2 + 0] : 0.f;
+        uv_y = tex_coords ? tex_coords[i * 2 + 1] : 0.f;
 
         tangent = {0.f, 0.f, 0.f, 0.f};
+        if (tangents)
+        {
+            std::memcpy(glm::value_ptr(tangent), tangents + i * 4, sizeof(float) * 4);
+        }
     }
-    LoadTangents(vertices, indices);
 
     return vertices;
 }
 
-std::vector<uint32_t> Importer::LoadIndices(const tinygltf::Model& model, const tinygltf::Primitive& primitive)
+std::vector<uint32_t> Importer::LoadIndices(const tinygltf::Model& model,
+                                            const std::span<const std::span<const uint8_t>> buffers,
+                                            const tinygltf::Primitive& primitive)
 {
     std::vector<uint32_t> indices;
     const auto& accessor = model.accessors[primitive.indices];
-    const auto& bufferView = model.bufferViews[accessor.bufferView];
-    const auto& buffer = model.buffers[bufferView.buffer];
     indices.resize(accessor.count);
-    const uint8_t* indexRawData = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+    const uint8_t* indexRawData = GetAccessorData(model, buffers, primitive.indices).data();
     const uint8_t* byteIndices = nullptr;
     const uint16_t* shortIndices = nullptr;
     const uint32_t* intIndices = nullptr;
@@ -145,31 +689,374 @@ std::vector<uint32_t> Importer::LoadIndices(const tinygltf::Model& model, const
 
 std::tuple<std::vector<meshopt_Meshlet>, std::vector<uint32_t>, std::vector<uint8_t>> Importer::BuildMeshlets(
     const std::span<const Vertex> vertices,
-    const std::span<const uint32_t> indices)
+    const std::span<const uint32_t> indices,
+    const MeshletSettings& settings)
 {
-    std::vector<meshopt_Meshlet> meshlets;
-    std::vector<uint32_t> mesh_vertices;
-    std::vector<uint8_t> mesh_triangles;
-    const auto max_meshlets = meshopt_buildMeshletsBound(indices.size(), 64, 124);
-    meshlets.resize(max_meshlets);
-    mesh_vertices.resize(max_meshlets * 64);
-    mesh_triangles.resize(max_meshlets * 124 * 3);
-    const auto meshlet_count = meshopt_buildMeshlets(meshlets.data(),
-                                                     mesh_vertices.data(),
-                                                     mesh_triangles.data(),
+    const MeshletSettings limits = ClampMeshletSettings(settings);
+    // meshoptimizer needs room for the worst case, which is far above what a mesh ends up using. The worst case
+    // lives in per-thread scratch reused across primitives and only the used part is copied out.
+    thread_local std::vector<meshopt_Meshlet> scratch_meshlets;
+    thread_local std::vector<uint32_t> scratch_vertices;
+    thread_local std::vector<uint8_t> scratch_triangles;
+    // Spatial splits may leave meshlets down to a quarter full when that gives tighter bounds, the bound has to be
+    // taken for the smallest meshlet it may emit.
+    const bool spatial = limits.split == MeshletSplit::eSpatial;
+    const uint32_t min_triangles = spatial ? limits.max_triangles / 4 : limits.max_triangles;
+    const auto max_meshlets = meshopt_buildMeshletsBound(indices.size(), limits.max_vertices, min_triangles);
+    scratch_meshlets.resize(std::max(scratch_meshlets.size(), max_meshlets));
+    scratch_vertices.resize(std::max(scratch_vertices.size(), max_meshlets * limits.max_vertices));
+    scratch_triangles.resize(std::max(scratch_triangles.size(), max_meshlets * limits.max_triangles * 3));
+    size_t meshlet_count = 0;
+    if (spatial)
+    {
+        meshlet_count = meshopt_buildMeshletsSpatial(scratch_meshlets.data(),
+                                                     scratch_vertices.data(),
+                                                     scratch_triangles.data(),
                                                      indices.data(),
                                                      indices.size(),
                                                      reinterpret_cast<const float*>(vertices.data()),
                                                      vertices.size(),
                                                      sizeof(Vertex),
-                                                     64,
-                                                     124,
-                                                     0.f);
-    const auto& [vertex_offset, triangle_offset, vertex_count, triangle_count] = meshlets[meshlet_count - 1];
-    mesh_vertices.resize(vertex_offset + vertex_count);
-    mesh_triangles.resize(triangle_offset + (triangle_count * 3 + 3 & ~3));
-    meshlets.resize(meshlet_count);
-    return {meshlets, mesh_vertices, mesh_triangles};
+                                                     limits.max_vertices,
+                                                     min_triangles,
+                                                     limits.max_triangles,
+                                                     limits.fill_weight);
+    }
+    else
+    {
+        meshlet_count = meshopt_buildMeshlets(scratch_meshlets.data(),
+                                              scratch_vertices.data(),
+                                              scratch_triangles.data(),
+                                              indices.data(),
+                                              indices.size(),
+                                              reinterpret_cast<const float*>(vertices.data()),
+                                              vertices.size(),
+                                              sizeof(Vertex),
+                                              limits.max_vertices,
+                                              limits.max_triangles,
+                                              limits.cone_weight);
+    }
+    if (meshlet_count == 0)
+    {
+        return {};
+    }
+    const auto& [vertex_offset, triangle_offset, vertex_count, triangle_count] = scratch_meshlets[meshlet_count - 1];
+    const size_t vertex_end = vertex_offset + vertex_count;
+    const size_t triangle_end = triangle_offset + ((triangle_count * 3 + 3) & ~3u);
+    return {
+        std::vector(scratch_meshlets.begin(), scratch_meshlets.begin() + meshlet_count),
+        std::vector(scratch_vertices.begin(), scratch_vertices.begin() + vertex_end),
+        std::vector(scratch_triangles.begin(), scratch_triangles.begin() + triangle_end),
+    };
+}
+
+void Importer::OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const ImportSettings& settings)
+{
+    if (indices.empty() || vertices.empty())
+    {
+        return;
+    }
+
+    if (settings.optimize_vertex_cache)
+    {
+        meshopt_optimizeVertexCache(indices.data(), indices.data(), indices.size(), vertices.size());
+    }
+
+    if (settings.optimize_overdraw)
+    {
+        meshopt_optimizeOverdraw(indices.data(),
+                                 indices.data(),
+                                 indices.size(),
+                                 &vertices[0].position.x,
+                                 vertices.size(),
+                                 sizeof(Vertex),
+                                 settings.overdraw_threshold);
+    }
+
+    if (settings.optimize_vertex_fetch)
+    {
+        // Vertices no index refers to are dropped as well.
+        std::vector<Vertex> fetch_ordered(vertices.size());
+        const size_t vertex_count = meshopt_optimizeVertexFetch(fetch_ordered.data(),
+                                                                indices.data(),
+                                                                indices.size(),
+                                                                vertices.data(),
+                                                                vertices.size(),
+                                                                sizeof(Vertex));
+        fetch_ordered.resize(vertex_count);
+        vertices = std::move(fetch_ordered);
+    }
+}
+
+MeshStatistics Importer::AnalyzeMesh(const std::span<const Vertex> vertices, const std::span<const uint32_t> indices)
+{
+    if (indices.empty() || vertices.empty())
+    {
+        return {};
+    }
+
+    const auto cache = meshopt_analyzeVertexCache(indices.data(), indices.size(), vertices.size(), 16, 0, 0);
+    const auto overdraw = meshopt_analyzeOverdraw(indices.data(),
+                                                  indices.size(),
+                                                  &vertices[0].position.x,
+                                                  vertices.size(),
+                                                  sizeof(Vertex));
+    const auto fetch = meshopt_analyzeVertexFetch(indices.data(), indices.size(), vertices.size(), sizeof(Vertex));
+    return MeshStatistics{
+        .triangle_count = indices.size() / 3,
+        .vertex_count = vertices.size(),
+        .vertices_transformed = cache.vertices_transformed,
+        .pixels_covered = overdraw.pixels_covered,
+        .pixels_shaded = overdraw.pixels_shaded,
+        .bytes_fetched = fetch.bytes_fetched,
+    };
+}
+
+std::vector<MeshLod> Importer::BuildLods(const std::span<const Vertex> vertices,
+                                         std::vector<uint32_t> indices,
+                                         const ImportSettings& settings,
+                                         std::vector<meshopt_Meshlet>& meshlets,
+                                         std::vector<uint32_t>& meshlet_vertices,
+                                         std::vector<uint8_t>& meshlet_triangles)
+{
+    std::vector<MeshLod> lods = {{.meshlet_offset = 0, .meshlet_count = static_cast<uint32_t>(meshlets.size()), .error = 0.f}};
+    const uint32_t lod_count = std::min(settings.lod_count, k_max_lod_count);
+    if (lod_count <= 1 || vertices.empty() || indices.empty())
+    {
+        return lods;
+    }
+
+    // Every level is simplified from the one before it, which is much faster than starting over from the full mesh.
+    // Its error is then bounded by the sum of the errors along the way, which also keeps it growing with the level.
+    const float error_scale = meshopt_simplifyScale(&vertices[0].position.x, vertices.size(), sizeof(Vertex));
+    float error = 0.f;
+    std::vector<uint32_t> simplified;
+    while (lods.size() < lod_count)
+    {
+        const size_t target_index_count = static_cast<size_t>(indices.size() * settings.lod_reduction) / 3 * 3;
+        float level_error = 0.f;
+        simplified.resize(indices.size());
+        simplified.resize(meshopt_simplify(simplified.data(),
+                                           indices.data(),
+                                           indices.size(),
+                                           &vertices[0].position.x,
+                                           vertices.size(),
+                                           sizeof(Vertex),
+                                           target_index_count,
+                                           settings.lod_target_error,
+                                           0,
+                                           &level_error));
+        // A level that is barely smaller than the last one is not worth its memory, and the ones after it would not
+        // get any further either.
+        if (simplified.empty() || simplified.size() > indices.size() * 9 / 10)
+        {
+            break;
+        }
+        error += level_error * error_scale;
+
+        if (settings.optimize_vertex_cache)
+        {
+            meshopt_optimizeVertexCache(simplified.data(), simplified.data(), simplified.size(), vertices.size());
+        }
+        auto [lod_meshlets, lod_vertices, lod_triangles] = BuildMeshlets(vertices, simplified, settings.meshlets);
+        if (settings.sort_meshlets)
+        {
+            SortMeshlets(lod_meshlets, lod_vertices, lod_triangles, vertices);
+        }
+
+        lods.push_back({
+            .meshlet_offset = static_cast<uint32_t>(meshlets.size()),
+            .meshlet_count = static_cast<uint32_t>(lod_meshlets.size()),
+            .error = error,
+        });
+        AppendMeshlets(meshlets, meshlet_vertices, meshlet_triangles, lod_meshlets, lod_vertices, lod_triangles);
+        std::swap(indices, simplified);
+    }
+    return lods;
+}
+
+std::vector<ClusterLod> Importer::BuildClusterLod(const std::span<const Vertex> vertices,
+                                                  const MeshletSettings& settings,
+                                                  std::vector<meshopt_Meshlet>& meshlets,
+                                                  std::vector<uint32_t>& meshlet_vertices,
+                                                  std::vector<uint8_t>& meshlet_triangles)
+{
+    constexpr size_t k_group_size = 4;
+    constexpr float k_no_parent = std::numeric_limits<float>::infinity();
+
+    // Triangles of the clusters still waiting to be merged, as indices into vertices.
+    struct Cluster
+    {
+        std::vector<uint32_t> indices;
+        glm::vec4 sphere;
+        float error;
+    };
+    std::vector<Cluster> clusters;
+    std::vector<ClusterLod> cluster_lods;
+    const auto add_cluster = [&](std::vector<uint32_t> indices, const glm::vec4& sphere, const float error)
+    {
+        cluster_lods.push_back(ClusterLod{
+            .center = glm::vec3(sphere),
+            .radius = sphere.w,
+            .parent_center = glm::vec3(sphere),
+            .parent_radius = sphere.w,
+            .error = error,
+            .parent_error = k_no_parent,
+            .triangle_count = static_cast<uint32_t>(indices.size() / 3),
+            .padding = 0,
+        });
+        clusters.push_back({std::move(indices), sphere, error});
+    };
+
+    for (const auto& meshlet : meshlets)
+    {
+        auto indices = GetMeshletIndices(meshlet, meshlet_vertices, meshlet_triangles);
+        const glm::vec4 sphere = ComputeSphere(vertices, indices);
+        add_cluster(std::move(indices), sphere, 0.f);
+    }
+    if (vertices.empty())
+    {
+        return cluster_lods;
+    }
+
+    const float error_scale = meshopt_simplifyScale(&vertices[0].position.x, vertices.size(), sizeof(Vertex));
+    std::vector<uint32_t> pending(clusters.size());
+    std::iota(pending.begin(), pending.end(), 0u);
+    std::vector<uint32_t> merged;
+    std::vector<uint32_t> simplified;
+    std::vector<glm::vec4> spheres;
+    while (pending.size() > 1)
+    {
+        // Groups are runs along a space filling curve through the cluster centers, which keeps them compact without
+        // building the cluster adjacency.
+        std::vector<glm::vec3> centers(pending.size());
+        for (size_t i = 0; i < pending.size(); ++i)
+        {
+            centers[i] = glm::vec3(clusters[pending[i]].sphere);
+        }
+        std::vector<uint32_t> remap(pending.size());
+        meshopt_spatialSortRemap(remap.data(), &centers[0].x, centers.size(), sizeof(glm::vec3));
+        std::vector<uint32_t> sorted(pending.size());
+        for (size_t i = 0; i < pending.size(); ++i)
+        {
+            sorted[remap[i]] = pending[i];
+        }
+
+        std::vector<uint32_t> next;
+        for (size_t first = 0; first < sorted.size(); first += k_group_size)
+        {
+            const auto group = std::span(sorted).subspan(first, std::min(k_group_size, sorted.size() - first));
+            merged.clear();
+            spheres.clear();
+            float child_error = 0.f;
+            for (const uint32_t child : group)
+            {
+                merged.insert(merged.end(), clusters[child].indices.begin(), clusters[child].indices.end());
+                spheres.push_back(clusters[child].sphere);
+                child_error = std::max(child_error, clusters[child].error);
+            }
+
+            // The border of the group is shared with its neighbours, locking it is what lets neighbouring groups be
+            // drawn at different levels without cracks. The error is recorded rather than bounded.
+            float simplify_error = 0.f;
+            simplified.resize(merged.size());
+            simplified.resize(meshopt_simplify(simplified.data(),
+                                               merged.data(),
+                                               merged.size(),
+                                               &vertices[0].position.x,
+                                               vertices.size(),
+                                               sizeof(Vertex),
+                                               merged.size() / 2 / 3 * 3,
+                                               std::numeric_limits<float>::max(),
+                                               meshopt_SimplifyLockBorder,
+                                               &simplify_error));
+            for (const uint32_t child : group)
+            {
+                std::vector<uint32_t>().swap(clusters[child].indices);
+            }
+            // Groups that barely simplify keep their clusters as roots.
+            if (simplified.empty() || simplified.size() > merged.size() * 85 / 100)
+            {
+                continue;
+            }
+
+            // Parents enclose their children and carry at least their error, so the cut test is monotonic.
+            const glm::vec4 sphere = MergeSpheres(spheres);
+            const float error = child_error + simplify_error * error_scale;
+            for (const uint32_t child : group)
+            {
+                auto& child_lod = cluster_lods[child];
+                child_lod.parent_center = glm::vec3(sphere);
+                child_lod.parent_radius = sphere.w;
+                child_lod.parent_error = error;
+            }
+
+            auto [group_meshlets, group_vertices, group_triangles] = BuildMeshlets(vertices, simplified, settings);
+            for (const auto& meshlet : group_meshlets)
+            {
+                next.push_back(static_cast<uint32_t>(clusters.size()));
+                add_cluster(GetMeshletIndices(meshlet, group_vertices, group_triangles), sphere, error);
+            }
+            AppendMeshlets(meshlets, meshlet_vertices, meshlet_triangles, group_meshlets, group_vertices, group_triangles);
+        }
+        pending = std::move(next);
+    }
+    return cluster_lods;
+}
+
+void Importer::SortMeshlets(std::vector<meshopt_Meshlet>& meshlets,
+                            std::vector<uint32_t>& meshlet_vertices,
+                            std::vector<uint8_t>& meshlet_triangles,
+                            const std::span<const Vertex> vertices)
+{
+    if (meshlets.empty())
+    {
+        return;
+    }
+
+    std::vector<glm::vec3> centers(meshlets.size(), glm::vec3(0.f));
+    for (size_t i = 0; i < meshlets.size(); ++i)
+    {
+        const auto& meshlet = meshlets[i];
+        for (uint32_t v = 0; v < meshlet.vertex_count; ++v)
+        {
+            centers[i] += vertices[meshlet_vertices[meshlet.vertex_offset + v]].position;
+        }
+        centers[i] /= static_cast<float>(std::max(meshlet.vertex_count, 1u));
+    }
+
+    // The remap goes from the old meshlet index to the new one.
+    std::vector<uint32_t> remap(meshlets.size());
+    meshopt_spatialSortRemap(remap.data(), &centers[0].x, centers.size(), sizeof(glm::vec3));
+    std::vector<meshopt_Meshlet> sorted(meshlets.size());
+    for (size_t i = 0; i < meshlets.size(); ++i)
+    {
+        sorted[remap[i]] = meshlets[i];
+    }
+
+    // The vertex and triangle ranges are rewritten in the new order so neighbouring meshlets also read neighbouring
+    // memory, then each meshlet's own vertices and triangles are ordered for locality.
+    std::vector<uint32_t> sorted_vertices;
+    sorted_vertices.reserve(meshlet_vertices.size());
+    std::vector<uint8_t> sorted_triangles;
+    sorted_triangles.reserve(meshlet_triangles.size());
+    for (auto& meshlet : sorted)
+    {
+        const auto vertices_begin = meshlet_vertices.begin() + meshlet.vertex_offset;
+        const auto triangles_begin = meshlet_triangles.begin() + meshlet.triangle_offset;
+        meshlet.vertex_offset = static_cast<uint32_t>(sorted_vertices.size());
+        meshlet.triangle_offset = static_cast<uint32_t>(sorted_triangles.size());
+        sorted_vertices.insert(sorted_vertices.end(), vertices_begin, vertices_begin + meshlet.vertex_count);
+        sorted_triangles.insert(sorted_triangles.end(), triangles_begin, triangles_begin + meshlet.triangle_count * 3);
+        meshopt_optimizeMeshlet(&sorted_vertices[meshlet.vertex_offset],
+                                &sorted_triangles[meshlet.triangle_offset],
+                                meshlet.triangle_count,
+                                meshlet.vertex_count);
+    }
+
+    meshlets = std::move(sorted);
+    meshlet_vertices = std::move(sorted_vertices);
+    meshlet_triangles = std::move(sorted_triangles);
 }
 
 std::tuple<std::vector<Node>, std::vector<glm::mat4>> Importer::LoadNodes(const tinygltf::Model& model)
@@ -177,17 +1064,25 @@ std::tuple<std::vector<Node>, std::vector<glm::mat4>> Importer::LoadNodes(const
     std::vector<Node> nodes;
     std::vector<glm::mat4> transforms;
 
+    // Model::meshes holds the primitives of every glTF mesh one mesh after the other.
+    std::vector<uint32_t> first_primitives(model.meshes.size() + 1);
+    for (size_t i = 0; i < model.meshes.size(); ++i)
+    {
+        first_primitives[i + 1] = first_primitives[i] + static_cast<uint32_t>(model.meshes[i].primitives.size());
+    }
+
     for (const auto& node : model.scenes[0].nodes)
     {
-        LoadNode(model, node, glm::mat4(1.0f), nodes, transforms);
+        LoadNode(model, node, glm::mat4(1.0f), first_primitives, nodes, transforms);
     }
 
-    return {nodes, transforms};
+    return {std::move(nodes), std::move(transforms)};
 }
 
 void Importer::LoadNode(const tinygltf::Model& model,
                         const int node_index,
                         const glm::mat4& parent_transform,
+                        const std::span<const uint32_t> first_primitives,
                         std::vector<Node>& nodes,
                         std::vector<glm::mat4>& transforms)
 {
@@ -200,23 +1095,77 @@ void Importer::LoadNode(const tinygltf::Model& model,
 
     if (gltf_node.mesh != -1)
     {
-        nodes.push_back(Node{
-            .name = gltf_node.name,
-            .transform_index = transform_idx,
-            .mesh_index = gltf_node.mesh,
-        });
+        for (uint32_t i = first_primitives[gltf_node.mesh]; i < first_primitives[gltf_node.mesh + 1]; ++i)
+        {
+            nodes.push_back(Node{
+                .name = gltf_node.name,
+                .transform_index = transform_idx,
+                .mesh_index = static_cast<int>(i),
+            });
+        }
     }
 
     for (const int child : gltf_node.children)
     {
-        LoadNode(model, child, world_transform, nodes, transforms);
+        LoadNode(model, child, world_transform, first_primitives, nodes, transforms);
+    }
+}
+
+void Importer::BuildInstances(Model& model)
+{
+    std::vector<std::vector<uint32_t>> mesh_nodes(model.meshes.size());
+    std::vector<uint32_t> mesh_order;
+    for (uint32_t i = 0; i < model.nodes.size(); ++i)
+    {
+        const int mesh_index = model.nodes[i].mesh_index;
+        if (mesh_index < 0 || mesh_index >= static_cast<int>(model.meshes.size()))
+        {
+            continue;
+        }
+        if (mesh_nodes[mesh_index].empty())
+        {
+            mesh_order.push_back(static_cast<uint32_t>(mesh_index));
+        }
+        mesh_nodes[mesh_index].push_back(i);
+    }
+
+    model.mesh_instances.clear();
+    model.instance_transforms.clear();
+    model.instance_cull_datas.clear();
+    for (const uint32_t mesh_index : mesh_order)
+    {
+        const auto& mesh = model.meshes[mesh_index];
+        model.mesh_instances.push_back(MeshInstances{
+            .mesh_index = mesh_index,
+            .instance_offset = static_cast<uint32_t>(model.instance_transforms.size()),
+            .instance_count = static_cast<uint32_t>(mesh_nodes[mesh_index].size()),
+        });
+        for (const uint32_t node_index : mesh_nodes[mesh_index])
+        {
+            const glm::mat4& transform = model.transforms[model.nodes[node_index].transform_index];
+            const float scale = std::max({glm::length(glm::vec3(transform[0])),
+                                          glm::length(glm::vec3(transform[1])),
+                                          glm::length(glm::vec3(transform[2]))});
+            model.instance_transforms.push_back(transform);
+            model.instance_cull_datas.push_back(InstanceCullData{
+                .center = glm::vec3(transform * glm::vec4(mesh.center, 1.f)),
+                .radius = mesh.radius * scale,
+            });
+        }
     }
 }
 
 std::vector<uint32_t> Importer::RepackMeshlets(std::span<meshopt_Meshlet> meshlets,
                                                const std::span<const uint8_t> meshlet_triangles)
 {
+    size_t triangle_count = 0;
+    for (const auto& m : meshlets)
+    {
+        triangle_count += m.triangle_count;
+    }
+
     std::vector<uint32_t> repacked_meshlets;
+    repacked_meshlets.reserve(triangle_count);
     for (auto& m : meshlets)
     {
         const auto triangle_offset = static_cast<uint32_t>(repacked_meshlets.size());
@@ -236,76 +1185,226 @@ std::vector<uint32_t> Importer::RepackMeshlets(std::span<meshopt_Meshlet> meshle
     return repacked_meshlets;
 }
 
-void Importer::LoadTangents(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+void Importer::LoadTangents(const std::span<const float> positions,
+                            const std::span<const float> normals,
+                            const std::span<const float> tex_coords,
+                            const std::span<const uint32_t> indices,
+                            const std::span<glm::vec4> tangents)
 {
-    struct Pair
+    // Every callback is a lookup into flat attribute arrays, MikkTSpace calls them several times per corner.
+    struct Streams
     {
-        std::span<Vertex> vertices;
-        std::span<uint32_t> indices;
-    } pair{
-        .vertices = vertices,
-        .indices = indices,
+        const float* positions;
+        const float* normals;
+        const float* tex_coords;
+        const uint32_t* indices;
+        glm::vec4* tangents;
+        int face_count;
+    } streams{
+        .positions = positions.data(),
+        .normals = normals.data(),
+        .tex_coords = tex_coords.data(),
+        .indices = indices.data(),
+        .tangents = tangents.data(),
+        .face_count = static_cast<int>(indices.size() / 3),
     };
     SMikkTSpaceInterface space_interface{
         .m_getNumFaces = [](const SMikkTSpaceContext* ctx) -> int
-        { return static_cast<Pair*>(ctx->m_pUserData)->indices.size() / 3; },
+        { return static_cast<const Streams*>(ctx->m_pUserData)->face_count; },
         .m_getNumVerticesOfFace = [](const SMikkTSpaceContext*, int) -> int { return 3; },
         .m_getPosition =
-            [](const SMikkTSpaceContext* ctx, float out[], int faceIdx, int vertIdx)
+            [](const SMikkTSpaceContext* ctx, float out[], const int faceIdx, const int vertIdx)
         {
-            const auto pair = static_cast<Pair*>(ctx->m_pUserData);
-            int idx = pair->indices[faceIdx * 3 + vertIdx];
-            out[0] = pair->vertices[idx].position[0];
-            out[1] = pair->vertices[idx].position[1];
-            out[2] = pair->vertices[idx].position[2];
+            const auto* streams = static_cast<const Streams*>(ctx->m_pUserData);
+            const float* position = streams->positions + size_t(streams->indices[faceIdx * 3 + vertIdx]) * 3;
+            out[0] = position[0];
+            out[1] = position[1];
+            out[2] = position[2];
         },
         .m_getNormal =
-            [](const SMikkTSpaceContext* ctx, float out[], int faceIdx, int vertIdx)
+            [](const SMikkTSpaceContext* ctx, float out[], const int faceIdx, const int vertIdx)
         {
-            const auto pair = static_cast<Pair*>(ctx->m_pUserData);
-            int idx = pair->indices[faceIdx * 3 + vertIdx];
-            out[0] = pair->vertices[idx].normal[0];
-            out[1] = pair->vertices[idx].normal[1];
-            out[2] = pair->vertices[idx].normal[2];
+            const auto* streams = static_cast<const Streams*>(ctx->m_pUserData);
+            const float* normal = streams->normals + size_t(streams->indices[faceIdx * 3 + vertIdx]) * 3;
+            out[0] = normal[0];
+            out[1] = normal[1];
+            out[2] = normal[2];
         },
         .m_getTexCoord =
-            [](const SMikkTSpaceContext* ctx, float out[], int faceIdx, int vertIdx)
+            [](const SMikkTSpaceContext* ctx, float out[], const int faceIdx, const int vertIdx)
         {
-            const auto pair = static_cast<Pair*>(ctx->m_pUserData);
-            int idx = pair->indices[faceIdx * 3 + vertIdx];
-            out[0] = pair->vertices[idx].uv_x;
-            out[1] = pair->vertices[idx].uv_y;
+            const auto* streams = static_cast<const Streams*>(ctx->m_pUserData);
+            const float* tex_coord = streams->tex_coords + size_t(streams->indices[faceIdx * 3 + vertIdx]) * 2;
+            out[0] = tex_coord[0];
+            out[1] = tex_coord[1];
         },
         .m_setTSpaceBasic = static_cast<decltype(SMikkTSpaceInterface::m_setTSpaceBasic)>(
             [](const SMikkTSpaceContext* ctx, const float tangent[], const float sign, const int faceIdx, const int vertIdx)
             {
-                const auto pair = static_cast<Pair*>(ctx->m_pUserData);
-                int idx = pair->indices[faceIdx * 3 + vertIdx];
-                pair->vertices[idx].tangent = {tangent[0], tangent[1], tangent[2], sign};
+                const auto* streams = static_cast<const Streams*>(ctx->m_pUserData);
+                streams->tangents[streams->indices[faceIdx * 3 + vertIdx]] = {tangent[0], tangent[1], tangent[2], sign};
             })};
 
     const SMikkTSpaceContext context{
         .m_pInterface = &space_interface,
-        .m_pUserData = &pair,
+        .m_pUserData = &streams,
     };
     genTangSpaceDefault(&context);
 }
 
-Texture Importer::LoadTexture(const tinygltf::Model& model, const tinygltf::Texture& texture)
+bool Importer::LoadImageData(tinygltf::Image* image,
+                             int,
+                             std::string*,
+                             std::string*,
+                             int,
+                             int,
+                             const unsigned char* bytes,
+                             const int size,
+                             void*)
+{
+    // tinygltf would decode every image on the loading thread, the bytes are kept as they are and decoded in parallel
+    // by DecodeImage instead.
+    image->image.assign(bytes, bytes + size);
+    image->as_is = true;
+    return true;
+}
+
+std::array<int, 2> Importer::GetImageSources(const tinygltf::Texture& texture)
+{
+    for (const auto* extension : {"KHR_texture_basisu", "MSFT_texture_dds"})
+    {
+        if (const auto it = texture.extensions.find(extension); it != texture.extensions.end())
+        {
+            if (const auto& source = it->second.Get("source"); source.IsInt() && source.GetNumberAsInt() != texture.source)
+            {
+                return {source.GetNumberAsInt(), texture.source};
+            }
+        }
+    }
+    return {texture.source, -1};
+}
+
+std::optional<Texture> Importer::DecodeImage(const std::span<const uint8_t> encoded, const std::string& name)
 {
-    const auto image = model.images[texture.source];
+    if (IsTextureContainer(encoded))
+    {
+        // Pre-baked mips and slices are uploaded as stored.
+        return LoadTextureContainer(encoded, name);
+    }
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    auto* const pixels = stbi_load_from_memory(encoded.data(),
+                                               static_cast<int>(encoded.size()),
+                                               &width,
+                                               &height,
+                                               &channels,
+                                               STBI_rgb_alpha);
+    if (!pixels)
+    {
+        printf(std::format("Error: failed to decode {}: {}\n", name, stbi_failure_reason()).c_str());
+        return std::nullopt;
+    }
     Texture t{
-        .name = texture.name,
-        .width = (uint32_t)image.width,
-        .height = (uint32_t)image.height,
+        .name = name,
+        .width = static_cast<uint32_t>(width),
+        .height = static_cast<uint32_t>(height),
         .mip_levels = 1,
         .array_size = 1,
         .format = Swift::Format::eRGBA8_UNORM,
-        .pixels = image.image,
+        .pixels = std::vector<uint8_t>(pixels, pixels + size_t(width) * height * 4),
     };
+    stbi_image_free(pixels);
+    return t;
+}
+
+Texture Importer::LoadTexture(const tinygltf::Texture& texture,
+                              const int source,
+                              const std::span<std::optional<Texture>> images,
+                              const std::span<uint32_t> image_users)
+{
+    // A texture without an image that could be decoded is replaced by a white texel.
+    if (source < 0 || source >= static_cast<int>(images.size()) || !images[source])
+    {
+        printf(std::format("Error: texture {} has no image\n", texture.name).c_str());
+        return Texture{
+            .name = texture.name,
+            .width = 1,
+            .height = 1,
+            .mip_levels = 1,
+            .array_size = 1,
+            .format = Swift::Format::eRGBA8_UNORM,
+            .pixels = {255, 255, 255, 255},
+        };
+    }
+
+    Texture t = --image_users[source] == 0 ? std::move(*images[source]) : *images[source];
+    t.name = texture.name;
     return t;
 }
 
+std::vector<MipGenerationInfo> Importer::GetMipGenerationInfos(const Model& model, const MipFilter filter)
+{
+    std::vector<MipGenerationInfo> infos(model.textures.size(), MipGenerationInfo{.filter = filter});
+    for (const auto& material : model.materials)
+    {
+        if (material.albedo_index != -1)
+        {
+            auto& info = infos[material.albedo_index];
+            info.usage = TextureUsage::eColor;
+            if (material.alpha_mode == AlphaMode::eMask)
+            {
+                info.alpha_cutoff = material.alpha_cutoff;
+            }
+        }
+        if (material.emissive_index != -1)
+        {
+            infos[material.emissive_index].usage = TextureUsage::eColor;
+        }
+        if (material.normal_index != -1)
+        {
+            infos[material.normal_index].usage = TextureUsage::eNormal;
+        }
+    }
+    return infos;
+}
+
+std::vector<Swift::Format> Importer::GetCompressionFormats(const Model& model)
+{
+    enum Usage : uint32_t
+    {
+        eColor = 1 << 0,
+        eNormal = 1 << 1,
+        eOcclusion = 1 << 2,
+    };
+    std::vector<uint32_t> usages(model.textures.size());
+    for (const auto& material : model.materials)
+    {
+        for (const int index : {material.albedo_index, material.emissive_index, material.metal_rough_index})
+        {
+            if (index != -1) usages[index] |= eColor;
+        }
+        if (material.normal_index != -1) usages[material.normal_index] |= eNormal;
+        if (material.occlusion_index != -1) usages[material.occlusion_index] |= eOcclusion;
+    }
+
+    // Normals only need x and y and occlusion only red, textures shared between slots keep every channel.
+    std::vector<Swift::Format> formats(model.textures.size(), Swift::Format::eBC7_UNORM);
+    for (size_t i = 0; i < usages.size(); ++i)
+    {
+        if (usages[i] == eNormal)
+        {
+            formats[i] = Swift::Format::eBC5_UNORM;
+        }
+        else if (usages[i] == eOcclusion)
+        {
+            formats[i] = Swift::Format::eBC4_UNORM;
+        }
+    }
+    return formats;
+}
+
 glm::mat4 Importer::GetLocalTransform(const tinygltf::Node& node)
 {
     if (!node.matrix.empty())
@@ -345,43 +1444,88 @@ uint32_t Importer::PackCone(const meshopt_Bounds& bounds)
            (uint32_t(uint8_t(bounds.cone_axis_s8[2])) << 16) | (uint32_t(uint8_t(bounds.cone_cutoff_s8)) << 24);
 }
 
-std::vector<Mesh> Importer::LoadMesh(Model& model, const tinygltf::Model& tiny_model, const tinygltf::Mesh& mesh)
+Mesh Importer::LoadMesh(const tinygltf::Model& model,
+                        const std::span<const std::span<const uint8_t>> buffers,
+                        const tinygltf::Mesh& mesh,
+                        const tinygltf::Primitive& primitive,
+                        const ImportSettings& settings,
+                        std::vector<CullData>& cull_datas,
+                        std::vector<ClusterLod>& cluster_lods,
+                        MeshOptimizationReport* report)
 {
-    std::vector<Mesh> meshes;
-    for (const auto& prim : mesh.primitives)
-    {
-        auto indices = LoadIndices(tiny_model, prim);
-        const auto vertices = LoadVertices(tiny_model, prim, indices);
-        auto [meshlets, meshlet_vertices, meshlet_triangles] = BuildMeshlets(vertices, indices);
-        for (const auto& meshlet : meshlets)
-        {
-            const meshopt_Bounds bounds = meshopt_computeMeshletBounds(&meshlet_vertices[meshlet.vertex_offset],
-                                                                       &meshlet_triangles[meshlet.triangle_offset],
-                                                                       meshlet.triangle_count,
-                                                                       &vertices[0].position.x,
-                                                                       vertices.size(),
-                                                                       sizeof(Vertex));
-
-            model.cull_datas.push_back(CullData{
-                .center = glm::vec3(bounds.center[0], bounds.center[1], bounds.center[2]),
-                .radius = bounds.radius,
-                .cone_apex = glm::vec3(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]),
-                .cone_packed = PackCone(bounds),
-            });
-        }
+    auto indices = LoadIndices(model, buffers, primitive);
+    auto vertices = LoadVertices(model, buffers, primitive, indices);
+    if (report)
+    {
+        report->before = AnalyzeMesh(vertices, indices);
+    }
+    OptimizeMesh(vertices, indices, settings);
+    if (report)
+    {
+        report->after = AnalyzeMesh(vertices, indices);
+    }
 
-        const auto repacked_triangles = RepackMeshlets(meshlets, meshlet_triangles);
-        Mesh m{
-            .name = mesh.name,
-            .meshlets = meshlets,
-            .vertices = vertices,
-            .meshlet_vertices = meshlet_vertices,
-            .meshlet_triangles = repacked_triangles,
-            .material_index = prim.material,
-        };
-        meshes.emplace_back(m);
+    auto [meshlets, meshlet_vertices, meshlet_triangles] = BuildMeshlets(vertices, indices, settings.meshlets);
+    if (settings.sort_meshlets)
+    {
+        SortMeshlets(meshlets, meshlet_vertices, meshlet_triangles, vertices);
+    }
+    std::vector<MeshLod> lods;
+    if (settings.build_cluster_lod)
+    {
+        // The discrete levels are replaced by the DAG, level 0 still covers the full detail meshlets.
+        lods = {{.meshlet_offset = 0, .meshlet_count = static_cast<uint32_t>(meshlets.size()), .error = 0.f}};
+        cluster_lods = BuildClusterLod(vertices, settings.meshlets, meshlets, meshlet_vertices, meshlet_triangles);
+    }
+    else
+    {
+        lods = BuildLods(vertices, std::move(indices), settings, meshlets, meshlet_vertices, meshlet_triangles);
+    }
+
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(-std::numeric_limits<float>::max());
+    for (const auto& vertex : vertices)
+    {
+        min = glm::min(min, vertex.position);
+        max = glm::max(max, vertex.position);
+    }
+    const glm::vec3 center = vertices.empty() ? glm::vec3(0.f) : (min + max) * 0.5f;
+    float radius = 0.f;
+    for (const auto& vertex : vertices)
+    {
+        radius = std::max(radius, glm::distance(center, vertex.position));
+    }
+
+    cull_datas.reserve(meshlets.size());
+    for (const auto& meshlet : meshlets)
+    {
+        const meshopt_Bounds bounds = meshopt_computeMeshletBounds(&meshlet_vertices[meshlet.vertex_offset],
+                                                                   &meshlet_triangles[meshlet.triangle_offset],
+                                                                   meshlet.triangle_count,
+                                                                   &vertices[0].position.x,
+                                                                   vertices.size(),
+                                                                   sizeof(Vertex));
+
+        cull_datas.push_back(CullData{
+            .center = glm::vec3(bounds.center[0], bounds.center[1], bounds.center[2]),
+            .radius = bounds.radius,
+            .cone_apex = glm::vec3(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]),
+            .cone_packed = PackCone(bounds),
+        });
     }
-    return meshes;
+
+    auto repacked_triangles = RepackMeshlets(meshlets, meshlet_triangles);
+    return Mesh{
+        .name = mesh.name,
+        .meshlets = std::move(meshlets),
+        .vertices = std::move(vertices),
+        .meshlet_vertices = std::move(meshlet_vertices),
+        .meshlet_triangles = std::move(repacked_triangles),
+        .material_index = primitive.material,
+        .lods = std::move(lods),
+        .center = center,
+        .radius = radius,
+    };
 }
 
 Material Importer::LoadMaterial(const tinygltf::Material& material)
@@ -393,10 +1537,14 @@ Material Importer::LoadMaterial(const tinygltf::Material& material)
     std::array<float, 3> emissive{};
     std::ranges::transform(material.emissiveFactor, emissive.begin(), [](const double d) { return static_cast<float>(d); });
     AlphaMode alpha_mode = AlphaMode::eOpaque;
-    if (material.alphaMode == "TRANSPARENT")
+    if (material.alphaMode == "MASK")
     {
         alpha_mode = AlphaMode::eMask;
     }
+    else if (material.alphaMode == "BLEND")
+    {
+        alpha_mode = AlphaMode::eBlend;
+    }
 
     int albedo_index = -1;
     if (material.pbrMetallicRoughness.baseColorTexture.index != -1)
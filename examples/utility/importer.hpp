@@ -2,10 +2,18 @@
 #include "swift_structs.hpp"
 #include "meshoptimizer.h"
 #include "tiny_gltf.h"
+#include "algorithm"
+#include "array"
+#include "optional"
 #include "span"
 #include "glm/fwd.hpp"
 #include "glm/vec3.hpp"
 #include "glm/vec4.hpp"
+#include "lod.hpp"
+#include "meshlet_culling.hpp"
+#include "mip_generator.hpp"
+#include "texture_compressor.hpp"
+#include "vertex_quantizer.hpp"
 
 struct Vertex
 {
@@ -24,6 +32,15 @@ struct Mesh
     std::vector<uint32_t> meshlet_vertices;
     std::vector<uint32_t> meshlet_triangles;
     int material_index;
+    // Replaces vertices when ImportSettings::quantize_vertices is set, see vertex_quantizer.hpp.
+    std::vector<QuantizedVertex> quantized_vertices;
+    glm::vec3 position_offset{};
+    glm::vec3 position_scale{};
+    // Level 0 is the full mesh, the meshlets of every level are stored one level after the other.
+    std::vector<MeshLod> lods;
+    // Bounding sphere of the mesh for SelectLod.
+    glm::vec3 center{};
+    float radius{};
 };
 
 enum class AlphaMode : uint32_t
@@ -59,6 +76,8 @@ struct Texture
     uint32_t height;
     uint16_t mip_levels;
     uint16_t array_size;
+    // Set when the slices are cube faces, array_size then counts every face of every cube.
+    bool is_cube;
     Swift::Format format;
     std::vector<uint8_t> pixels;
 };
@@ -72,6 +91,7 @@ struct Sampler
     Swift::Wrap wrap_y;
 };
 
+// One per primitive of a glTF node, mesh_index points into Model::meshes.
 struct Node
 {
     std::string name;
@@ -79,12 +99,13 @@ struct Node
     int mesh_index;
 };
 
-struct CullData
+// Every node that draws the same mesh, so that one dispatch draws all of them.
+struct MeshInstances
 {
-    glm::vec3 center{};
-    float radius{};
-    glm::vec3 cone_apex;
-    uint32_t cone_packed;
+    uint32_t mesh_index;
+    // Range in Model::instance_transforms and Model::instance_cull_datas.
+    uint32_t instance_offset;
+    uint32_t instance_count;
 };
 
 struct Model
@@ -96,47 +117,215 @@ struct Model
     std::vector<glm::mat4> transforms;
     std::vector<Node> nodes;
     std::vector<CullData> cull_datas;
+    // One per meshlet like cull_datas when ImportSettings::build_cluster_lod is set, empty otherwise.
+    std::vector<ClusterLod> cluster_lods;
+    // Nodes grouped by mesh, in the order each mesh is first used. The per-meshlet bounds in cull_datas stay in mesh
+    // space and are shared by every instance.
+    std::vector<MeshInstances> mesh_instances;
+    std::vector<glm::mat4> instance_transforms;
+    std::vector<InstanceCullData> instance_cull_datas;
+};
+
+// Summed over meshes for ImportSettings::report_mesh_optimization.
+struct MeshStatistics
+{
+    size_t triangle_count = 0;
+    size_t vertex_count = 0;
+    // Misses of a 16 entry FIFO post transform cache.
+    size_t vertices_transformed = 0;
+    size_t pixels_covered = 0;
+    size_t pixels_shaded = 0;
+    size_t bytes_fetched = 0;
+};
+
+struct MeshOptimizationReport
+{
+    MeshStatistics before;
+    MeshStatistics after;
+};
+
+enum class MeshletSplit
+{
+    // Greedy clustering that grows along shared vertices, cone_weight trades size for tighter normal cones.
+    eCone,
+    // Splits along the longest axis of the bounds, giving smaller spheres for frustum and occlusion culling at the
+    // cost of less vertex reuse.
+    eSpatial,
+};
+
+// Limits of a single meshlet. The mesh shaders have to be compiled with the same limits, see GetMeshletShaderDefines.
+struct MeshletSettings
+{
+    // At most 256 each since a mesh shader cannot output more, triangles are rounded down to a multiple of 4.
+    uint32_t max_vertices = 64;
+    uint32_t max_triangles = 124;
+    MeshletSplit split = MeshletSplit::eCone;
+    // 0 builds meshlets by vertex reuse alone, up to 1 favours normal cones that backface cull more often.
+    float cone_weight = 0.f;
+    // eSpatial only, 0 takes the best split and up to 1 favours full meshlets over tight bounds.
+    float fill_weight = 0.5f;
+    // Meshlets handled by one amplification group, see MeshRenderer::Draw.
+    uint32_t amplification_group_size = 32;
+};
+
+// Clamps the limits to what meshoptimizer and mesh shaders support, every user of MeshletSettings goes through this.
+constexpr MeshletSettings ClampMeshletSettings(MeshletSettings settings)
+{
+    settings.max_vertices = std::clamp(settings.max_vertices, 3u, 256u);
+    settings.max_triangles = std::clamp(settings.max_triangles, 4u, 256u) & ~3u;
+    settings.cone_weight = std::clamp(settings.cone_weight, 0.f, 1.f);
+    settings.fill_weight = std::clamp(settings.fill_weight, 0.f, 1.f);
+    settings.amplification_group_size = std::clamp(settings.amplification_group_size, 1u, 128u);
+    return settings;
+}
+
+struct ImportSettings
+{
+    // Bakes the full mip chain of every texture on the CPU, see mip_generator.hpp.
+    bool generate_mips = true;
+    MipFilter mip_filter = MipFilter::eBox;
+    // Block compresses textures by how the materials use them, see texture_compressor.hpp.
+    bool compress_textures = true;
+    CompressionQuality compression_quality = CompressionQuality::eNormal;
+    // Prints the PSNR of every compressed texture.
+    bool report_compression = false;
+    // Threads every import stage is spread over, 0 uses every hardware thread and 1 imports serially.
+    uint32_t thread_count = 0;
+    // Reuses <path>.swiftcache when it was baked from the same file with the same settings and writes it otherwise,
+    // see scene_cache.hpp. Only the .gltf/.glb itself is hashed, not external buffers or images.
+    bool use_scene_cache = true;
+    // Maps a .glb instead of reading it, vertex, index and image data are used in place and dropped from the working
+    // set as each primitive and image is done. Keeps the resident size bounded for scenes larger than memory.
+    bool streaming = false;
+    // Stores vertices as 16 byte QuantizedVertex instead of 48 byte Vertex, see vertex_quantizer.hpp.
+    bool quantize_vertices = false;
+    // Prints the largest position, normal, tangent and uv error of every quantized mesh.
+    bool report_quantization = false;
+    // Levels of detail per mesh including the full one, capped at k_max_lod_count. Each level keeps lod_reduction of the
+    // triangles of the one before it, fewer levels are generated once the simplifier cannot reach that within
+    // lod_target_error, which is relative to the mesh size.
+    uint32_t lod_count = 1;
+    float lod_reduction = 0.5f;
+    float lod_target_error = 0.05f;
+    // Builds a DAG of clusters in place of the levels above: runs of 4 meshlets along a space filling curve are merged,
+    // simplified to half with the group border locked and split into meshlets again, until a single cluster is left
+    // or nothing simplifies any further. Level 0 stays the original meshlets, every meshlet gets a ClusterLod in
+    // Model::cluster_lods and SelectClusters picks a crack free cut from them.
+    bool build_cluster_lod = false;
+    // Run in this order before the meshlets are built: indices are reordered for the post transform cache, then for
+    // overdraw while the cache efficiency stays within overdraw_threshold of the first pass, then vertices are
+    // reordered in the order the indices first use them.
+    bool optimize_vertex_cache = false;
+    bool optimize_overdraw = false;
+    float overdraw_threshold = 1.05f;
+    bool optimize_vertex_fetch = false;
+    // Orders the meshlets of a mesh along a space filling curve, and the vertices and triangles inside each meshlet.
+    bool sort_meshlets = false;
+    // Prints the ACMR, overdraw and overfetch of all meshes before and after the optimizations above.
+    bool report_mesh_optimization = false;
+    MeshletSettings meshlets{};
+    // Prints the fill, bounds and cone statistics of the meshlets of the model, see meshlet_statistics.hpp.
+    bool report_meshlets = false;
 };
 
 class Importer
 {
 public:
-    Model LoadModel(std::string_view path);
+    Model LoadModel(std::string_view path, const ImportSettings& settings = {});
 
 private:
+    // Buffers are passed as spans so they can point into a mapped file as well as into tinygltf's buffers.
+    static std::span<const uint8_t> GetAccessorData(const tinygltf::Model& model,
+                                                    std::span<const std::span<const uint8_t>> buffers,
+                                                    int accessor_index);
+
     static const float* GetAttributeData(const std::string& name,
                                          const tinygltf::Model& model,
+                                         std::span<const std::span<const uint8_t>> buffers,
                                          const tinygltf::Primitive& primitive,
                                          uint32_t& numAttributes);
 
     static std::vector<Vertex> LoadVertices(const tinygltf::Model& model,
+                                            std::span<const std::span<const uint8_t>> buffers,
                                             const tinygltf::Primitive& primitive,
-                                            std::vector<uint32_t>& indices);
+                                            std::span<const uint32_t> indices);
 
-    static std::vector<uint32_t> LoadIndices(const tinygltf::Model& model, const tinygltf::Primitive& primitive);
+    static std::vector<uint32_t> LoadIndices(const tinygltf::Model& model,
+                                             std::span<const std::span<const uint8_t>> buffers,
+                                             const tinygltf::Primitive& primitive);
 
     static std::tuple<std::vector<meshopt_Meshlet>, std::vector<uint32_t>, std::vector<uint8_t>> BuildMeshlets(
         std::span<const Vertex> vertices,
-        std::span<const uint32_t> indices);
+        std::span<const uint32_t> indices,
+        const MeshletSettings& settings);
+
+    static void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const ImportSettings& settings);
+    static MeshStatistics AnalyzeMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+    static std::vector<MeshLod> BuildLods(std::span<const Vertex> vertices,
+                                          std::vector<uint32_t> indices,
+                                          const ImportSettings& settings,
+                                          std::vector<meshopt_Meshlet>& meshlets,
+                                          std::vector<uint32_t>& meshlet_vertices,
+                                          std::vector<uint8_t>& meshlet_triangles);
+    static std::vector<ClusterLod> BuildClusterLod(std::span<const Vertex> vertices,
+                                                   const MeshletSettings& settings,
+                                                   std::vector<meshopt_Meshlet>& meshlets,
+                                                   std::vector<uint32_t>& meshlet_vertices,
+                                                   std::vector<uint8_t>& meshlet_triangles);
+    static void SortMeshlets(std::vector<meshopt_Meshlet>& meshlets,
+                             std::vector<uint32_t>& meshlet_vertices,
+                             std::vector<uint8_t>& meshlet_triangles,
+                             std::span<const Vertex> vertices);
 
     static std::tuple<std::vector<Node>, std::vector<glm::mat4>> LoadNodes(const tinygltf::Model& model);
     static void LoadNode(const tinygltf::Model& model,
                          int node_index,
                          const glm::mat4& parent_transform,
+                         std::span<const uint32_t> first_primitives,
                          std::vector<Node>& nodes,
                          std::vector<glm::mat4>& transforms);
+    static void BuildInstances(Model& model);
 
     static std::vector<uint32_t> RepackMeshlets(std::span<meshopt_Meshlet> meshlets,
                                                 std::span<const uint8_t> meshlet_triangles);
 
-    static void LoadTangents(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+    // Generates MikkTSpace tangents from tightly packed float3 positions and normals and float2 texture coordinates.
+    static void LoadTangents(std::span<const float> positions,
+                             std::span<const float> normals,
+                             std::span<const float> tex_coords,
+                             std::span<const uint32_t> indices,
+                             std::span<glm::vec4> tangents);
 
-    static Texture LoadTexture(const tinygltf::Model& model, const tinygltf::Texture& texture);
+    static bool LoadImageData(tinygltf::Image* image,
+                              int image_index,
+                              std::string* error,
+                              std::string* warning,
+                              int req_width,
+                              int req_height,
+                              const unsigned char* bytes,
+                              int size,
+                              void* user_data);
+    // The image of KHR_texture_basisu or MSFT_texture_dds, then texture.source as its fallback. -1 when missing.
+    static std::array<int, 2> GetImageSources(const tinygltf::Texture& texture);
+    static std::optional<Texture> DecodeImage(std::span<const uint8_t> encoded, const std::string& name);
+    static Texture LoadTexture(const tinygltf::Texture& texture,
+                               int source,
+                               std::span<std::optional<Texture>> images,
+                               std::span<uint32_t> image_users);
+    static std::vector<MipGenerationInfo> GetMipGenerationInfos(const Model& model, MipFilter filter);
+    static std::vector<Swift::Format> GetCompressionFormats(const Model& model);
 
     static glm::mat4 GetLocalTransform(const tinygltf::Node& node);
     static uint32_t PackCone(const meshopt_Bounds& bounds);
 
-    static std::vector<Mesh> LoadMesh(Model& model, const tinygltf::Model& tiny_model, const tinygltf::Mesh& mesh);
+    static Mesh LoadMesh(const tinygltf::Model& model,
+                         std::span<const std::span<const uint8_t>> buffers,
+                         const tinygltf::Mesh& mesh,
+                         const tinygltf::Primitive& primitive,
+                         const ImportSettings& settings,
+                         std::vector<CullData>& cull_datas,
+                         std::vector<ClusterLod>& cluster_lods,
+                         MeshOptimizationReport* report);
 
     static Material LoadMaterial(const tinygltf::Material& material);
 
@@ -0,0 +1,138 @@
+#include "lod.hpp"
+#include "algorithm"
+#include "cmath"
+#include "limits"
+#include "glm/geometric.hpp"
+
+namespace
+{
+    struct LodView
+    {
+        const glm::mat4& transform;
+        // Largest axis scale of the transform, errors and radii grow by it.
+        float scale;
+        glm::vec3 camera_position;
+        float projection_scale;
+    };
+
+    LodView GetLodView(const glm::mat4& transform, const glm::vec3& camera_position, const float projection_scale)
+    {
+        const float scale = std::max({glm::length(glm::vec3(transform[0])),
+                                      glm::length(glm::vec3(transform[1])),
+                                      glm::length(glm::vec3(transform[2]))});
+        return {transform, scale, camera_position, projection_scale};
+    }
+
+    // True when the error projects to at most max_pixel_error at the point of the sphere closest to the camera. Only
+    // an exact surface fits from inside the sphere. A larger error or a sphere containing the other can never fit
+    // where the smaller one does not, which is what keeps cuts monotonic.
+    bool FitsError(const LodView& view,
+                   const glm::vec3& center,
+                   const float radius,
+                   const float error,
+                   const float max_pixel_error)
+    {
+        const glm::vec3 world_center(view.transform * glm::vec4(center, 1.f));
+        const float distance = glm::distance(world_center, view.camera_position) - radius * view.scale;
+        if (distance <= 0.f)
+        {
+            return error == 0.f;
+        }
+        return error * view.scale * view.projection_scale <= max_pixel_error * distance;
+    }
+
+    uint32_t SelectClusters(const std::span<const ClusterLod> clusters,
+                            const LodView& view,
+                            const float max_pixel_error,
+                            std::vector<uint32_t>* selected)
+    {
+        uint32_t triangle_count = 0;
+        for (uint32_t i = 0; i < clusters.size(); ++i)
+        {
+            const auto& cluster = clusters[i];
+            if (FitsError(view, cluster.center, cluster.radius, cluster.error, max_pixel_error) &&
+                !FitsError(view, cluster.parent_center, cluster.parent_radius, cluster.parent_error, max_pixel_error))
+            {
+                triangle_count += cluster.triangle_count;
+                if (selected)
+                {
+                    selected->push_back(i);
+                }
+            }
+        }
+        return triangle_count;
+    }
+}  // namespace
+
+float GetLodProjectionScale(const float fov_y, const float viewport_height)
+{
+    return viewport_height / (2.f * std::tan(fov_y * 0.5f));
+}
+
+uint32_t SelectLod(const std::span<const MeshLod> lods,
+                   const glm::vec3& center,
+                   const float radius,
+                   const glm::mat4& transform,
+                   const glm::vec3& camera_position,
+                   const float projection_scale,
+                   const float max_pixel_error)
+{
+    const LodView view = GetLodView(transform, camera_position, projection_scale);
+    // Errors only grow with the level, so the first level from the coarse end that fits is the coarsest one.
+    for (auto lod = static_cast<uint32_t>(lods.size()); lod-- > 1;)
+    {
+        if (FitsError(view, center, radius, lods[lod].error, max_pixel_error))
+        {
+            return lod;
+        }
+    }
+    return 0;
+}
+
+uint32_t SelectClusters(const std::span<const ClusterLod> clusters,
+                        const glm::mat4& transform,
+                        const glm::vec3& camera_position,
+                        const float projection_scale,
+                        const float max_pixel_error,
+                        std::vector<uint32_t>& selected)
+{
+    const LodView view = GetLodView(transform, camera_position, projection_scale);
+    return SelectClusters(clusters, view, max_pixel_error, &selected);
+}
+
+float SelectClustersForBudget(const std::span<const ClusterLod> clusters,
+                              const glm::mat4& transform,
+                              const glm::vec3& camera_position,
+                              const float projection_scale,
+                              const uint32_t triangle_budget,
+                              std::vector<uint32_t>& selected)
+{
+    // The triangle count only falls as the threshold grows, so the smallest threshold within budget is found by
+    // bisecting its logarithm between a sixteenth of a pixel and the whole screen.
+    const LodView view = GetLodView(transform, camera_position, projection_scale);
+    float low = std::log2(1.f / 16.f);
+    float high = std::log2(4096.f);
+    if (SelectClusters(clusters, view, std::exp2(low), nullptr) > triangle_budget)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            const float middle = (low + high) * 0.5f;
+            if (SelectClusters(clusters, view, std::exp2(middle), nullptr) > triangle_budget)
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+    }
+    else
+    {
+        high = low;
+    }
+
+    const float max_pixel_error = std::exp2(high);
+    SelectClusters(clusters, view, max_pixel_error, &selected);
+    return max_pixel_error;
+}
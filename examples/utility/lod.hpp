@@ -0,0 +1,65 @@
+#pragma once
+#include "cstdint"
+#include "span"
+#include "vector"
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+
+// Levels of detail per mesh are capped here so MeshRenderer can keep its ranges in a fixed array.
+constexpr uint32_t k_max_lod_count = 8;
+
+struct MeshLod
+{
+    // Range in Mesh::meshlets, the same range of Model::cull_datas from the mesh's first meshlet holds their bounds.
+    uint32_t meshlet_offset;
+    uint32_t meshlet_count;
+    // Upper bound in mesh units on how far the level strays from the full detail surface, 0 for level 0.
+    float error;
+};
+
+// Pixels covered by one unit of length at distance 1 from the camera.
+float GetLodProjectionScale(float fov_y, float viewport_height);
+
+// Picks the coarsest level whose error, projected at the point of the bounding sphere closest to the camera, stays
+// within max_pixel_error. The sphere is in mesh space and is placed by transform, scale included.
+uint32_t SelectLod(std::span<const MeshLod> lods,
+                   const glm::vec3& center,
+                   float radius,
+                   const glm::mat4& transform,
+                   const glm::vec3& camera_position,
+                   float projection_scale,
+                   float max_pixel_error = 1.f);
+
+// One per meshlet of a mesh built with ImportSettings::build_cluster_lod, laid out like Model::cull_datas. The
+// bounds and error are those of the group the cluster was split from, the parent ones those of the group it was
+// merged into, with an infinite error for clusters that were never merged. Errors are in mesh units and, like the
+// spheres, only grow from a cluster to its parent.
+struct ClusterLod
+{
+    glm::vec3 center;
+    float radius;
+    glm::vec3 parent_center;
+    float parent_radius;
+    float error;
+    float parent_error;
+    uint32_t triangle_count;
+    uint32_t padding;
+};
+
+// Appends the clusters whose own error fits within max_pixel_error and whose parent's does not, and returns their
+// triangle count. Clusters of one group share both bounds and errors, so a group is either drawn or replaced as a
+// whole and the cut never opens cracks. Every cluster is tested on its own, which maps to one thread per cluster.
+uint32_t SelectClusters(std::span<const ClusterLod> clusters,
+                        const glm::mat4& transform,
+                        const glm::vec3& camera_position,
+                        float projection_scale,
+                        float max_pixel_error,
+                        std::vector<uint32_t>& selected);
+
+// Same as SelectClusters with the smallest pixel error whose cut stays within triangle_budget, which is returned.
+float SelectClustersForBudget(std::span<const ClusterLod> clusters,
+                              const glm::mat4& transform,
+                              const glm::vec3& camera_position,
+                              float projection_scale,
+                              uint32_t triangle_budget,
+                              std::vector<uint32_t>& selected);
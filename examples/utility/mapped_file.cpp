@@ -0,0 +1,147 @@
+#include "mapped_file.hpp"
+#include "string"
+#include "utility"
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include "windows.h"
+#else
+#include "fcntl.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "unistd.h"
+#endif
+
+MappedFile::MappedFile(const std::string_view path)
+{
+    const std::string filepath(path);
+#ifdef _WIN32
+    const HANDLE file = CreateFileA(filepath.c_str(),
+                                    GENERIC_READ,
+                                    FILE_SHARE_READ,
+                                    nullptr,
+                                    OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                                    nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    m_file = file;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        Close();
+        return;
+    }
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping)
+    {
+        Close();
+        return;
+    }
+
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    m_size = m_data ? static_cast<size_t>(size.QuadPart) : 0;
+    if (!m_data)
+    {
+        Close();
+    }
+#else
+    const int file = open(filepath.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return;
+    }
+
+    struct stat info{};
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+    {
+        void* const data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED)
+        {
+            m_data = static_cast<const uint8_t*>(data);
+            m_size = static_cast<size_t>(info.st_size);
+        }
+    }
+    // The mapping keeps the file alive on its own.
+    close(file);
+#endif
+}
+
+MappedFile::~MappedFile() { Close(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+        m_file = std::exchange(other.m_file, nullptr);
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::Evict(const std::span<const uint8_t> range) const
+{
+    if (range.empty() || range.data() < m_data || range.data() + range.size() > m_data + m_size)
+    {
+        return;
+    }
+
+    // Only whole pages inside the range are dropped, the pages at either end may still be shared with its neighbours.
+#ifdef _WIN32
+    SYSTEM_INFO info{};
+    GetSystemInfo(&info);
+    const auto page_size = static_cast<uintptr_t>(info.dwPageSize);
+#else
+    const auto page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+#endif
+    const auto begin = (reinterpret_cast<uintptr_t>(range.data()) + page_size - 1) & ~(page_size - 1);
+    const auto end = (reinterpret_cast<uintptr_t>(range.data()) + range.size()) & ~(page_size - 1);
+    if (begin >= end)
+    {
+        return;
+    }
+#ifdef _WIN32
+    // Unlocking pages that are not locked removes them from the working set.
+    VirtualUnlock(reinterpret_cast<void*>(begin), end - begin);
+#else
+    madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+#endif
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+    }
+    if (m_file)
+    {
+        CloseHandle(m_file);
+    }
+    m_file = nullptr;
+    m_mapping = nullptr;
+#else
+    if (m_data)
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "cstdint"
+#include "span"
+#include "string_view"
+
+// Read only memory mapping of a whole file, pages are brought in by the OS as they are touched.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(std::string_view path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    [[nodiscard]] bool IsOpen() const { return m_data != nullptr; }
+    [[nodiscard]] std::span<const uint8_t> GetData() const { return {m_data, m_size}; }
+
+    // Drops the pages of a range from the working set once it has been consumed, they are read from the file again if
+    // touched later. Keeps the resident size of a large file bounded while it is streamed through.
+    void Evict(std::span<const uint8_t> range) const;
+
+    void Close();
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
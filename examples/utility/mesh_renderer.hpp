@@ -1,6 +1,13 @@
 #pragma once
 #include "swift_builders.hpp"
 #include "swift_texture_view.hpp"
+#include "importer.hpp"
+#include "lod.hpp"
+#include "meshlet_culling.hpp"
+#include "shader_compiler.hpp"
+#include "algorithm"
+#include "array"
+#include "string"
 
 struct TextureView
 {
@@ -16,14 +23,54 @@ struct MeshRenderer
     uint32_t m_mesh_triangle_buffer;
     uint32_t m_meshlet_count;
     int m_material_index;
-    uint32_t m_transform_index;
+    // Range in Model::instance_transforms, every instance is drawn by the same dispatch.
+    uint32_t m_instance_offset;
+    uint32_t m_instance_count;
+    // First meshlet of the mesh in Model::cull_datas.
     uint32_t m_bounding_offset;
+    // Set when m_vertex_buffer holds QuantizedVertex, the positions decode as offset + position * scale.
+    bool m_quantized;
+    glm::vec3 m_position_offset;
+    glm::vec3 m_position_scale;
+    // Meshlet range of every level of detail, level 0 is the full mesh. m_meshlet_count counts the meshlets of all of
+    // them. The bounds are in mesh space, see SelectLod.
+    std::array<MeshLod, k_max_lod_count> m_lods;
+    uint32_t m_lod_count;
+    glm::vec3 m_center;
+    float m_radius;
+    // Meshlets per amplification group, AMPLIFICATION_GROUP_SIZE in the shader.
+    uint32_t m_amplification_group_size;
 
+    std::span<const MeshLod> GetLods() const { return {m_lods.data(), m_lod_count}; }
+
+    // Root constants that draw the meshlets of one level for every instance, see MeshletDrawConstants.
+    MeshletDrawConstants GetDrawConstants(const uint32_t sampler_index, const uint32_t lod = 0) const
+    {
+        return MeshletDrawConstants{
+            .sampler_index = sampler_index,
+            .vertex_buffer = m_vertex_buffer,
+            .meshlet_buffer = m_mesh_buffer,
+            .mesh_vertex_buffer = m_mesh_vertex_buffer,
+            .mesh_triangle_buffer = m_mesh_triangle_buffer,
+            .material_index = m_material_index,
+            .instance_offset = m_instance_offset,
+            .quantized = m_quantized,
+            .position_offset = m_position_offset,
+            .padding = 0.f,
+            .position_scale = m_position_scale,
+            .meshlet_offset = m_lods[lod].meshlet_offset,
+        };
+    }
+
+    // Dispatches the meshlets of one level for every instance, the shader adds m_lods[lod].meshlet_offset to the X group
+    // index and m_instance_offset to the Y one.
     void Draw(Swift::ICommand* command,
               const bool amp_dispatch = false,
               const bool should_cull = false,
-              const uint32_t pass_index = 0) const
+              const uint32_t pass_index = 0,
+              const uint32_t lod = 0) const
     {
+        const uint32_t meshlet_count = m_lods[lod].meshlet_count;
         // const struct PushConstants
         // {
         //     uint32_t vertex_buffer;
@@ -31,7 +78,7 @@ struct MeshRenderer
         //     uint32_t mesh_vertex_buffer;
         //     uint32_t mesh_triangle_buffer;
         //     int material_index;
-        //     uint32_t transform_index;
+        //     uint32_t instance_offset;
         //     uint32_t meshlet_count;
         //     uint32_t bounding_offset;
         //     uint32_t should_cull;
@@ -42,7 +89,7 @@ struct MeshRenderer
         //     .mesh_vertex_buffer = m_mesh_vertex_buffer,
         //     .mesh_triangle_buffer = m_mesh_triangle_buffer,
         //     .material_index = m_material_index,
-        //     .transform_index = m_transform_index,
+        //     .instance_offset = m_instance_offset,
         //     .meshlet_count = m_meshlet_count,
         //     .bounding_offset = m_bounding_offset,
         //     .should_cull = should_cull,
@@ -51,16 +98,33 @@ struct MeshRenderer
         // command->PushConstants(&push_constants, sizeof(PushConstants));
         if (amp_dispatch)
         {
-            const uint32_t num_amp_groups = (m_meshlet_count + 31) / 32;
-            command->DispatchMesh(num_amp_groups, 1, 1);
+            const uint32_t num_amp_groups =
+                (meshlet_count + m_amplification_group_size - 1) / m_amplification_group_size;
+            command->DispatchMesh(num_amp_groups, m_instance_count, 1);
         }
         else
         {
-            command->DispatchMesh(m_meshlet_count, 1, 1);
+            command->DispatchMesh(meshlet_count, m_instance_count, 1);
         }
     }
 };
 
+// The limits the meshlets were built with, for the shaders that draw them. MAX_MESHLET_VERTICES and
+// MAX_MESHLET_TRIANGLES size the mesh shader outputs, MESHLET_GROUP_SIZE is its thread count, which covers one vertex
+// and one triangle per thread up to the 128 threads a mesh shader group may have and loops past that.
+// AMPLIFICATION_GROUP_SIZE is the thread count of the amplification shader, one meshlet per thread.
+inline std::vector<ShaderDefine> GetMeshletShaderDefines(const MeshletSettings& settings)
+{
+    const MeshletSettings limits = ClampMeshletSettings(settings);
+    const uint32_t group_size = std::min((std::max(limits.max_vertices, limits.max_triangles) + 31) / 32 * 32, 128u);
+    return {
+        {.name = "MAX_MESHLET_VERTICES", .value = std::to_string(limits.max_vertices)},
+        {.name = "MAX_MESHLET_TRIANGLES", .value = std::to_string(limits.max_triangles)},
+        {.name = "MESHLET_GROUP_SIZE", .value = std::to_string(group_size)},
+        {.name = "AMPLIFICATION_GROUP_SIZE", .value = std::to_string(limits.amplification_group_size)},
+    };
+}
+
 struct MeshBuffers
 {
     Swift::IBuffer* m_vertex_buffer;
@@ -78,12 +142,16 @@ inline std::vector<MeshBuffers> CreateMeshBuffers(Swift::IContext* context, cons
     std::vector<MeshBuffers> mesh_buffers;
     for (auto& mesh : meshes)
     {
-        auto* const vertex_buffer =
-            Swift::BufferBuilder(context, sizeof(Vertex) * mesh.vertices.size()).SetData(mesh.vertices.data()).Build();
-        auto* const vertex_buffer_srv =
-            context->CreateBufferView(vertex_buffer,
-                                      Swift::BufferViewCreateInfo{.num_elements = static_cast<uint32_t>(mesh.vertices.size()),
-                                                                  .element_size = sizeof(Vertex)});
+        const bool quantized = !mesh.quantized_vertices.empty();
+        const uint32_t vertex_count =
+            static_cast<uint32_t>(quantized ? mesh.quantized_vertices.size() : mesh.vertices.size());
+        const uint32_t vertex_size = quantized ? sizeof(QuantizedVertex) : sizeof(Vertex);
+        const void* vertex_data =
+            quantized ? static_cast<const void*>(mesh.quantized_vertices.data()) : mesh.vertices.data();
+        auto* const vertex_buffer = Swift::BufferBuilder(context, vertex_size * vertex_count).SetData(vertex_data).Build();
+        auto* const vertex_buffer_srv = context->CreateBufferView(
+            vertex_buffer,
+            Swift::BufferViewCreateInfo{.num_elements = vertex_count, .element_size = vertex_size});
         auto* const meshlet_buffer =
             Swift::BufferBuilder(context, sizeof(meshopt_Meshlet) * mesh.meshlets.size()).SetData(mesh.meshlets.data()).Build();
         auto* const meshlet_buffer_srv =
@@ -119,16 +187,32 @@ inline std::vector<MeshBuffers> CreateMeshBuffers(Swift::IContext* context, cons
     return mesh_buffers;
 }
 
-inline std::vector<MeshRenderer> CreateMeshRenderers(const std::span<const Node> nodes,
+inline std::vector<MeshRenderer> CreateMeshRenderers(const std::span<const MeshInstances> mesh_instances,
                                                      const std::span<const Mesh> meshes,
-                                                     const std::span<const MeshBuffers> mesh_buffers)
+                                                     const std::span<const MeshBuffers> mesh_buffers,
+                                                     const MeshletSettings& meshlet_settings = {})
 {
-    std::vector<MeshRenderer> mesh_renderers;
+    const MeshletSettings limits = ClampMeshletSettings(meshlet_settings);
+    // Model::cull_datas holds the meshlets of every mesh one mesh after the other.
+    std::vector<uint32_t> bounding_offsets(meshes.size());
     uint32_t bounding_offset = 0;
-    for (const auto& node : nodes)
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        bounding_offsets[i] = bounding_offset;
+        bounding_offset += static_cast<uint32_t>(meshes[i].meshlets.size());
+    }
+
+    std::vector<MeshRenderer> mesh_renderers;
+    mesh_renderers.reserve(mesh_instances.size());
+    for (const auto& [mesh_index, instance_offset, instance_count] : mesh_instances)
     {
-        const auto& mesh = meshes[node.mesh_index];
-        const auto& mesh_buffer = mesh_buffers[node.mesh_index];
+        const auto& mesh = meshes[mesh_index];
+        const auto& mesh_buffer = mesh_buffers[mesh_index];
+        // Meshes without generated levels still get level 0.
+        std::array<MeshLod, k_max_lod_count> lods{};
+        lods[0] = {.meshlet_offset = 0, .meshlet_count = static_cast<uint32_t>(mesh.meshlets.size()), .error = 0.f};
+        const auto lod_count = static_cast<uint32_t>(std::clamp<size_t>(mesh.lods.size(), 1, k_max_lod_count));
+        std::copy_n(mesh.lods.begin(), std::min<size_t>(mesh.lods.size(), k_max_lod_count), lods.begin());
         MeshRenderer mesh_renderer{
             .m_vertex_buffer = mesh_buffer.m_vertex_buffer_srv->GetDescriptorIndex(),
             .m_mesh_buffer = mesh_buffer.m_mesh_buffer_srv->GetDescriptorIndex(),
@@ -136,15 +220,58 @@ inline std::vector<MeshRenderer> CreateMeshRenderers(const std::span<const Node>
             .m_mesh_triangle_buffer = mesh_buffer.m_mesh_triangle_buffer_srv->GetDescriptorIndex(),
             .m_meshlet_count = static_cast<uint32_t>(mesh.meshlets.size()),
             .m_material_index = mesh.material_index,
-            .m_transform_index = node.transform_index,
-            .m_bounding_offset = bounding_offset,
+            .m_instance_offset = instance_offset,
+            .m_instance_count = instance_count,
+            .m_bounding_offset = bounding_offsets[mesh_index],
+            .m_quantized = !mesh.quantized_vertices.empty(),
+            .m_position_offset = mesh.position_offset,
+            .m_position_scale = mesh.position_scale,
+            .m_lods = lods,
+            .m_lod_count = lod_count,
+            .m_center = mesh.center,
+            .m_radius = mesh.radius,
+            .m_amplification_group_size = limits.amplification_group_size,
         };
-        bounding_offset += mesh.meshlets.size();
         mesh_renderers.push_back(mesh_renderer);
     }
     return mesh_renderers;
 }
 
+// One per renderer in the same order, for the buffer MeshletCullConstants::mesh_buffer points to. The caller sets
+// constants.meshlet_list once the list exists, GetMaxMeshletListSize sizes it from these.
+inline std::vector<MeshletCullMesh> CreateMeshletCullMeshes(const std::span<const MeshRenderer> mesh_renderers,
+                                                            const uint32_t sampler_index)
+{
+    std::vector<MeshletCullMesh> cull_meshes;
+    cull_meshes.reserve(mesh_renderers.size());
+    for (const auto& mesh_renderer : mesh_renderers)
+    {
+        cull_meshes.push_back({
+            .constants = mesh_renderer.GetDrawConstants(sampler_index),
+            .bounding_offset = mesh_renderer.m_bounding_offset,
+            .center = mesh_renderer.m_center,
+            .radius = mesh_renderer.m_radius,
+            .lod_count = mesh_renderer.m_lod_count,
+            .lods = mesh_renderer.m_lods,
+        });
+    }
+    return cull_meshes;
+}
+
+// Every instance of every renderer, the cull pass runs one group for each.
+inline std::vector<MeshletCullInstance> CreateMeshletCullInstances(const std::span<const MeshRenderer> mesh_renderers)
+{
+    std::vector<MeshletCullInstance> cull_instances;
+    for (uint32_t i = 0; i < mesh_renderers.size(); ++i)
+    {
+        for (uint32_t j = 0; j < mesh_renderers[i].m_instance_count; ++j)
+        {
+            cull_instances.push_back({.mesh_index = i, .instance_index = mesh_renderers[i].m_instance_offset + j});
+        }
+    }
+    return cull_instances;
+}
+
 inline std::vector<TextureView> CreateTextures(Swift::IContext* context,
                                                const std::span<Texture> textures,
                                                std::span<Material> materials)
@@ -155,7 +282,8 @@ inline std::vector<TextureView> CreateTextures(Swift::IContext* context,
         auto* t = Swift::TextureBuilder(context, texture.width, texture.height)
                       .SetFormat(texture.format)
                       .SetArraySize(texture.array_size)
-                      .SetMipmapLevels(1)
+                      .SetFlags(texture.is_cube ? Swift::TextureFlags::eCube : Swift::TextureFlags::eNone)
+                      .SetMipmapLevels(texture.mip_levels)
                       .SetData(texture.pixels.data())
                       .SetGenMipMaps(false)
                       .SetName(texture.name)
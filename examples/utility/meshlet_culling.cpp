@@ -0,0 +1,211 @@
+#include "meshlet_culling.hpp"
+#include "algorithm"
+#include "cmath"
+#include "iterator"
+#include "numeric"
+#include "utility"
+#include "glm/geometric.hpp"
+#include "glm/mat3x3.hpp"
+
+namespace
+{
+    // Largest axis scale of the transform, radii grow by it.
+    float GetScale(const glm::mat4& transform)
+    {
+        return std::max({glm::length(glm::vec3(transform[0])),
+                         glm::length(glm::vec3(transform[1])),
+                         glm::length(glm::vec3(transform[2]))});
+    }
+
+    bool IsInFrustum(const std::array<glm::vec4, 6>& planes, const glm::vec3& center, const float radius)
+    {
+        return std::ranges::all_of(planes,
+                                   [&](const glm::vec4& plane)
+                                   { return glm::dot(glm::vec3(plane), center) + plane.w >= -radius; });
+    }
+
+    // True when the transform only rotates, mirrors and scales the same along every axis. Otherwise the normals of a
+    // meshlet bend by different angles, and its cone no longer bounds them.
+    bool HasUniformScale(const glm::mat4& transform)
+    {
+        constexpr float k_tolerance = 1e-3f;
+        const glm::mat3 basis(transform);
+        const float scale = glm::dot(basis[0], basis[0]);
+        return std::abs(glm::dot(basis[1], basis[1]) - scale) <= k_tolerance * scale &&
+               std::abs(glm::dot(basis[2], basis[2]) - scale) <= k_tolerance * scale &&
+               std::abs(glm::dot(basis[0], basis[1])) <= k_tolerance * scale &&
+               std::abs(glm::dot(basis[0], basis[2])) <= k_tolerance * scale &&
+               std::abs(glm::dot(basis[1], basis[2])) <= k_tolerance * scale;
+    }
+
+    // The axis is stored as signed bytes in the low three bytes of CullData::cone_packed and the cutoff in the top
+    // one, see Importer::PackCone. A cutoff of 1 or more never culls. Only called for transforms with a uniform scale,
+    // under which the axis turns like any other direction.
+    bool IsConeBackfacing(const CullData& cull_data, const glm::mat4& transform, const glm::vec3& camera_position)
+    {
+        const auto unpack = [&cull_data](const uint32_t shift)
+        { return static_cast<float>(static_cast<int8_t>(cull_data.cone_packed >> shift)) / 127.f; };
+        const float cutoff = unpack(24);
+        if (cutoff >= 1.f)
+        {
+            return false;
+        }
+        const glm::vec3 axis = glm::normalize(glm::mat3(transform) * glm::vec3(unpack(0), unpack(8), unpack(16)));
+        const glm::vec3 apex(transform * glm::vec4(cull_data.cone_apex, 1.f));
+        return glm::dot(glm::normalize(apex - camera_position), axis) >= cutoff;
+    }
+}  // namespace
+
+std::array<glm::vec4, 6> GetFrustumPlanes(const glm::mat4& view_proj)
+{
+    // Rows of the matrix, clip space depth runs from 0 to 1.
+    const auto row = [&view_proj](const int i)
+    { return glm::vec4(view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]); };
+    std::array planes{
+        row(3) + row(0),
+        row(3) - row(0),
+        row(3) + row(1),
+        row(3) - row(1),
+        row(2),
+        row(3) - row(2),
+    };
+    for (auto& plane : planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
+
+MeshletCullConstants GetMeshletCullConstants(const MeshletCullView& view)
+{
+    uint32_t flags = 0;
+    for (const auto flag : {MeshletCullFlags::eFrustum, MeshletCullFlags::eCone})
+    {
+        flags |= view.flags & flag ? static_cast<uint32_t>(flag) : 0;
+    }
+    return MeshletCullConstants{
+        .frustum_planes = GetFrustumPlanes(view.view_proj),
+        .view_proj = view.view_proj,
+        .camera_position = view.camera_position,
+        .projection_scale = view.projection_scale,
+        .max_pixel_error = view.max_pixel_error,
+        .flags = flags,
+    };
+}
+
+uint32_t GetMaxMeshletCommands(const std::span<const MeshletCullInstance> instances)
+{
+    return static_cast<uint32_t>(instances.size());
+}
+
+uint32_t GetMaxMeshletListSize(const std::span<const MeshletCullMesh> meshes,
+                               const std::span<const MeshletCullInstance> instances)
+{
+    return std::accumulate(instances.begin(),
+                           instances.end(),
+                           0u,
+                           [meshes](const uint32_t sum, const MeshletCullInstance& instance)
+                           { return sum + meshes[instance.mesh_index].lods[0].meshlet_count; });
+}
+
+void CullMeshlets(const MeshletCullView& view, const MeshletCullInput& input, MeshletCullOutput& output)
+{
+    output.commands.clear();
+    output.meshlet_list.clear();
+
+    const auto planes = GetFrustumPlanes(view.view_proj);
+    const bool frustum = view.flags & MeshletCullFlags::eFrustum;
+    const bool cone = view.flags & MeshletCullFlags::eCone;
+    const auto is_visible = [&](const glm::vec3& center, const float radius)
+    { return !frustum || IsInFrustum(planes, center, radius); };
+
+    for (const auto& [mesh_index, instance_index] : input.instances)
+    {
+        const auto& instance_bounds = input.instance_cull_datas[instance_index];
+        if (!is_visible(instance_bounds.center, instance_bounds.radius))
+        {
+            continue;
+        }
+
+        const auto& mesh = input.meshes[mesh_index];
+        const auto& transform = input.transforms[instance_index];
+        const uint32_t lod = SelectLod(std::span(mesh.lods.data(), mesh.lod_count),
+                                       mesh.center,
+                                       mesh.radius,
+                                       transform,
+                                       view.camera_position,
+                                       view.projection_scale,
+                                       view.max_pixel_error);
+        const float scale = GetScale(transform);
+        const bool instance_cone = cone && HasUniformScale(transform);
+        const auto list_offset = static_cast<uint32_t>(output.meshlet_list.size());
+        const auto& [meshlet_offset, meshlet_count, error] = mesh.lods[lod];
+        for (uint32_t i = meshlet_offset; i < meshlet_offset + meshlet_count; ++i)
+        {
+            const auto& cull_data = input.cull_datas[mesh.bounding_offset + i];
+            const glm::vec3 center(transform * glm::vec4(cull_data.center, 1.f));
+            if (is_visible(center, cull_data.radius * scale) &&
+                (!instance_cone || !IsConeBackfacing(cull_data, transform, view.camera_position)))
+            {
+                output.meshlet_list.push_back(i);
+            }
+        }
+
+        const auto visible_count = static_cast<uint32_t>(output.meshlet_list.size()) - list_offset;
+        if (visible_count == 0)
+        {
+            continue;
+        }
+        MeshletDrawCommand command{
+            .constants = mesh.constants,
+            .group_x = visible_count,
+            .group_y = 1,
+            .group_z = 1,
+        };
+        command.constants.instance_offset = instance_index;
+        command.constants.meshlet_offset = list_offset;
+        output.commands.push_back(command);
+    }
+}
+
+std::vector<uint32_t> GetMeshletCullMismatches(const MeshletCullOutput& expected,
+                                               const std::span<const MeshletDrawCommand> commands,
+                                               const std::span<const uint32_t> meshlet_list)
+{
+    // Instance and meshlet pairs, sorted so both sides compare as sets.
+    using DrawnMeshlet = std::pair<uint32_t, uint32_t>;
+    std::vector<uint32_t> mismatches;
+    const auto collect = [&mismatches](const std::span<const MeshletDrawCommand> draws, const std::span<const uint32_t> list)
+    {
+        std::vector<DrawnMeshlet> drawn;
+        for (const auto& command : draws)
+        {
+            const uint32_t instance_index = command.constants.instance_offset;
+            const uint32_t offset = command.constants.meshlet_offset;
+            if (offset > list.size() || command.group_x > list.size() - offset)
+            {
+                mismatches.push_back(instance_index);
+                continue;
+            }
+            for (const uint32_t meshlet : list.subspan(offset, command.group_x))
+            {
+                drawn.emplace_back(instance_index, meshlet);
+            }
+        }
+        std::ranges::sort(drawn);
+        return drawn;
+    };
+    const auto expected_drawn = collect(expected.commands, expected.meshlet_list);
+    const auto drawn = collect(commands, meshlet_list);
+
+    std::vector<DrawnMeshlet> difference;
+    std::ranges::set_symmetric_difference(expected_drawn, drawn, std::back_inserter(difference));
+    for (const auto& [instance_index, meshlet] : difference)
+    {
+        mismatches.push_back(instance_index);
+    }
+    std::ranges::sort(mismatches);
+    const auto [first, last] = std::ranges::unique(mismatches);
+    mismatches.erase(first, last);
+    return mismatches;
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include "enum_flags.hpp"
+#include "lod.hpp"
+#include "array"
+#include "cstdint"
+#include "span"
+#include "vector"
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+
+struct CullData
+{
+    glm::vec3 center{};
+    float radius{};
+    glm::vec3 cone_apex;
+    uint32_t cone_packed;
+};
+
+// World space bounding sphere of one instance.
+struct InstanceCullData
+{
+    glm::vec3 center{};
+    float radius{};
+};
+
+// Marks a descriptor index as unused, for MeshletDrawConstants::meshlet_list.
+constexpr uint32_t k_invalid_descriptor = ~0u;
+
+// The root constants of a meshlet draw, PushConstant in hello_pbr_inc.slang. The mesh shader draws meshlet_offset +
+// gid.x of instance_offset + gid.y. With a meshlet_list it draws the meshlet at meshlet_offset + gid.x in that list.
+struct MeshletDrawConstants
+{
+    uint32_t sampler_index;
+    uint32_t vertex_buffer;
+    uint32_t meshlet_buffer;
+    uint32_t mesh_vertex_buffer;
+    uint32_t mesh_triangle_buffer;
+    int material_index;
+    uint32_t instance_offset;
+    uint32_t quantized;
+    glm::vec3 position_offset;
+    float padding;
+    glm::vec3 position_scale;
+    uint32_t meshlet_offset;
+    uint32_t meshlet_list = k_invalid_descriptor;
+};
+
+// One per indirect draw: the root constants, then the DispatchMesh groups. The matching signature is the
+// CommandSignatureBuilder with AddPushConstants(sizeof(MeshletDrawConstants)) and AddMeshDispatch() in hello_pbr.
+struct MeshletDrawCommand
+{
+    MeshletDrawConstants constants;
+    uint32_t group_x;
+    uint32_t group_y;
+    uint32_t group_z;
+};
+
+// What the cull pass knows about a mesh, one per MeshRenderer. constants is copied into every command that draws it,
+// with meshlet_list set to the shader resource view of MeshletCullConstants::meshlet_list_buffer.
+struct MeshletCullMesh
+{
+    MeshletDrawConstants constants;
+    // First meshlet of the mesh in Model::cull_datas.
+    uint32_t bounding_offset;
+    glm::vec3 center;
+    float radius;
+    uint32_t lod_count;
+    std::array<MeshLod, k_max_lod_count> lods;
+};
+
+// One per instance of a mesh, instance_index points into Model::instance_transforms and Model::instance_cull_datas.
+struct MeshletCullInstance
+{
+    uint32_t mesh_index;
+    uint32_t instance_index;
+};
+
+// The tests the cull pass runs. The cone test is skipped for instances scaled differently along their axes, whose
+// normal cones no longer bound the normals.
+enum class MeshletCullFlags : uint32_t
+{
+    eNone = 0,
+    eFrustum = 1 << 0,
+    eCone = 1 << 1,
+};
+
+struct MeshletCullView
+{
+    glm::mat4 view_proj;
+    glm::vec3 camera_position;
+    // See GetLodProjectionScale, the level of every instance is picked the way SelectLod does.
+    float projection_scale;
+    float max_pixel_error = 1.f;
+    EnumFlags<MeshletCullFlags> flags = EnumFlags(MeshletCullFlags::eFrustum) | MeshletCullFlags::eCone;
+};
+
+// Constant buffer of meshlet_cull.slang. The descriptor indices are filled in by the caller, the rest comes from
+// GetMeshletCullConstants.
+struct MeshletCullConstants
+{
+    // Normalized, inside is where dot(plane.xyz, p) + plane.w >= 0. Left, right, bottom, top, near, far.
+    std::array<glm::vec4, 6> frustum_planes;
+    glm::mat4 view_proj;
+
+    glm::vec3 camera_position;
+    float projection_scale;
+
+    float max_pixel_error;
+    // MeshletCullFlags.
+    uint32_t flags;
+    uint32_t instance_count;
+    uint32_t max_commands;
+
+    uint32_t mesh_buffer;
+    uint32_t instance_buffer;
+    uint32_t cull_data_buffer;
+    uint32_t transform_buffer;
+
+    uint32_t instance_cull_data_buffer;
+    uint32_t command_buffer;
+    uint32_t meshlet_list_buffer;
+    uint32_t max_meshlets;
+
+    // Index of the command count in counter_buffer, the meshlet count follows it.
+    uint32_t counter_buffer;
+    uint32_t counter_index;
+    uint32_t padding[2];
+};
+
+// Everything the cull pass reads, as the buffers of MeshletCullConstants hold it.
+struct MeshletCullInput
+{
+    std::span<const MeshletCullMesh> meshes;
+    std::span<const MeshletCullInstance> instances;
+    std::span<const CullData> cull_datas;
+    std::span<const glm::mat4> transforms;
+    std::span<const InstanceCullData> instance_cull_datas;
+};
+
+struct MeshletCullOutput
+{
+    std::vector<MeshletDrawCommand> commands;
+    // Meshlet indices into Mesh::meshlets, every command draws a range of it.
+    std::vector<uint32_t> meshlet_list;
+};
+
+std::array<glm::vec4, 6> GetFrustumPlanes(const glm::mat4& view_proj);
+MeshletCullConstants GetMeshletCullConstants(const MeshletCullView& view);
+
+// Commands the cull pass may write at most, one per instance, and the meshlet list entries it may need. The GPU
+// reserves the meshlets of an instance's level before testing them, so the list is sized for level 0 of every instance.
+uint32_t GetMaxMeshletCommands(std::span<const MeshletCullInstance> instances);
+uint32_t GetMaxMeshletListSize(std::span<const MeshletCullMesh> meshes, std::span<const MeshletCullInstance> instances);
+
+// The tests of meshlet_cull.slang, to check what it writes on any platform. Instances that pass get one command with
+// the meshlets that pass, in instance order and with a packed list. The GPU writes them in whatever order its groups
+// finish and leaves gaps in the list, so compare the meshlets drawn per instance.
+void CullMeshlets(const MeshletCullView& view, const MeshletCullInput& input, MeshletCullOutput& output);
+
+// Instances whose drawn meshlets differ between expected and the commands and list the GPU wrote, in ascending order.
+// Commands that point past the list count as a difference of their instance.
+std::vector<uint32_t> GetMeshletCullMismatches(const MeshletCullOutput& expected,
+                                               std::span<const MeshletDrawCommand> commands,
+                                               std::span<const uint32_t> meshlet_list);
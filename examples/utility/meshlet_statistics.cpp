@@ -0,0 +1,113 @@
+#include "meshlet_statistics.hpp"
+#include "importer.hpp"
+#include "algorithm"
+#include "glm/geometric.hpp"
+
+namespace
+{
+    struct MeshletSums
+    {
+        size_t meshlet_count = 0;
+        size_t triangle_count = 0;
+        double vertex_fill = 0.0;
+        double triangle_fill = 0.0;
+        double bounds_tightness = 0.0;
+        size_t cone_cullable = 0;
+        double culled_triangles = 0.0;
+    };
+
+    // The cutoff is stored as the top byte of CullData::cone_packed, see Importer::PackCone.
+    float GetConeCutoff(const uint32_t cone_packed)
+    {
+        return std::clamp(static_cast<float>(static_cast<int8_t>(cone_packed >> 24)) / 127.f, -1.f, 1.f);
+    }
+
+    void AddMesh(MeshletSums& sums,
+                 const Mesh& mesh,
+                 const std::span<const CullData> cull_datas,
+                 const MeshletSettings& settings)
+    {
+        const auto get_position = [&mesh](const uint32_t index)
+        {
+            if (!mesh.vertices.empty())
+            {
+                return mesh.vertices[index].position;
+            }
+            return DecodeVertex(mesh.quantized_vertices[index], mesh.position_offset, mesh.position_scale).position;
+        };
+
+        const size_t count = std::min(mesh.meshlets.size(), cull_datas.size());
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto& meshlet = mesh.meshlets[i];
+            const auto& cull_data = cull_datas[i];
+            sums.meshlet_count++;
+            sums.triangle_count += meshlet.triangle_count;
+            sums.vertex_fill += static_cast<double>(meshlet.vertex_count) / settings.max_vertices;
+            sums.triangle_fill += static_cast<double>(meshlet.triangle_count) / settings.max_triangles;
+
+            if (cull_data.radius > 0.f && meshlet.vertex_count > 0)
+            {
+                double distance = 0.0;
+                for (uint32_t v = 0; v < meshlet.vertex_count; ++v)
+                {
+                    const uint32_t index = mesh.meshlet_vertices[meshlet.vertex_offset + v];
+                    distance += glm::distance(cull_data.center, get_position(index));
+                }
+                sums.bounds_tightness += std::min(distance / meshlet.vertex_count / cull_data.radius, 1.0);
+            }
+
+            // A meshlet is culled when the direction from the camera to the apex lies within the cone of directions
+            // around the axis whose cosine is above the cutoff, (1 - cutoff) / 2 of the sphere of directions.
+            const float cutoff = GetConeCutoff(cull_data.cone_packed);
+            if (cutoff < 1.f)
+            {
+                sums.cone_cullable++;
+                sums.culled_triangles += (1.0 - cutoff) * 0.5 * meshlet.triangle_count;
+            }
+        }
+    }
+
+    MeshletStatistics GetAverages(const MeshletSums& sums)
+    {
+        if (sums.meshlet_count == 0)
+        {
+            return {};
+        }
+        const auto meshlet_count = static_cast<double>(sums.meshlet_count);
+        return MeshletStatistics{
+            .meshlet_count = sums.meshlet_count,
+            .triangle_count = sums.triangle_count,
+            .vertex_fill = static_cast<float>(sums.vertex_fill / meshlet_count),
+            .triangle_fill = static_cast<float>(sums.triangle_fill / meshlet_count),
+            .bounds_tightness = static_cast<float>(sums.bounds_tightness / meshlet_count),
+            .cone_cullable = static_cast<float>(static_cast<double>(sums.cone_cullable) / meshlet_count),
+            .cone_cull_rate = sums.triangle_count != 0
+                                  ? static_cast<float>(sums.culled_triangles / static_cast<double>(sums.triangle_count))
+                                  : 0.f,
+        };
+    }
+}  // namespace
+
+MeshletStatistics GetMeshletStatistics(const Mesh& mesh,
+                                       const std::span<const CullData> cull_datas,
+                                       const MeshletSettings& settings)
+{
+    MeshletSums sums{};
+    AddMesh(sums, mesh, cull_datas, ClampMeshletSettings(settings));
+    return GetAverages(sums);
+}
+
+MeshletStatistics GetMeshletStatistics(const Model& model, const MeshletSettings& settings)
+{
+    const MeshletSettings limits = ClampMeshletSettings(settings);
+    MeshletSums sums{};
+    size_t cull_data_offset = 0;
+    for (const auto& mesh : model.meshes)
+    {
+        const size_t count = std::min(mesh.meshlets.size(), model.cull_datas.size() - cull_data_offset);
+        AddMesh(sums, mesh, std::span(model.cull_datas).subspan(cull_data_offset, count), limits);
+        cull_data_offset += count;
+    }
+    return GetAverages(sums);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "cstddef"
+#include "span"
+
+struct CullData;
+struct Mesh;
+struct MeshletSettings;
+struct Model;
+
+// Averaged over meshlets unless noted, every level of detail included.
+struct MeshletStatistics
+{
+    size_t meshlet_count = 0;
+    size_t triangle_count = 0;
+    // Vertices and triangles per meshlet over MeshletSettings::max_vertices and max_triangles. Low fill wastes mesh
+    // shader threads and output space.
+    float vertex_fill = 0.f;
+    float triangle_fill = 0.f;
+    // Distance of the meshlet vertices from the center of the bounding sphere over its radius. The lower it is the
+    // more of the sphere is empty space that passes frustum and occlusion culling for nothing.
+    float bounds_tightness = 0.f;
+    // Share of meshlets whose normal cone is narrow enough to ever be backface culled.
+    float cone_cullable = 0.f;
+    // Share of triangles the cone test culls, averaged over uniformly distributed view directions.
+    float cone_cull_rate = 0.f;
+};
+
+// cull_datas holds the bounds of mesh.meshlets in the same order, as LoadMesh lays them out in Model::cull_datas.
+MeshletStatistics GetMeshletStatistics(const Mesh& mesh,
+                                       std::span<const CullData> cull_datas,
+                                       const MeshletSettings& settings);
+
+// Over every mesh of the model, weighted by meshlet count.
+MeshletStatistics GetMeshletStatistics(const Model& model, const MeshletSettings& settings);
@@ -0,0 +1,406 @@
+#include "mip_generator.hpp"
+#include "importer.hpp"
+#include "parallel.hpp"
+#include "algorithm"
+#include "array"
+#include "cmath"
+#include "numbers"
+#include "simd.hpp"
+
+namespace
+{
+    constexpr uint32_t k_channels = 4;
+    constexpr uint32_t k_max_taps = 8;
+    // Levels smaller than this are not worth spreading over threads.
+    constexpr uint32_t k_parallel_texels = 128 * 128;
+
+    struct Image
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<float> texels;
+
+        float* GetRow(const uint32_t y) { return texels.data() + static_cast<size_t>(y) * width * k_channels; }
+        const float* GetRow(const uint32_t y) const { return texels.data() + static_cast<size_t>(y) * width * k_channels; }
+    };
+
+    // Output texel x reads source texels x * scale + offsets[i].
+    struct FilterTaps
+    {
+        uint32_t scale = 1;
+        uint32_t count = 0;
+        std::array<int32_t, k_max_taps> offsets{};
+        std::array<float, k_max_taps> weights{};
+    };
+
+    float SRGBToLinear(const float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    const std::array<float, 256>& GetSRGBDecodeTable()
+    {
+        static const auto table = []
+        {
+            std::array<float, 256> values{};
+            for (uint32_t i = 0; i < values.size(); ++i)
+            {
+                values[i] = SRGBToLinear(static_cast<float>(i) / 255.f);
+            }
+            return values;
+        }();
+        return table;
+    }
+
+    // Linear values of the midpoints between two sRGB codes, searching it rounds exactly in sRGB space.
+    const std::array<float, 255>& GetSRGBEncodeThresholds()
+    {
+        static const auto table = []
+        {
+            std::array<float, 255> values{};
+            for (uint32_t i = 0; i < values.size(); ++i)
+            {
+                values[i] = SRGBToLinear((static_cast<float>(i) + 0.5f) / 255.f);
+            }
+            return values;
+        }();
+        return table;
+    }
+
+    uint8_t LinearToSRGB8(const float value)
+    {
+        const auto& thresholds = GetSRGBEncodeThresholds();
+        return static_cast<uint8_t>(std::upper_bound(thresholds.begin(), thresholds.end(), value) - thresholds.begin());
+    }
+
+    uint8_t ToUnorm8(const float value) { return static_cast<uint8_t>(std::lround(std::clamp(value, 0.f, 1.f) * 255.f)); }
+
+    float Sinc(const float x)
+    {
+        if (std::abs(x) < 1e-6f) return 1.f;
+        return std::sin(std::numbers::pi_v<float> * x) / (std::numbers::pi_v<float> * x);
+    }
+
+    float BesselI0(const float x)
+    {
+        float sum = 1.f;
+        float term = 1.f;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= x * x / (4.f * static_cast<float>(k * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    float Kaiser(const float x, const float width, const float alpha)
+    {
+        const float t = x / width;
+        if (std::abs(t) >= 1.f) return 0.f;
+        return BesselI0(alpha * std::sqrt(1.f - t * t)) / BesselI0(alpha);
+    }
+
+    FilterTaps GetFilterTaps(const MipFilter filter, const bool downsample)
+    {
+        if (!downsample)
+        {
+            return {.scale = 1, .count = 1, .offsets = {0}, .weights = {1.f}};
+        }
+
+        if (filter == MipFilter::eBox)
+        {
+            return {.scale = 2, .count = 2, .offsets = {0, 1}, .weights = {0.5f, 0.5f}};
+        }
+
+        // Kaiser windowed sinc over three source texels on each side, distances are in destination texels.
+        constexpr float width = 1.5f;
+        constexpr float alpha = 4.f;
+        FilterTaps taps{.scale = 2, .count = 6};
+        float total = 0.f;
+        for (uint32_t i = 0; i < taps.count; ++i)
+        {
+            taps.offsets[i] = static_cast<int32_t>(i) - 2;
+            const float distance = (static_cast<float>(taps.offsets[i]) - 0.5f) * 0.5f;
+            taps.weights[i] = Sinc(distance) * Kaiser(distance, width, alpha);
+            total += taps.weights[i];
+        }
+        for (uint32_t i = 0; i < taps.count; ++i)
+        {
+            taps.weights[i] /= total;
+        }
+        return taps;
+    }
+
+    // dst[i] = sum(weights[k] * rows[k][i])
+    void WeightRows(float* dst, std::span<const float* const> rows, std::span<const float> weights, const uint32_t count)
+    {
+        uint32_t i = 0;
+#if defined(SWIFT_SIMD_AVX2) || defined(SWIFT_SIMD_SSE)
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (size_t k = 0; k < rows.size(); ++k)
+            {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+            }
+            _mm_storeu_ps(dst + i, sum);
+        }
+#elif defined(SWIFT_SIMD_NEON)
+        for (; i + 4 <= count; i += 4)
+        {
+            float32x4_t sum = vdupq_n_f32(0.f);
+            for (size_t k = 0; k < rows.size(); ++k)
+            {
+                sum = vaddq_f32(sum, vmulq_n_f32(vld1q_f32(rows[k] + i), weights[k]));
+            }
+            vst1q_f32(dst + i, sum);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            float sum = 0.f;
+            for (size_t k = 0; k < rows.size(); ++k)
+            {
+                sum += weights[k] * rows[k][i];
+            }
+            dst[i] = sum;
+        }
+    }
+
+    // Filters one row horizontally, every texel is a float4 so a texel maps to one 128 bit lane.
+    void WeightColumns(float* dst,
+                       const float* src,
+                       const uint32_t src_width,
+                       const uint32_t dst_width,
+                       const FilterTaps& taps)
+    {
+        const auto get_texel = [&](const uint32_t x, const uint32_t tap)
+        {
+            const int32_t src_x = static_cast<int32_t>(x * taps.scale) + taps.offsets[tap];
+            return src + std::clamp(src_x, 0, static_cast<int32_t>(src_width) - 1) * k_channels;
+        };
+
+        uint32_t x = 0;
+#if defined(SWIFT_SIMD_AVX2) || defined(SWIFT_SIMD_SSE)
+        for (; x < dst_width; ++x)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (uint32_t k = 0; k < taps.count; ++k)
+            {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(taps.weights[k]), _mm_loadu_ps(get_texel(x, k))));
+            }
+            _mm_storeu_ps(dst + x * k_channels, sum);
+        }
+#elif defined(SWIFT_SIMD_NEON)
+        for (; x < dst_width; ++x)
+        {
+            float32x4_t sum = vdupq_n_f32(0.f);
+            for (uint32_t k = 0; k < taps.count; ++k)
+            {
+                sum = vaddq_f32(sum, vmulq_n_f32(vld1q_f32(get_texel(x, k)), taps.weights[k]));
+            }
+            vst1q_f32(dst + x * k_channels, sum);
+        }
+#endif
+        for (; x < dst_width; ++x)
+        {
+            for (uint32_t c = 0; c < k_channels; ++c)
+            {
+                float sum = 0.f;
+                for (uint32_t k = 0; k < taps.count; ++k)
+                {
+                    sum += taps.weights[k] * get_texel(x, k)[c];
+                }
+                dst[x * k_channels + c] = sum;
+            }
+        }
+    }
+
+    // max_threads is passed on to ParallelFor, 1 reduces the rows on the calling thread.
+    Image Downsample(const Image& src, const MipFilter filter, const uint32_t max_threads)
+    {
+        Image dst{
+            .width = std::max(src.width / 2, 1u),
+            .height = std::max(src.height / 2, 1u),
+            .texels = {},
+        };
+        dst.texels.resize(static_cast<size_t>(dst.width) * dst.height * k_channels);
+
+        const FilterTaps horizontal = GetFilterTaps(filter, src.width > 1);
+        const FilterTaps vertical = GetFilterTaps(filter, src.height > 1);
+        const auto reduce_row = [&](const uint32_t y)
+        {
+            thread_local std::vector<float> scratch;
+            scratch.resize(static_cast<size_t>(src.width) * k_channels);
+
+            std::array<const float*, k_max_taps> rows{};
+            for (uint32_t k = 0; k < vertical.count; ++k)
+            {
+                const int32_t src_y = static_cast<int32_t>(y * vertical.scale) + vertical.offsets[k];
+                rows[k] = src.GetRow(std::clamp(src_y, 0, static_cast<int32_t>(src.height) - 1));
+            }
+            WeightRows(scratch.data(),
+                       std::span(rows.data(), vertical.count),
+                       std::span(vertical.weights.data(), vertical.count),
+                       src.width * k_channels);
+            WeightColumns(dst.GetRow(y), scratch.data(), src.width, dst.width, horizontal);
+        };
+
+        if (max_threads != 1 && dst.width * dst.height >= k_parallel_texels)
+        {
+            ParallelFor(dst.height, reduce_row, max_threads);
+        }
+        else
+        {
+            for (uint32_t y = 0; y < dst.height; ++y)
+            {
+                reduce_row(y);
+            }
+        }
+        return dst;
+    }
+
+    void RenormalizeNormals(Image& image)
+    {
+        for (size_t i = 0; i < image.texels.size(); i += k_channels)
+        {
+            float* texel = &image.texels[i];
+            const float x = texel[0] * 2.f - 1.f;
+            const float y = texel[1] * 2.f - 1.f;
+            const float z = texel[2] * 2.f - 1.f;
+            const float length = std::sqrt(x * x + y * y + z * z);
+            if (length < 1e-6f)
+            {
+                texel[0] = 0.5f;
+                texel[1] = 0.5f;
+                texel[2] = 1.f;
+                continue;
+            }
+            texel[0] = x / length * 0.5f + 0.5f;
+            texel[1] = y / length * 0.5f + 0.5f;
+            texel[2] = z / length * 0.5f + 0.5f;
+        }
+    }
+
+    Image Decode(const Texture& texture, const TextureUsage usage)
+    {
+        Image image{.width = texture.width, .height = texture.height, .texels = {}};
+        image.texels.resize(static_cast<size_t>(texture.width) * texture.height * k_channels);
+        const auto& decode_table = GetSRGBDecodeTable();
+        for (size_t i = 0; i < image.texels.size(); ++i)
+        {
+            const uint8_t value = texture.pixels[i];
+            const bool is_color = usage == TextureUsage::eColor && i % k_channels != 3;
+            image.texels[i] = is_color ? decode_table[value] : static_cast<float>(value) / 255.f;
+        }
+        return image;
+    }
+
+    void Encode(const Image& image, const TextureUsage usage, const float alpha_scale, uint8_t* dst)
+    {
+        for (size_t i = 0; i < image.texels.size(); ++i)
+        {
+            const float value = image.texels[i];
+            if (i % k_channels == 3)
+            {
+                dst[i] = ToUnorm8(value * alpha_scale);
+            }
+            else
+            {
+                dst[i] = usage == TextureUsage::eColor ? LinearToSRGB8(value) : ToUnorm8(value);
+            }
+        }
+    }
+
+    float ComputeAlphaCoverage(const Image& image, const float cutoff)
+    {
+        size_t covered = 0;
+        for (size_t i = 3; i < image.texels.size(); i += k_channels)
+        {
+            covered += image.texels[i] > cutoff ? 1 : 0;
+        }
+        return static_cast<float>(covered) / static_cast<float>(image.texels.size() / k_channels);
+    }
+
+    // Finds the alpha scale that makes the level pass the alpha test as often as mip 0 did.
+    float FindAlphaScale(const Image& image, const float cutoff, const float target_coverage)
+    {
+        float low = 0.f;
+        float high = 1.f;
+        float reference = cutoff;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (ComputeAlphaCoverage(image, reference) < target_coverage)
+            {
+                high = reference;
+            }
+            else
+            {
+                low = reference;
+            }
+            reference = (low + high) * 0.5f;
+        }
+
+        // Coverage is a step function, take whichever side of the step ends up closer.
+        const float low_error = std::abs(ComputeAlphaCoverage(image, low) - target_coverage);
+        const float high_error = std::abs(ComputeAlphaCoverage(image, high) - target_coverage);
+        reference = low_error <= high_error ? low : high;
+        return reference > 0.f ? cutoff / reference : 1.f;
+    }
+
+    void BuildMipChain(Texture& texture, const MipGenerationInfo& info, const uint32_t max_threads)
+    {
+        if (texture.mip_levels != 1 || texture.array_size != 1 || texture.format != Swift::Format::eRGBA8_UNORM)
+        {
+            return;
+        }
+
+        const uint32_t mip_levels =
+            static_cast<uint32_t>(std::floor(std::log2(std::max(texture.width, texture.height)))) + 1;
+        size_t total_size = 0;
+        for (uint32_t mip = 0; mip < mip_levels; ++mip)
+        {
+            total_size += static_cast<size_t>(std::max(texture.width >> mip, 1u)) * std::max(texture.height >> mip, 1u) *
+                          k_channels;
+        }
+
+        Image level = Decode(texture, info.usage);
+        const float target_coverage = info.alpha_cutoff ? ComputeAlphaCoverage(level, *info.alpha_cutoff) : 0.f;
+
+        // Mip 0 is kept as is, only the generated levels are appended.
+        texture.pixels.resize(total_size);
+        size_t offset = static_cast<size_t>(texture.width) * texture.height * k_channels;
+        for (uint32_t mip = 1; mip < mip_levels; ++mip)
+        {
+            level = Downsample(level, info.filter, max_threads);
+            if (info.usage == TextureUsage::eNormal)
+            {
+                RenormalizeNormals(level);
+            }
+
+            const float alpha_scale =
+                info.alpha_cutoff ? FindAlphaScale(level, *info.alpha_cutoff, target_coverage) : 1.f;
+            Encode(level, info.usage, alpha_scale, texture.pixels.data() + offset);
+            offset += level.texels.size();
+        }
+        texture.mip_levels = static_cast<uint16_t>(mip_levels);
+    }
+}  // namespace
+
+void GenerateMipChain(Texture& texture, const MipGenerationInfo& info) { BuildMipChain(texture, info, 0); }
+
+void GenerateMipChains(std::vector<Texture>& textures,
+                       const std::span<const MipGenerationInfo> infos,
+                       const uint32_t max_threads)
+{
+    // A single texture spreads its rows over the threads instead, nesting both would oversubscribe.
+    if (textures.size() == 1)
+    {
+        BuildMipChain(textures[0], infos[0], max_threads);
+        return;
+    }
+    ParallelFor(
+        static_cast<uint32_t>(textures.size()),
+        [&](const uint32_t i) { BuildMipChain(textures[i], infos[i], 1); },
+        max_threads);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "cstdint"
+#include "optional"
+#include "span"
+#include "vector"
+
+struct Texture;
+
+enum class MipFilter
+{
+    eBox,
+    eKaiser,
+};
+
+enum class TextureUsage
+{
+    // sRGB encoded color, filtered in linear space.
+    eColor,
+    eLinear,
+    // Tangent space normal in rgb, renormalized after every level.
+    eNormal,
+};
+
+struct MipGenerationInfo
+{
+    TextureUsage usage = TextureUsage::eLinear;
+    MipFilter filter = MipFilter::eBox;
+    // When set, the fraction of texels passing this alpha test is kept the same on every level (AlphaMode::eMask).
+    std::optional<float> alpha_cutoff;
+};
+
+// Replaces the single RGBA8 level of the texture with the full mip chain, tightly packed from mip 0 down to 1x1.
+// Textures that already have mips or are not RGBA8 are left alone.
+void GenerateMipChain(Texture& texture, const MipGenerationInfo& info);
+
+// Same as GenerateMipChain for every texture, the textures are processed in parallel on up to max_threads threads.
+void GenerateMipChains(std::vector<Texture>& textures,
+                       std::span<const MipGenerationInfo> infos,
+                       uint32_t max_threads = 0);
@@ -0,0 +1,44 @@
+#pragma once
+#include "algorithm"
+#include "atomic"
+#include "cstdint"
+#include "thread"
+#include "vector"
+
+// Calls func(i) for every i in [0, count) spread over the hardware threads, the calling thread included. Work is handed
+// out one index at a time so the result only depends on what func writes for each index, not on scheduling.
+// max_threads caps the thread count, 0 uses every hardware thread.
+template<typename Func>
+void ParallelFor(const uint32_t count, Func&& func, const uint32_t max_threads = 0)
+{
+    uint32_t thread_count = std::min(std::max(std::thread::hardware_concurrency(), 1u), count);
+    if (max_threads != 0)
+    {
+        thread_count = std::min(thread_count, max_threads);
+    }
+    if (thread_count <= 1)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    std::atomic<uint32_t> next_index = 0;
+    const auto worker = [&]
+    {
+        for (uint32_t i = next_index++; i < count; i = next_index++)
+        {
+            func(i);
+        }
+    };
+
+    std::vector<std::jthread> threads;
+    threads.reserve(thread_count - 1);
+    for (uint32_t i = 1; i < thread_count; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+}
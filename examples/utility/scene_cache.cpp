@@ -0,0 +1,541 @@
+#include "scene_cache.hpp"
+#include "importer.hpp"
+#include "mapped_file.hpp"
+#include "json.hpp"
+#include "array"
+#include "bit"
+#include "charconv"
+#include "cstring"
+#include "filesystem"
+#include "format"
+#include "fstream"
+#include "string"
+#include "type_traits"
+#include "vector"
+
+namespace
+{
+    constexpr uint32_t k_scene_cache_magic = 0x43535753;  // "SWSC"
+    constexpr uint32_t k_glb_magic = 0x46546C67;          // "glTF"
+    constexpr uint32_t k_glb_json_chunk = 0x4E4F534A;     // "JSON"
+    constexpr uint64_t k_section_alignment = 16;
+
+    struct CacheArray
+    {
+        uint64_t offset;
+        uint64_t count;
+    };
+
+    struct CacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t source_hash;
+        uint64_t file_size;
+        CacheArray meshes;
+        CacheArray textures;
+        CacheArray samplers;
+        CacheArray nodes;
+        CacheArray materials;
+        CacheArray transforms;
+        CacheArray cull_datas;
+        CacheArray cluster_lods;
+        CacheArray mesh_instances;
+        CacheArray instance_transforms;
+        CacheArray instance_cull_datas;
+    };
+
+    struct CacheMesh
+    {
+        CacheArray name;
+        CacheArray meshlets;
+        CacheArray vertices;
+        CacheArray meshlet_vertices;
+        CacheArray meshlet_triangles;
+        CacheArray quantized_vertices;
+        CacheArray lods;
+        glm::vec3 position_offset;
+        glm::vec3 position_scale;
+        glm::vec3 center;
+        float radius;
+        int32_t material_index;
+        uint32_t padding;
+    };
+
+    struct CacheTexture
+    {
+        CacheArray name;
+        CacheArray pixels;
+        uint32_t sampler_index;
+        uint32_t width;
+        uint32_t height;
+        uint16_t mip_levels;
+        uint16_t array_size;
+        Swift::Format format;
+        uint32_t is_cube;
+    };
+
+    struct CacheSampler
+    {
+        CacheArray name;
+        Swift::Filter min_filter;
+        Swift::Filter mag_filter;
+        Swift::Wrap wrap_u;
+        Swift::Wrap wrap_y;
+    };
+
+    struct CacheNode
+    {
+        CacheArray name;
+        uint32_t transform_index;
+        int32_t mesh_index;
+    };
+
+    static_assert(std::is_trivially_copyable_v<Vertex>);
+    static_assert(std::is_trivially_copyable_v<QuantizedVertex>);
+    static_assert(std::is_trivially_copyable_v<MeshLod>);
+    static_assert(std::is_trivially_copyable_v<ClusterLod>);
+    static_assert(std::is_trivially_copyable_v<meshopt_Meshlet>);
+    static_assert(std::is_trivially_copyable_v<Material>);
+    static_assert(std::is_trivially_copyable_v<CullData>);
+    static_assert(std::is_trivially_copyable_v<glm::mat4>);
+    static_assert(std::is_trivially_copyable_v<MeshInstances>);
+    static_assert(std::is_trivially_copyable_v<InstanceCullData>);
+
+    uint64_t Mix(uint64_t value)
+    {
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCDull;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53ull;
+        value ^= value >> 33;
+        return value;
+    }
+
+    // Four independent lanes over 32 byte stripes keep the multiplies in flight, hashing a large scene has to stay far
+    // cheaper than importing it.
+    uint64_t HashBytes(const std::span<const uint8_t> data, const uint64_t seed)
+    {
+        constexpr uint64_t k_prime = 0x9E3779B97F4A7C15ull;
+        std::array<uint64_t, 4> lanes = {seed, seed + k_prime, seed - k_prime, ~seed};
+        size_t offset = 0;
+        for (; offset + 32 <= data.size(); offset += 32)
+        {
+            for (size_t lane = 0; lane < lanes.size(); ++lane)
+            {
+                uint64_t word;
+                std::memcpy(&word, data.data() + offset + lane * 8, sizeof(word));
+                lanes[lane] = Mix(lanes[lane] ^ word) * k_prime;
+            }
+        }
+
+        uint64_t hash = Mix(data.size() ^ seed);
+        for (const uint64_t lane : lanes)
+        {
+            hash = Mix(hash ^ lane);
+        }
+        for (; offset < data.size(); ++offset)
+        {
+            hash = Mix(hash ^ data[offset]);
+        }
+        return hash;
+    }
+
+    // URIs are percent encoded, the files on disk are not.
+    std::string DecodeUri(const std::string_view uri)
+    {
+        std::string decoded;
+        decoded.reserve(uri.size());
+        for (size_t i = 0; i < uri.size(); ++i)
+        {
+            const char* const digits = uri.data() + i + 1;
+            uint32_t value = 0;
+            if (uri[i] == '%' && i + 2 < uri.size() && std::from_chars(digits, digits + 2, value, 16).ptr == digits + 2)
+            {
+                decoded += static_cast<char>(value);
+                i += 2;
+                continue;
+            }
+            decoded += uri[i];
+        }
+        return decoded;
+    }
+
+    // The buffer and image files a .gltf or .glb refers to, data URIs are part of the source already.
+    std::vector<std::string> GetExternalUris(const std::span<const uint8_t> source)
+    {
+        // Magic, version, length, then the JSON chunk length and type of a GLB, a .gltf is all JSON.
+        std::span<const uint8_t> json_bytes = source;
+        std::array<uint32_t, 5> header{};
+        if (source.size() >= sizeof(header))
+        {
+            std::memcpy(header.data(), source.data(), sizeof(header));
+            if (header[0] == k_glb_magic && header[4] == k_glb_json_chunk && header[3] <= source.size() - sizeof(header))
+            {
+                json_bytes = source.subspan(sizeof(header), header[3]);
+            }
+        }
+
+        std::vector<std::string> uris;
+        const auto json = nlohmann::json::parse(json_bytes.begin(), json_bytes.end(), nullptr, false);
+        if (json.is_discarded())
+        {
+            return uris;
+        }
+        for (const auto* key : {"buffers", "images"})
+        {
+            const auto entries = json.find(key);
+            if (entries == json.end() || !entries->is_array())
+            {
+                continue;
+            }
+            for (const auto& entry : *entries)
+            {
+                if (const auto uri = entry.find("uri"); uri != entry.end() && uri->is_string())
+                {
+                    if (const auto& value = uri->get_ref<const std::string&>(); !value.starts_with("data:"))
+                    {
+                        uris.emplace_back(DecodeUri(value));
+                    }
+                }
+            }
+        }
+        return uris;
+    }
+
+    class CacheWriter
+    {
+    public:
+        explicit CacheWriter(const std::string& path) : m_file(path, std::ios::binary | std::ios::trunc)
+        {
+            const CacheHeader header{};
+            m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            m_offset = sizeof(header);
+        }
+
+        [[nodiscard]] bool IsGood() const { return m_file.good(); }
+        [[nodiscard]] uint64_t GetOffset() const { return m_offset; }
+
+        template <typename T> CacheArray Write(std::span<const T> data)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const uint64_t padding = (k_section_alignment - m_offset % k_section_alignment) % k_section_alignment;
+            constexpr std::array<char, k_section_alignment> zeros{};
+            m_file.write(zeros.data(), static_cast<std::streamsize>(padding));
+            m_offset += padding;
+
+            const CacheArray array{.offset = m_offset, .count = data.size()};
+            m_file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size_bytes()));
+            m_offset += data.size_bytes();
+            return array;
+        }
+
+        CacheArray Write(const std::string& string) { return Write(std::span(string.data(), string.size())); }
+
+        void WriteHeader(const CacheHeader& header)
+        {
+            m_file.seekp(0);
+            m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            m_file.close();
+        }
+
+    private:
+        std::ofstream m_file;
+        uint64_t m_offset = 0;
+    };
+
+    // Points straight into the mapping, after checking the array lies inside the file and is aligned for T.
+    template <typename T> bool GetArray(const std::span<const uint8_t> data, const CacheArray& array, std::span<const T>& out)
+    {
+        if (array.offset % alignof(T) != 0 || array.offset > data.size() ||
+            array.count > (data.size() - array.offset) / sizeof(T))
+        {
+            return false;
+        }
+        out = std::span(reinterpret_cast<const T*>(data.data() + array.offset), array.count);
+        return true;
+    }
+
+    bool GetString(const std::span<const uint8_t> data, const CacheArray& array, std::string& out)
+    {
+        std::span<const char> chars;
+        if (!GetArray(data, array, chars))
+        {
+            return false;
+        }
+        out.assign(chars.begin(), chars.end());
+        return true;
+    }
+
+    template <typename T> bool GetVector(const std::span<const uint8_t> data, const CacheArray& array, std::vector<T>& out)
+    {
+        std::span<const T> elements;
+        if (!GetArray(data, array, elements))
+        {
+            return false;
+        }
+        out.assign(elements.begin(), elements.end());
+        return true;
+    }
+}  // namespace
+
+uint64_t HashSceneSource(const std::span<const uint8_t> source, const std::string_view path, const ImportSettings& settings)
+{
+    const MeshletSettings meshlets = ClampMeshletSettings(settings.meshlets);
+    uint64_t seed = k_scene_cache_version;
+    for (const uint64_t value : {uint64_t(settings.generate_mips),
+                                 uint64_t(settings.mip_filter),
+                                 uint64_t(settings.compress_textures),
+                                 uint64_t(settings.compression_quality),
+                                 uint64_t(settings.quantize_vertices),
+                                 uint64_t(settings.lod_count),
+                                 uint64_t(std::bit_cast<uint32_t>(settings.lod_reduction)),
+                                 uint64_t(std::bit_cast<uint32_t>(settings.lod_target_error)),
+                                 uint64_t(settings.build_cluster_lod),
+                                 uint64_t(settings.optimize_vertex_cache),
+                                 uint64_t(settings.optimize_overdraw),
+                                 uint64_t(std::bit_cast<uint32_t>(settings.overdraw_threshold)),
+                                 uint64_t(settings.optimize_vertex_fetch),
+                                 uint64_t(settings.sort_meshlets),
+                                 uint64_t(meshlets.max_vertices),
+                                 uint64_t(meshlets.max_triangles),
+                                 uint64_t(meshlets.split),
+                                 uint64_t(std::bit_cast<uint32_t>(meshlets.cone_weight)),
+                                 uint64_t(std::bit_cast<uint32_t>(meshlets.fill_weight)),
+                                 uint64_t(sizeof(Vertex)),
+                                 uint64_t(sizeof(QuantizedVertex)),
+                                 uint64_t(sizeof(meshopt_Meshlet)),
+                                 uint64_t(sizeof(Material)),
+                                 uint64_t(sizeof(CullData)),
+                                 uint64_t(sizeof(MeshInstances))})
+    {
+        seed = Mix(seed ^ value);
+    }
+
+    // Hashing every external file would cost as much as reading it, its size and write time stand in for its bytes.
+    // A missing file is keyed too, so the cache is rebuilt once it shows up.
+    const auto base_dir = std::filesystem::path(path).parent_path();
+    for (const auto& uri : GetExternalUris(source))
+    {
+        std::error_code error;
+        const auto file = base_dir / uri;
+        const uint64_t size = std::filesystem::file_size(file, error);
+        const auto write_time = error ? std::filesystem::file_time_type{} : std::filesystem::last_write_time(file, error);
+        seed = Mix(seed ^ (error ? ~0ull : size));
+        seed = Mix(seed ^ static_cast<uint64_t>(write_time.time_since_epoch().count()));
+    }
+    return HashBytes(source, seed);
+}
+
+bool WriteSceneCache(const std::string_view path, const Model& model, const uint64_t source_hash)
+{
+    const std::string final_path(path);
+    const std::string temp_path = final_path + ".tmp";
+    bool written = false;
+    {
+        CacheWriter writer(temp_path);
+
+        std::vector<CacheMesh> meshes;
+        meshes.reserve(model.meshes.size());
+        for (const auto& mesh : model.meshes)
+        {
+            meshes.push_back(CacheMesh{
+                .name = writer.Write(mesh.name),
+                .meshlets = writer.Write(std::span(mesh.meshlets)),
+                .vertices = writer.Write(std::span(mesh.vertices)),
+                .meshlet_vertices = writer.Write(std::span(mesh.meshlet_vertices)),
+                .meshlet_triangles = writer.Write(std::span(mesh.meshlet_triangles)),
+                .quantized_vertices = writer.Write(std::span(mesh.quantized_vertices)),
+                .lods = writer.Write(std::span(mesh.lods)),
+                .position_offset = mesh.position_offset,
+                .position_scale = mesh.position_scale,
+                .center = mesh.center,
+                .radius = mesh.radius,
+                .material_index = mesh.material_index,
+                .padding = 0,
+            });
+        }
+
+        std::vector<CacheTexture> textures;
+        textures.reserve(model.textures.size());
+        for (const auto& texture : model.textures)
+        {
+            textures.push_back(CacheTexture{
+                .name = writer.Write(texture.name),
+                .pixels = writer.Write(std::span(texture.pixels)),
+                .sampler_index = texture.sampler_index,
+                .width = texture.width,
+                .height = texture.height,
+                .mip_levels = texture.mip_levels,
+                .array_size = texture.array_size,
+                .format = texture.format,
+                .is_cube = texture.is_cube,
+            });
+        }
+
+        std::vector<CacheSampler> samplers;
+        samplers.reserve(model.samplers.size());
+        for (const auto& sampler : model.samplers)
+        {
+            samplers.push_back(CacheSampler{
+                .name = writer.Write(sampler.name),
+                .min_filter = sampler.min_filter,
+                .mag_filter = sampler.mag_filter,
+                .wrap_u = sampler.wrap_u,
+                .wrap_y = sampler.wrap_y,
+            });
+        }
+
+        std::vector<CacheNode> nodes;
+        nodes.reserve(model.nodes.size());
+        for (const auto& node : model.nodes)
+        {
+            nodes.push_back(CacheNode{
+                .name = writer.Write(node.name),
+                .transform_index = node.transform_index,
+                .mesh_index = node.mesh_index,
+            });
+        }
+
+        CacheHeader header{
+            .magic = k_scene_cache_magic,
+            .version = k_scene_cache_version,
+            .source_hash = source_hash,
+            .file_size = 0,
+            .meshes = writer.Write(std::span<const CacheMesh>(meshes)),
+            .textures = writer.Write(std::span<const CacheTexture>(textures)),
+            .samplers = writer.Write(std::span<const CacheSampler>(samplers)),
+            .nodes = writer.Write(std::span<const CacheNode>(nodes)),
+            .materials = writer.Write(std::span(model.materials)),
+            .transforms = writer.Write(std::span(model.transforms)),
+            .cull_datas = writer.Write(std::span(model.cull_datas)),
+            .cluster_lods = writer.Write(std::span(model.cluster_lods)),
+            .mesh_instances = writer.Write(std::span(model.mesh_instances)),
+            .instance_transforms = writer.Write(std::span(model.instance_transforms)),
+            .instance_cull_datas = writer.Write(std::span(model.instance_cull_datas)),
+        };
+        header.file_size = writer.GetOffset();
+
+        if (writer.IsGood())
+        {
+            writer.WriteHeader(header);
+            written = writer.IsGood();
+        }
+    }
+
+    // The writer has closed the file by now, it cannot be removed while open on every platform.
+    std::error_code error;
+    if (!written)
+    {
+        printf(std::format("Error: failed to write scene cache {}\n", temp_path).c_str());
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+    std::filesystem::rename(temp_path, final_path, error);
+    if (error)
+    {
+        printf(std::format("Error: failed to write scene cache {}: {}\n", final_path, error.message()).c_str());
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
+
+std::optional<Model> ReadSceneCache(const std::string_view path, const uint64_t source_hash)
+{
+    const MappedFile file(path);
+    if (!file.IsOpen())
+    {
+        return std::nullopt;
+    }
+
+    const auto data = file.GetData();
+    CacheHeader header{};
+    if (data.size() < sizeof(header))
+    {
+        return std::nullopt;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != k_scene_cache_magic || header.version != k_scene_cache_version ||
+        header.source_hash != source_hash || header.file_size != data.size())
+    {
+        return std::nullopt;
+    }
+
+    std::span<const CacheMesh> meshes;
+    std::span<const CacheTexture> textures;
+    std::span<const CacheSampler> samplers;
+    std::span<const CacheNode> nodes;
+    Model model{};
+    bool valid = GetArray(data, header.meshes, meshes) && GetArray(data, header.textures, textures) &&
+                 GetArray(data, header.samplers, samplers) && GetArray(data, header.nodes, nodes) &&
+                 GetVector(data, header.materials, model.materials) &&
+                 GetVector(data, header.transforms, model.transforms) &&
+                 GetVector(data, header.cull_datas, model.cull_datas) &&
+                 GetVector(data, header.cluster_lods, model.cluster_lods) &&
+                 GetVector(data, header.mesh_instances, model.mesh_instances) &&
+                 GetVector(data, header.instance_transforms, model.instance_transforms) &&
+                 GetVector(data, header.instance_cull_datas, model.instance_cull_datas);
+
+    model.meshes.resize(meshes.size());
+    for (size_t i = 0; valid && i < meshes.size(); ++i)
+    {
+        const auto& cached = meshes[i];
+        auto& mesh = model.meshes[i];
+        valid = GetString(data, cached.name, mesh.name) && GetVector(data, cached.meshlets, mesh.meshlets) &&
+                GetVector(data, cached.vertices, mesh.vertices) &&
+                GetVector(data, cached.meshlet_vertices, mesh.meshlet_vertices) &&
+                GetVector(data, cached.meshlet_triangles, mesh.meshlet_triangles) &&
+                GetVector(data, cached.quantized_vertices, mesh.quantized_vertices) &&
+                GetVector(data, cached.lods, mesh.lods);
+        mesh.material_index = cached.material_index;
+        mesh.position_offset = cached.position_offset;
+        mesh.position_scale = cached.position_scale;
+        mesh.center = cached.center;
+        mesh.radius = cached.radius;
+    }
+
+    model.textures.resize(textures.size());
+    for (size_t i = 0; valid && i < textures.size(); ++i)
+    {
+        const auto& cached = textures[i];
+        auto& texture = model.textures[i];
+        valid = GetString(data, cached.name, texture.name) && GetVector(data, cached.pixels, texture.pixels);
+        texture.sampler_index = cached.sampler_index;
+        texture.width = cached.width;
+        texture.height = cached.height;
+        texture.mip_levels = cached.mip_levels;
+        texture.array_size = cached.array_size;
+        texture.format = cached.format;
+        texture.is_cube = cached.is_cube != 0;
+    }
+
+    model.samplers.resize(samplers.size());
+    for (size_t i = 0; valid && i < samplers.size(); ++i)
+    {
+        const auto& cached = samplers[i];
+        auto& sampler = model.samplers[i];
+        valid = GetString(data, cached.name, sampler.name);
+        sampler.min_filter = cached.min_filter;
+        sampler.mag_filter = cached.mag_filter;
+        sampler.wrap_u = cached.wrap_u;
+        sampler.wrap_y = cached.wrap_y;
+    }
+
+    model.nodes.resize(nodes.size());
+    for (size_t i = 0; valid && i < nodes.size(); ++i)
+    {
+        const auto& cached = nodes[i];
+        auto& node = model.nodes[i];
+        valid = GetString(data, cached.name, node.name);
+        node.transform_index = cached.transform_index;
+        node.mesh_index = cached.mesh_index;
+    }
+
+    if (!valid)
+    {
+        printf(std::format("Error: scene cache {} is corrupt\n", path).c_str());
+        return std::nullopt;
+    }
+    return model;
+}
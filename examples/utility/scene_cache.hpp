@@ -0,0 +1,22 @@
+#pragma once
+#include "cstdint"
+#include "optional"
+#include "span"
+#include "string_view"
+
+struct Model;
+struct ImportSettings;
+
+// Bump whenever a cached struct or the importer output changes, older caches are then rebuilt.
+constexpr uint32_t k_scene_cache_version = 7;
+
+// Identifies what a cache was baked from, the source bytes, the size and write time of the buffers and images it
+// refers to relative to path, the settings that change the output and the struct layouts.
+uint64_t HashSceneSource(std::span<const uint8_t> source, std::string_view path, const ImportSettings& settings);
+
+// Every array of the model is stored 16 byte aligned as it is laid out in memory, so reading it back is one copy per
+// array without any parsing. The file is written next to path and renamed over it once complete.
+bool WriteSceneCache(std::string_view path, const Model& model, uint64_t source_hash);
+
+// Maps the cache and returns the model when its version and source hash match.
+std::optional<Model> ReadSceneCache(std::string_view path, uint64_t source_hash);
@@ -9,7 +9,9 @@ ShaderCompiler::ShaderCompiler()
     slang::createGlobalSession(&desc, m_global_session.writeRef());
 }
 
-std::vector<uint8_t> ShaderCompiler::CompileShader(const std::string_view file_path, const ShaderStage stage) const
+std::vector<uint8_t> ShaderCompiler::CompileShader(const std::string_view file_path,
+                                                   const ShaderStage stage,
+                                                   const std::span<const ShaderDefine> defines) const
 {
     std::array options =
     {
@@ -32,11 +34,19 @@ std::vector<uint8_t> ShaderCompiler::CompileShader(const std::string_view file_p
         .compilerOptionEntries = options.data(),
         .compilerOptionEntryCount = options.size(),
     };
+    std::vector<slang::PreprocessorMacroDesc> macros;
+    macros.reserve(defines.size());
+    for (const auto& [name, value] : defines)
+    {
+        macros.push_back({.name = name.c_str(), .value = value.c_str()});
+    }
     const slang::SessionDesc session_desc{
         .structureSize = sizeof(slang::SessionDesc),
         .targets = &target_desc,
         .targetCount = 1,
         .defaultMatrixLayoutMode = SLANG_MATRIX_LAYOUT_COLUMN_MAJOR,
+        .preprocessorMacros = macros.data(),
+        .preprocessorMacroCount = static_cast<SlangInt>(macros.size()),
     };
     Slang::ComPtr<slang::ISession> session;
     m_global_session->createSession(session_desc, session.writeRef());
@@ -1,5 +1,7 @@
 #pragma once
 #include "vector"
+#include "span"
+#include "string"
 #include "string_view"
 #include "slang.h"
 #include "slang-com-ptr.h"
@@ -12,11 +14,20 @@ enum class ShaderStage
     eCompute,
 };
 
+// Passed to the preprocessor as #define name value.
+struct ShaderDefine
+{
+    std::string name;
+    std::string value;
+};
+
 class ShaderCompiler
 {
 public:
     ShaderCompiler();
-    [[nodiscard]] std::vector<uint8_t> CompileShader(std::string_view file_path, ShaderStage stage) const;
+    [[nodiscard]] std::vector<uint8_t> CompileShader(std::string_view file_path,
+                                                     ShaderStage stage,
+                                                     std::span<const ShaderDefine> defines = {}) const;
 
 private:
     Slang::ComPtr<slang::IGlobalSession> m_global_session;
@@ -0,0 +1,13 @@
+#pragma once
+
+// Picks the widest instruction set the compiler was told it may use, the kernels fall back to scalar code otherwise.
+#if defined(__AVX2__)
+#include "immintrin.h"
+#define SWIFT_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include "emmintrin.h"
+#define SWIFT_SIMD_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include "arm_neon.h"
+#define SWIFT_SIMD_NEON
+#endif
@@ -0,0 +1,1186 @@
+#include "texture_compressor.hpp"
+#include "importer.hpp"
+#include "parallel.hpp"
+#include "algorithm"
+#include "array"
+#include "atomic"
+#include "cmath"
+#include "cstring"
+#include "limits"
+#include "simd.hpp"
+
+namespace
+{
+    constexpr uint32_t k_block_texels = 16;
+
+    // Texels of a 4x4 block in 0-255, channel major so the index search can load several texels of a channel at once.
+    struct Block
+    {
+        std::array<std::array<float, k_block_texels>, 4> channels{};
+    };
+
+    struct Palette
+    {
+        uint32_t count = 0;
+        std::array<std::array<float, 16>, 4> channels{};
+    };
+
+    using Color = std::array<float, 4>;
+    using Indices = std::array<uint8_t, k_block_texels>;
+    using Errors = std::array<float, k_block_texels>;
+    using Bits = std::array<uint64_t, 2>;
+
+    constexpr uint16_t k_all_texels = 0xFFFF;
+
+    constexpr std::array<uint32_t, 8> k_bc7_weights3 = {0, 9, 18, 27, 37, 46, 55, 64};
+    constexpr std::array<uint32_t, 16> k_bc7_weights4 = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    // Two subset partitions, bit i is set when texel i belongs to the second subset.
+    constexpr std::array<uint16_t, 64> k_bc7_partitions2 = {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8,
+        0xFF00, 0xFFF0, 0xF000, 0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110,
+        0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C, 0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696,
+        0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660, 0x0272, 0x04E4, 0x4E40, 0x2720,
+        0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+    };
+
+    // Texel whose index drops its top bit for the second subset, the first subset always anchors on texel 0.
+    constexpr std::array<uint8_t, 64> k_bc7_anchors2 = {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2,  8,  2,  2,  8,  8,  15, 2,  8,  2,  2,
+        8,  8,  2,  2,  15, 15, 6,  8,  2,  8,  15, 15, 2,  8,  2,  2,  2,  15, 15, 6,  6,  2,  6,  8,  15, 15, 2,  2,
+        15, 15, 15, 15, 15, 2,  2,  15,
+    };
+
+    // Number of the best estimated partitions that get a full encode at CompressionQuality::eHigh.
+    constexpr uint32_t k_bc7_partition_candidates = 4;
+
+    struct BitWriter
+    {
+        void Write(const uint32_t value, const uint32_t bit_count)
+        {
+            for (uint32_t i = 0; i < bit_count; ++i, ++offset)
+            {
+                bits[offset / 64] |= static_cast<uint64_t>(value >> i & 1) << (offset % 64);
+            }
+        }
+
+        Bits bits{};
+        uint32_t offset = 0;
+    };
+
+    struct BitReader
+    {
+        uint32_t Read(const uint32_t bit_count)
+        {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < bit_count; ++i, ++offset)
+            {
+                value |= static_cast<uint32_t>(bits[offset / 64] >> (offset % 64) & 1) << i;
+            }
+            return value;
+        }
+
+        Bits bits{};
+        uint32_t offset = 0;
+    };
+
+    float SumErrors(const Errors& errors, const uint16_t mask)
+    {
+        float sum = 0.f;
+        for (uint32_t i = 0; i < k_block_texels; ++i)
+        {
+            if (mask >> i & 1)
+            {
+                sum += errors[i];
+            }
+        }
+        return sum;
+    }
+
+    // Picks the closest palette entry for every texel, ties go to the lowest index on every path.
+    void SelectIndices(const Block& block,
+                       const Palette& palette,
+                       const uint32_t channel_count,
+                       Indices& indices,
+                       Errors& errors)
+    {
+        uint32_t i = 0;
+#if defined(SWIFT_SIMD_AVX2) || defined(SWIFT_SIMD_SSE)
+        for (; i + 4 <= k_block_texels; i += 4)
+        {
+            __m128 best_error = _mm_set1_ps(std::numeric_limits<float>::max());
+            __m128 best_index = _mm_setzero_ps();
+            for (uint32_t entry = 0; entry < palette.count; ++entry)
+            {
+                __m128 error = _mm_setzero_ps();
+                for (uint32_t c = 0; c < channel_count; ++c)
+                {
+                    const __m128 diff =
+                        _mm_sub_ps(_mm_loadu_ps(&block.channels[c][i]), _mm_set1_ps(palette.channels[c][entry]));
+                    error = _mm_add_ps(error, _mm_mul_ps(diff, diff));
+                }
+                const __m128 closer = _mm_cmplt_ps(error, best_error);
+                best_error = _mm_or_ps(_mm_and_ps(closer, error), _mm_andnot_ps(closer, best_error));
+                best_index = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(entry))),
+                                       _mm_andnot_ps(closer, best_index));
+            }
+            _mm_storeu_ps(&errors[i], best_error);
+            alignas(16) std::array<float, 4> best{};
+            _mm_store_ps(best.data(), best_index);
+            for (uint32_t k = 0; k < best.size(); ++k)
+            {
+                indices[i + k] = static_cast<uint8_t>(best[k]);
+            }
+        }
+#elif defined(SWIFT_SIMD_NEON)
+        for (; i + 4 <= k_block_texels; i += 4)
+        {
+            float32x4_t best_error = vdupq_n_f32(std::numeric_limits<float>::max());
+            float32x4_t best_index = vdupq_n_f32(0.f);
+            for (uint32_t entry = 0; entry < palette.count; ++entry)
+            {
+                float32x4_t error = vdupq_n_f32(0.f);
+                for (uint32_t c = 0; c < channel_count; ++c)
+                {
+                    const float32x4_t diff =
+                        vsubq_f32(vld1q_f32(&block.channels[c][i]), vdupq_n_f32(palette.channels[c][entry]));
+                    error = vaddq_f32(error, vmulq_f32(diff, diff));
+                }
+                const uint32x4_t closer = vcltq_f32(error, best_error);
+                best_error = vbslq_f32(closer, error, best_error);
+                best_index = vbslq_f32(closer, vdupq_n_f32(static_cast<float>(entry)), best_index);
+            }
+            vst1q_f32(&errors[i], best_error);
+            std::array<float, 4> best{};
+            vst1q_f32(best.data(), best_index);
+            for (uint32_t k = 0; k < best.size(); ++k)
+            {
+                indices[i + k] = static_cast<uint8_t>(best[k]);
+            }
+        }
+#endif
+        for (; i < k_block_texels; ++i)
+        {
+            errors[i] = std::numeric_limits<float>::max();
+            indices[i] = 0;
+            for (uint32_t entry = 0; entry < palette.count; ++entry)
+            {
+                float error = 0.f;
+                for (uint32_t c = 0; c < channel_count; ++c)
+                {
+                    const float diff = block.channels[c][i] - palette.channels[c][entry];
+                    error += diff * diff;
+                }
+                if (error < errors[i])
+                {
+                    errors[i] = error;
+                    indices[i] = static_cast<uint8_t>(entry);
+                }
+            }
+        }
+    }
+
+    Color Clamp(const Color& color)
+    {
+        Color result{};
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            result[c] = std::clamp(color[c], 0.f, 255.f);
+        }
+        return result;
+    }
+
+    struct Line
+    {
+        Color start{};
+        Color end{};
+        // Squared distance of the texels to the line, used to rank BC7 partitions.
+        float residual = 0.f;
+    };
+
+    // Fits the principal axis of the texels in mask by power iteration and spans it over their projection.
+    Line FitLine(const Block& block, const uint32_t channel_count, const uint16_t mask)
+    {
+        Color mean{};
+        float count = 0.f;
+        for (uint32_t i = 0; i < k_block_texels; ++i)
+        {
+            if (!(mask >> i & 1)) continue;
+            for (uint32_t c = 0; c < channel_count; ++c)
+            {
+                mean[c] += block.channels[c][i];
+            }
+            count += 1.f;
+        }
+        if (count == 0.f) return {};
+        for (uint32_t c = 0; c < channel_count; ++c)
+        {
+            mean[c] /= count;
+        }
+
+        std::array<std::array<float, 4>, 4> covariance{};
+        for (uint32_t i = 0; i < k_block_texels; ++i)
+        {
+            if (!(mask >> i & 1)) continue;
+            for (uint32_t a = 0; a < channel_count; ++a)
+            {
+                for (uint32_t b = 0; b < channel_count; ++b)
+                {
+                    covariance[a][b] += (block.channels[a][i] - mean[a]) * (block.channels[b][i] - mean[b]);
+                }
+            }
+        }
+
+        Color axis = {1.f, 1.f, 1.f, 1.f};
+        for (int iteration = 0; iteration < 8; ++iteration)
+        {
+            Color next{};
+            float length = 0.f;
+            for (uint32_t a = 0; a < channel_count; ++a)
+            {
+                for (uint32_t b = 0; b < channel_count; ++b)
+                {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+                length += next[a] * next[a];
+            }
+            length = std::sqrt(length);
+            if (length < 1e-8f)
+            {
+                axis = {};
+                break;
+            }
+            for (uint32_t c = 0; c < channel_count; ++c)
+            {
+                axis[c] = next[c] / length;
+            }
+        }
+
+        float min_t = std::numeric_limits<float>::max();
+        float max_t = std::numeric_limits<float>::lowest();
+        float trace = 0.f;
+        float variance = 0.f;
+        for (uint32_t a = 0; a < channel_count; ++a)
+        {
+            trace += covariance[a][a];
+            for (uint32_t b = 0; b < channel_count; ++b)
+            {
+                variance += axis[a] * covariance[a][b] * axis[b];
+            }
+        }
+        for (uint32_t i = 0; i < k_block_texels; ++i)
+        {
+            if (!(mask >> i & 1)) continue;
+            float t = 0.f;
+            for (uint32_t c = 0; c < channel_count; ++c)
+            {
+                t += (block.channels[c][i] - mean[c]) * axis[c];
+            }
+            min_t = std::min(min_t, t);
+            max_t = std::max(max_t, t);
+        }
+
+        Line line{.residual = std::max(trace - variance, 0.f)};
+        for (uint32_t c = 0; c < channel_count; ++c)
+        {
+            line.start[c] = mean[c] + axis[c] * min_t;
+            line.end[c] = mean[c] + axis[c] * max_t;
+        }
+        line.start = Clamp(line.start);
+        line.end = Clamp(line.end);
+        return line;
+    }
+
+    // Least squares endpoints for fixed indices, weights[i] is how far palette entry i sits from start to end.
+    bool RefineLine(const Block& block,
+                    const uint32_t channel_count,
+                    const uint16_t mask,
+                    const Indices& indices,
+                    const std::span<const float> weights,
+                    Line& line)
+    {
+        float aa = 0.f;
+        float ab = 0.f;
+        float bb = 0.f;
+        Color ax{};
+        Color bx{};
+        for (uint32_t i = 0; i < k_block_texels; ++i)
+        {
+            if (!(mask >> i & 1)) continue;
+            const float b = weights[indices[i]];
+            const float a = 1.f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (uint32_t c = 0; c < channel_count; ++c)
+            {
+                ax[c] += a * block.channels[c][i];
+                bx[c] += b * block.channels[c][i];
+            }
+        }
+
+        const float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f) return false;
+        for (uint32_t c = 0; c < channel_count; ++c)
+        {
+            line.start[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+            line.end[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+        }
+        line.start = Clamp(line.start);
+        line.end = Clamp(line.end);
+        return true;
+    }
+
+    // BC1
+
+    constexpr std::array<float, 4> k_bc1_weights = {0.f, 1.f, 1.f / 3.f, 2.f / 3.f};
+
+    uint16_t To565(const Color& color)
+    {
+        const auto r = static_cast<uint16_t>(std::lround(color[0] * 31.f / 255.f));
+        const auto g = static_cast<uint16_t>(std::lround(color[1] * 63.f / 255.f));
+        const auto b = static_cast<uint16_t>(std::lround(color[2] * 31.f / 255.f));
+        return static_cast<uint16_t>(r << 11 | g << 5 | b);
+    }
+
+    Color From565(const uint16_t value)
+    {
+        const uint32_t r = value >> 11;
+        const uint32_t g = value >> 5 & 63;
+        const uint32_t b = value & 31;
+        return {static_cast<float>(r << 3 | r >> 2),
+                static_cast<float>(g << 2 | g >> 4),
+                static_cast<float>(b << 3 | b >> 2),
+                255.f};
+    }
+
+    struct BC1Candidate
+    {
+        uint16_t color0 = 0;
+        uint16_t color1 = 0;
+        Indices indices{};
+        float error = std::numeric_limits<float>::max();
+    };
+
+    BC1Candidate EvaluateBC1(const Block& block, const Line& line)
+    {
+        BC1Candidate candidate{.color0 = To565(line.end), .color1 = To565(line.start)};
+        // color0 > color1 selects the four color mode, which is the only one emitted.
+        if (candidate.color0 < candidate.color1)
+        {
+            std::swap(candidate.color0, candidate.color1);
+        }
+
+        const Color color0 = From565(candidate.color0);
+        const Color color1 = From565(candidate.color1);
+        Palette palette{.count = 4};
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            palette.channels[c] = {color0[c],
+                                   color1[c],
+                                   (2.f * color0[c] + color1[c]) / 3.f,
+                                   (color0[c] + 2.f * color1[c]) / 3.f};
+        }
+
+        Errors errors{};
+        SelectIndices(block, palette, 3, candidate.indices, errors);
+        if (candidate.color0 == candidate.color1)
+        {
+            candidate.indices.fill(0);
+        }
+        candidate.error = SumErrors(errors, k_all_texels);
+        return candidate;
+    }
+
+    uint64_t EncodeBC1(const Block& block, const CompressionQuality quality)
+    {
+        auto best = EvaluateBC1(block, FitLine(block, 3, k_all_texels));
+        for (int iteration = 0; quality != CompressionQuality::eFast && iteration < 2; ++iteration)
+        {
+            Line line{.start = From565(best.color0), .end = From565(best.color1)};
+            if (!RefineLine(block, 3, k_all_texels, best.indices, k_bc1_weights, line)) break;
+            std::swap(line.start, line.end);
+            const auto candidate = EvaluateBC1(block, line);
+            if (candidate.error >= best.error) break;
+            best = candidate;
+        }
+
+        uint64_t bits = static_cast<uint64_t>(best.color0) | static_cast<uint64_t>(best.color1) << 16;
+        for (uint32_t i = 0; i < k_block_texels; ++i)
+        {
+            bits |= static_cast<uint64_t>(best.indices[i]) << (32 + i * 2);
+        }
+        return bits;
+    }
+
+    void DecodeBC1(const uint64_t bits, Block& block)
+    {
+        const auto value0 = static_cast<uint16_t>(bits);
+        const auto value1 = static_cast<uint16_t>(bits >> 16);
+        const Color color0 = From565(value0);
+        const Color color1 = From565(value1);
+        for (uint32_t i = 0; i < k_block_texels; ++i)
+        {
+            const uint32_t index = bits >> (32 + i * 2) & 3;
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                const auto e0 = static_cast<uint32_t>(color0[c]);
+                const auto e1 = static_cast<uint32_t>(color1[c]);
+                uint32_t value = 0;
+                if (value0 > value1)
+                {
+                    const std::array<uint32_t, 4> entries = {e0, e1, (2 * e0 + e1 + 1) / 3, (e0 + 2 * e1 + 1) / 3};
+                    value = entries[index];
+                }
+                else
+                {
+                    const std::array<uint32_t, 4> entries = {e0, e1, (e0 + e1 + 1) / 2, 0};
+                    value = entries[index];
+                }
+                block.channels[c][i] = static_cast<float>(value);
+            }
+            block.channels[3][i] = value0 <= value1 && index == 3 ? 0.f : 255.f;
+        }
+    }
+
+    // BC4
+
+    constexpr std::array<float, 8> k_bc4_weights = {0.f, 1.f, 1.f / 7.f, 2.f / 7.f, 3.f / 7.f, 4.f / 7.f, 5.f / 7.f, 6.f / 7.f};
+
+    struct BC4Candidate
+    {
+        uint8_t red0 = 0;
+        uint8_t red1 = 0;
+        Indices indices{};
+        float error = std::numeric_limits<float>::max();
+    };
+
+    BC4Candidate EvaluateBC4(const Block& values, int32_t red0, int32_t red1)
+    {
+        red0 = std::clamp(red0, 0, 255);
+        red1 = std::clamp(red1, 0, 255);
+        // red0 > red1 selects the eight value mode, which is the only one emitted.
+        if (red0 < red1)
+        {
+            std::swap(red0, red1);
+        }
+
+        BC4Candidate candidate{.red0 = static_cast<uint8_t>(red0), .red1 = static_cast<uint8_t>(red1)};
+        Palette palette{.count = 8};
+        for (uint32_t i = 0; i < palette.count; ++i)
+        {
+            const float weight = k_bc4_weights[i];
+            palette.channels[0][i] = static_cast<float>(red0) * (1.f - weight) + static_cast<float>(red1) * weight;
+        }
+
+        Errors errors{};
+        SelectIndices(values, palette, 1, candidate.indices, errors);
+        if (red0 == red1)
+        {
+            candidate.indices.fill(0);
+        }
+        candidate.error = SumErrors(errors, k_all_texels);
+        return candidate;
+    }
+
+    uint64_t EncodeBC4(const Block& block, const uint32_t channel, const CompressionQuality quality)
+    {
+        Block values{};
+        values.channels[0] = block.channels[channel];
+        const auto [min_value, max_value] = std::ranges::minmax(values.channels[0]);
+        auto best = EvaluateBC4(values,
+                                static_cast<int32_t>(std::lround(max_value)),
+                                static_cast<int32_t>(std::lround(min_value)));
+
+        for (int iteration = 0; quality != CompressionQuality::eFast && iteration < 2; ++iteration)
+        {
+            Line line{.start = {static_cast<float>(best.red0)}, .end = {static_cast<float>(best.red1)}};
+            if (!RefineLine(values, 1, k_all_texels, best.indices, k_bc4_weights, line)) break;
+            const auto candidate = EvaluateBC4(values,
+                                               static_cast<int32_t>(std::lround(line.start[0])),
+                                               static_cast<int32_t>(std::lround(line.end[0])));
+            if (candidate.error >= best.error) break;
+            best = candidate;
+        }
+
+        if (quality == CompressionQuality::eHigh)
+        {
+            const int32_t red0 = best.red0;
+            const int32_t red1 = best.red1;
+            for (int32_t offset0 = -2; offset0 <= 2; ++offset0)
+            {
+                for (int32_t offset1 = -2; offset1 <= 2; ++offset1)
+                {
+                    const auto candidate = EvaluateBC4(values, red0 + offset0, red1 + offset1);
+                    if (candidate.error < best.error)
+                    {
+                        best = candidate;
+                    }
+                }
+            }
+        }
+
+        uint64_t bits = static_cast<uint64_t>(best.red0) | static_cast<uint64_t>(best.red1) << 8;
+        for (uint32_t i = 0; i < k_block_texels; ++i)
+        {
+            bits |= static_cast<uint64_t>(best.indices[i]) << (16 + i * 3);
+        }
+        return bits;
+    }
+
+    void DecodeBC4(const uint64_t bits, Block& block, const uint32_t channel)
+    {
+        const uint32_t red0 = bits & 0xFF;
+        const uint32_t red1 = bits >> 8 & 0xFF;
+        for (uint32_t i = 0; i < k_block_texels; ++i)
+        {
+            const uint32_t index = bits >> (16 + i * 3) & 7;
+            float value = 0.f;
+            if (index < 2)
+            {
+                value = static_cast<float>(index == 0 ? red0 : red1);
+            }
+            else if (red0 > red1)
+            {
+                value = std::round(static_cast<float>((8 - index) * red0 + (index - 1) * red1) / 7.f);
+            }
+            else if (index < 6)
+            {
+                value = std::round(static_cast<float>((6 - index) * red0 + (index - 1) * red1) / 5.f);
+            }
+            else
+            {
+                value = index == 6 ? 0.f : 255.f;
+            }
+            block.channels[channel][i] = value;
+        }
+    }
+
+    // BC7, mode 6 (one subset RGBA) and mode 1 (two subset RGB) are emitted.
+
+    constexpr std::array<float, 16> GetBC7Weights4()
+    {
+        std::array<float, 16> weights{};
+        for (uint32_t i = 0; i < weights.size(); ++i)
+        {
+            weights[i] = static_cast<float>(k_bc7_weights4[i]) / 64.f;
+        }
+        return weights;
+    }
+
+    constexpr std::array<float, 8> GetBC7Weights3()
+    {
+        std::array<float, 8> weights{};
+        for (uint32_t i = 0; i < weights.size(); ++i)
+        {
+            weights[i] = static_cast<float>(k_bc7_weights3[i]) / 64.f;
+        }
+        return weights;
+    }
+
+    uint32_t Interpolate(const uint32_t e0, const uint32_t e1, const uint32_t weight)
+    {
+        return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+    }
+
+    using Endpoint = std::array<uint32_t, 4>;
+
+    struct BC7Subset
+    {
+        Endpoint start{};
+        Endpoint end{};
+        uint32_t start_pbit = 0;
+        uint32_t end_pbit = 0;
+    };
+
+    struct BC7Candidate
+    {
+        uint32_t partition = 0;
+        std::array<BC7Subset, 2> subsets{};
+        Indices indices{};
+        float error = std::numeric_limits<float>::max();
+    };
+
+    // Mode 6 stores 7 bit endpoints plus a p-bit as the lowest bit.
+    Endpoint QuantizeMode6(const Color& color, const uint32_t pbit)
+    {
+        Endpoint endpoint{};
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            endpoint[c] = static_cast<uint32_t>(std::clamp(std::lround((color[c] - static_cast<float>(pbit)) / 2.f), 0l, 127l));
+        }
+        return endpoint;
+    }
+
+    uint32_t UnquantizeMode6(const uint32_t value, const uint32_t pbit) { return value << 1 | pbit; }
+
+    // Mode 1 stores 6 bit endpoints plus a p-bit shared by both endpoints of a subset.
+    uint32_t UnquantizeMode1(const uint32_t value, const uint32_t pbit)
+    {
+        const uint32_t value7 = value << 1 | pbit;
+        return value7 << 1 | value7 >> 6;
+    }
+
+    Endpoint QuantizeMode1(const Color& color, const uint32_t pbit)
+    {
+        Endpoint endpoint{};
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            const auto guess = static_cast<int32_t>(std::lround((color[c] * 127.f / 255.f - static_cast<float>(pbit)) / 2.f));
+            float best_error = std::numeric_limits<float>::max();
+            for (int32_t value = std::max(guess - 1, 0); value <= std::min(guess + 1, 63); ++value)
+            {
+                const float error = std::abs(static_cast<float>(UnquantizeMode1(value, pbit)) - color[c]);
+                if (error < best_error)
+                {
+                    best_error = error;
+                    endpoint[c] = value;
+                }
+            }
+        }
+        return endpoint;
+    }
+
+    Errors EvaluateMode6(const Block& block, BC7Subset& subset, Indices& indices)
+    {
+        Palette palette{.count = 16};
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            const uint32_t e0 = UnquantizeMode6(subset.start[c], subset.start_pbit);
+            const uint32_t e1 = UnquantizeMode6(subset.end[c], subset.end_pbit);
+            for (uint32_t i = 0; i < palette.count; ++i)
+            {
+                palette.channels[c][i] = static_cast<float>(Interpolate(e0, e1, k_bc7_weights4[i]));
+            }
+        }
+        Errors errors{};
+        SelectIndices(block, palette, 4, indices, errors);
+        return errors;
+    }
+
+    // P-bit that reproduces the endpoint with the smallest quantization error.
+    uint32_t ChooseMode6PBit(const Color& color)
+    {
+        std::array<float, 2> errors{};
+        for (uint32_t pbit = 0; pbit < 2; ++pbit)
+        {
+            const Endpoint endpoint = QuantizeMode6(color, pbit);
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                errors[pbit] += std::abs(static_cast<float>(UnquantizeMode6(endpoint[c], pbit)) - color[c]);
+            }
+        }
+        return errors[1] < errors[0] ? 1 : 0;
+    }
+
+    BC7Candidate EncodeMode6(const Block& block, const Line& line, const CompressionQuality quality)
+    {
+        BC7Candidate best{};
+        for (uint32_t pbits = 0; pbits < 4; ++pbits)
+        {
+            BC7Candidate candidate{};
+            auto& subset = candidate.subsets[0];
+            subset.start_pbit = pbits & 1;
+            subset.end_pbit = pbits >> 1;
+            if (quality == CompressionQuality::eFast)
+            {
+                subset.start_pbit = ChooseMode6PBit(line.start);
+                subset.end_pbit = ChooseMode6PBit(line.end);
+            }
+            subset.start = QuantizeMode6(line.start, subset.start_pbit);
+            subset.end = QuantizeMode6(line.end, subset.end_pbit);
+            candidate.error = SumErrors(EvaluateMode6(block, subset, candidate.indices), k_all_texels);
+            if (candidate.error < best.error)
+            {
+                best = candidate;
+            }
+            if (quality == CompressionQuality::eFast) break;
+        }
+        return best;
+    }
+
+    Color UnquantizeMode6(const Endpoint& endpoint, const uint32_t pbit)
+    {
+        Color color{};
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            color[c] = static_cast<float>(UnquantizeMode6(endpoint[c], pbit));
+        }
+        return color;
+    }
+
+    BC7Candidate EncodeBC7Mode6(const Block& block, const CompressionQuality quality)
+    {
+        constexpr auto weights = GetBC7Weights4();
+        auto best = EncodeMode6(block, FitLine(block, 4, k_all_texels), quality);
+        for (int iteration = 0; quality != CompressionQuality::eFast && iteration < 2; ++iteration)
+        {
+            const auto& subset = best.subsets[0];
+            Line line{.start = UnquantizeMode6(subset.start, subset.start_pbit),
+                      .end = UnquantizeMode6(subset.end, subset.end_pbit)};
+            if (!RefineLine(block, 4, k_all_texels, best.indices, weights, line)) break;
+            const auto candidate = EncodeMode6(block, line, quality);
+            if (candidate.error >= best.error) break;
+            best = candidate;
+        }
+        return best;
+    }
+
+    float EvaluateMode1Subset(const Block& block, const uint16_t mask, BC7Subset& subset, Indices& indices)
+    {
+        Palette palette{.count = 8};
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            const uint32_t e0 = UnquantizeMode1(subset.start[c], subset.start_pbit);
+            const uint32_t e1 = UnquantizeMode1(subset.end[c], subset.end_pbit);
+            for (uint32_t i = 0; i < palette.count; ++i)
+            {
+                palette.channels[c][i] = static_cast<float>(Interpolate(e0, e1, k_bc7_weights3[i]));
+            }
+        }
+        Indices subset_indices{};
+        Errors errors{};
+        SelectIndices(block, palette, 3, subset_indices, errors);
+        for (uint32_t i = 0; i < k_block_texels; ++i)
+        {
+            if (mask >> i & 1)
+            {
+                indices[i] = subset_indices[i];
+            }
+        }
+        return SumErrors(errors, mask);
+    }
+
+    Color UnquantizeMode1(const Endpoint& endpoint, const uint32_t pbit)
+    {
+        return {static_cast<float>(UnquantizeMode1(endpoint[0], pbit)),
+                static_cast<float>(UnquantizeMode1(endpoint[1], pbit)),
+                static_cast<float>(UnquantizeMode1(endpoint[2], pbit)),
+                255.f};
+    }
+
+    float EncodeMode1Subset(const Block& block, const uint16_t mask, Line line, BC7Subset& best_subset, Indices& indices)
+    {
+        constexpr auto weights = GetBC7Weights3();
+        float best_error = std::numeric_limits<float>::max();
+        for (int iteration = 0; iteration < 2; ++iteration)
+        {
+            bool improved = false;
+            for (uint32_t pbit = 0; pbit < 2; ++pbit)
+            {
+                BC7Subset subset{
+                    .start = QuantizeMode1(line.start, pbit),
+                    .end = QuantizeMode1(line.end, pbit),
+                    .start_pbit = pbit,
+                    .end_pbit = pbit,
+                };
+                Indices candidate_indices = indices;
+                const float error = EvaluateMode1Subset(block, mask, subset, candidate_indices);
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best_subset = subset;
+                    indices = candidate_indices;
+                    improved = true;
+                }
+            }
+            if (!improved) break;
+            line = {.start = UnquantizeMode1(best_subset.start, best_subset.start_pbit),
+                    .end = UnquantizeMode1(best_subset.end, best_subset.end_pbit)};
+            if (!RefineLine(block, 3, mask, indices, weights, line)) break;
+        }
+        return best_error;
+    }
+
+    BC7Candidate EncodeBC7Mode1(const Block& block, const uint32_t partition)
+    {
+        BC7Candidate candidate{.partition = partition, .error = 0.f};
+        const uint16_t second_mask = k_bc7_partitions2[partition];
+        for (uint32_t s = 0; s < 2; ++s)
+        {
+            const auto mask = static_cast<uint16_t>(s == 0 ? ~second_mask : second_mask);
+            candidate.error +=
+                EncodeMode1Subset(block, mask, FitLine(block, 3, mask), candidate.subsets[s], candidate.indices);
+        }
+        return candidate;
+    }
+
+    Bits PackMode6(BC7Candidate candidate)
+    {
+        // The anchor texel drops the top index bit, flip the endpoints so it is zero.
+        auto& subset = candidate.subsets[0];
+        if (candidate.indices[0] >= 8)
+        {
+            std::swap(subset.start, subset.end);
+            std::swap(subset.start_pbit, subset.end_pbit);
+            for (auto& index : candidate.indices)
+            {
+                index = static_cast<uint8_t>(15 - index);
+            }
+        }
+
+        BitWriter writer{};
+        writer.Write(1 << 6, 7);
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            writer.Write(subset.start[c], 7);
+            writer.Write(subset.end[c], 7);
+        }
+        writer.Write(subset.start_pbit, 1);
+        writer.Write(subset.end_pbit, 1);
+        for (uint32_t i = 0; i < k_block_texels; ++i)
+        {
+            writer.Write(candidate.indices[i], i == 0 ? 3 : 4);
+        }
+        return writer.bits;
+    }
+
+    Bits PackMode1(BC7Candidate candidate)
+    {
+        const uint16_t second_mask = k_bc7_partitions2[candidate.partition];
+        const std::array<uint32_t, 2> anchors = {0, k_bc7_anchors2[candidate.partition]};
+        for (uint32_t s = 0; s < 2; ++s)
+        {
+            auto& subset = candidate.subsets[s];
+            if (candidate.indices[anchors[s]] < 4) continue;
+            std::swap(subset.start, subset.end);
+            for (uint32_t i = 0; i < k_block_texels; ++i)
+            {
+                if ((second_mask >> i & 1) == s)
+                {
+                    candidate.indices[i] = static_cast<uint8_t>(7 - candidate.indices[i]);
+                }
+            }
+        }
+
+        BitWriter writer{};
+        writer.Write(1 << 1, 2);
+        writer.Write(candidate.partition, 6);
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            for (const auto& subset : candidate.subsets)
+            {
+                writer.Write(subset.start[c], 6);
+                writer.Write(subset.end[c], 6);
+            }
+        }
+        writer.Write(candidate.subsets[0].start_pbit, 1);
+        writer.Write(candidate.subsets[1].start_pbit, 1);
+        for (uint32_t i = 0; i < k_block_texels; ++i)
+        {
+            writer.Write(candidate.indices[i], i == anchors[0] || i == anchors[1] ? 2 : 3);
+        }
+        return writer.bits;
+    }
+
+    Bits EncodeBC7(const Block& block, const CompressionQuality quality)
+    {
+        auto mode6 = EncodeBC7Mode6(block, quality);
+        const bool opaque = std::ranges::all_of(block.channels[3], [](const float alpha) { return alpha == 255.f; });
+        if (quality != CompressionQuality::eHigh || !opaque)
+        {
+            return PackMode6(mode6);
+        }
+
+        // Rank the partitions by how well two lines fit them, only the best few get a full encode.
+        std::array<std::pair<float, uint32_t>, 64> estimates{};
+        for (uint32_t partition = 0; partition < estimates.size(); ++partition)
+        {
+            const uint16_t mask = k_bc7_partitions2[partition];
+            estimates[partition] = {FitLine(block, 3, static_cast<uint16_t>(~mask)).residual + FitLine(block, 3, mask).residual,
+                                    partition};
+        }
+        std::ranges::partial_sort(estimates, estimates.begin() + k_bc7_partition_candidates);
+
+        BC7Candidate best_mode1{};
+        for (uint32_t i = 0; i < k_bc7_partition_candidates; ++i)
+        {
+            const auto candidate = EncodeBC7Mode1(block, estimates[i].second);
+            if (candidate.error < best_mode1.error)
+            {
+                best_mode1 = candidate;
+            }
+        }
+        return best_mode1.error < mode6.error ? PackMode1(best_mode1) : PackMode6(mode6);
+    }
+
+    void DecodeBC7(const Bits& bits, Block& block)
+    {
+        BitReader reader{.bits = bits};
+        uint32_t mode = 0;
+        while (mode < 8 && reader.Read(1) == 0)
+        {
+            ++mode;
+        }
+
+        if (mode == 6)
+        {
+            BC7Subset subset{};
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                subset.start[c] = reader.Read(7);
+                subset.end[c] = reader.Read(7);
+            }
+            subset.start_pbit = reader.Read(1);
+            subset.end_pbit = reader.Read(1);
+            for (uint32_t i = 0; i < k_block_texels; ++i)
+            {
+                const uint32_t index = reader.Read(i == 0 ? 3 : 4);
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    const uint32_t e0 = UnquantizeMode6(subset.start[c], subset.start_pbit);
+                    const uint32_t e1 = UnquantizeMode6(subset.end[c], subset.end_pbit);
+                    block.channels[c][i] = static_cast<float>(Interpolate(e0, e1, k_bc7_weights4[index]));
+                }
+            }
+            return;
+        }
+
+        if (mode == 1)
+        {
+            const uint32_t partition = reader.Read(6);
+            std::array<BC7Subset, 2> subsets{};
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                for (auto& subset : subsets)
+                {
+                    subset.start[c] = reader.Read(6);
+                    subset.end[c] = reader.Read(6);
+                }
+            }
+            for (auto& subset : subsets)
+            {
+                subset.start_pbit = reader.Read(1);
+                subset.end_pbit = subset.start_pbit;
+            }
+            const uint32_t anchor = k_bc7_anchors2[partition];
+            for (uint32_t i = 0; i < k_block_texels; ++i)
+            {
+                const uint32_t index = reader.Read(i == 0 || i == anchor ? 2 : 3);
+                const auto& subset = subsets[k_bc7_partitions2[partition] >> i & 1];
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    const uint32_t e0 = UnquantizeMode1(subset.start[c], subset.start_pbit);
+                    const uint32_t e1 = UnquantizeMode1(subset.end[c], subset.end_pbit);
+                    block.channels[c][i] = static_cast<float>(Interpolate(e0, e1, k_bc7_weights3[index]));
+                }
+                block.channels[3][i] = 255.f;
+            }
+            return;
+        }
+
+        // Never emitted by this encoder.
+        block = {};
+    }
+
+    struct FormatInfo
+    {
+        uint32_t block_size = 0;
+        // Channels stored by the format, starting at red.
+        uint32_t channel_count = 0;
+    };
+
+    FormatInfo GetFormatInfo(const Swift::Format format)
+    {
+        switch (format)
+        {
+            case Swift::Format::eBC1_UNORM:
+            case Swift::Format::eBC1_UNORM_SRGB:
+                return {.block_size = 8, .channel_count = 3};
+            case Swift::Format::eBC3_UNORM:
+            case Swift::Format::eBC3_UNORM_SRGB:
+                return {.block_size = 16, .channel_count = 4};
+            case Swift::Format::eBC4_UNORM:
+                return {.block_size = 8, .channel_count = 1};
+            case Swift::Format::eBC5_UNORM:
+                return {.block_size = 16, .channel_count = 2};
+            case Swift::Format::eBC7_UNORM:
+            case Swift::Format::eBC7_UNORM_SRGB:
+                return {.block_size = 16, .channel_count = 4};
+            default:
+                return {};
+        }
+    }
+
+    // Encodes a block and returns the squared error of the decoded result over the stored channels.
+    double EncodeBlock(const Swift::Format format, const Block& block, const CompressionQuality quality, uint8_t* dst)
+    {
+        Block decoded{};
+        switch (format)
+        {
+            case Swift::Format::eBC1_UNORM:
+            case Swift::Format::eBC1_UNORM_SRGB:
+            {
+                const uint64_t bits = EncodeBC1(block, quality);
+                DecodeBC1(bits, decoded);
+                std::memcpy(dst, &bits, sizeof(bits));
+            }
+            break;
+            case Swift::Format::eBC3_UNORM:
+            case Swift::Format::eBC3_UNORM_SRGB:
+            {
+                const std::array bits = {EncodeBC4(block, 3, quality), EncodeBC1(block, quality)};
+                DecodeBC1(bits[1], decoded);
+                DecodeBC4(bits[0], decoded, 3);
+                std::memcpy(dst, bits.data(), sizeof(bits));
+            }
+            break;
+            case Swift::Format::eBC4_UNORM:
+            {
+                const uint64_t bits = EncodeBC4(block, 0, quality);
+                DecodeBC4(bits, decoded, 0);
+                std::memcpy(dst, &bits, sizeof(bits));
+            }
+            break;
+            case Swift::Format::eBC5_UNORM:
+            {
+                const std::array bits = {EncodeBC4(block, 0, quality), EncodeBC4(block, 1, quality)};
+                DecodeBC4(bits[0], decoded, 0);
+                DecodeBC4(bits[1], decoded, 1);
+                std::memcpy(dst, bits.data(), sizeof(bits));
+            }
+            break;
+            case Swift::Format::eBC7_UNORM:
+            case Swift::Format::eBC7_UNORM_SRGB:
+            {
+                const Bits bits = EncodeBC7(block, quality);
+                DecodeBC7(bits, decoded);
+                std::memcpy(dst, bits.data(), sizeof(bits));
+            }
+            break;
+            default:
+                return 0.0;
+        }
+
+        double error = 0.0;
+        for (uint32_t c = 0; c < GetFormatInfo(format).channel_count; ++c)
+        {
+            for (uint32_t i = 0; i < k_block_texels; ++i)
+            {
+                const double diff = decoded.channels[c][i] - block.channels[c][i];
+                error += diff * diff;
+            }
+        }
+        return error;
+    }
+
+    // One row of blocks of one mip, the unit of work handed to the threads.
+    struct EncodeJob
+    {
+        uint32_t texture = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t block_row = 0;
+        size_t src_offset = 0;
+        size_t dst_offset = 0;
+    };
+}  // namespace
+
+std::vector<CompressionReport> CompressTextures(std::vector<Texture>& textures,
+                                                const std::span<const Swift::Format> formats,
+                                                const CompressionQuality quality,
+                                                const uint32_t max_threads)
+{
+    std::vector<CompressionReport> reports(textures.size());
+    std::vector<std::vector<uint8_t>> outputs(textures.size());
+    std::vector<EncodeJob> jobs;
+    for (uint32_t t = 0; t < textures.size(); ++t)
+    {
+        const auto& texture = textures[t];
+        const auto format_info = GetFormatInfo(formats[t]);
+        if (format_info.block_size == 0 || texture.format != Swift::Format::eRGBA8_UNORM || texture.array_size != 1 ||
+            texture.width % 4 != 0 || texture.height % 4 != 0)
+        {
+            reports[t].format = texture.format;
+            continue;
+        }
+
+        reports[t].format = formats[t];
+        size_t src_offset = 0;
+        size_t dst_offset = 0;
+        for (uint32_t mip = 0; mip < texture.mip_levels; ++mip)
+        {
+            const uint32_t width = std::max(texture.width >> mip, 1u);
+            const uint32_t height = std::max(texture.height >> mip, 1u);
+            const uint32_t blocks_x = (width + 3) / 4;
+            const uint32_t blocks_y = (height + 3) / 4;
+            for (uint32_t block_row = 0; block_row < blocks_y; ++block_row)
+            {
+                jobs.emplace_back(EncodeJob{
+                    .texture = t,
+                    .width = width,
+                    .height = height,
+                    .block_row = block_row,
+                    .src_offset = src_offset,
+                    .dst_offset = dst_offset + static_cast<size_t>(block_row) * blocks_x * format_info.block_size,
+                });
+            }
+            src_offset += static_cast<size_t>(width) * height * 4;
+            dst_offset += static_cast<size_t>(blocks_x) * blocks_y * format_info.block_size;
+        }
+        outputs[t].resize(dst_offset);
+    }
+
+    // Once the last row of a texture is encoded its RGBA8 source is swapped out, so the peak holds only the textures in
+    // flight twice instead of all of them.
+    std::vector<std::atomic<uint32_t>> remaining_jobs(textures.size());
+    for (const auto& job : jobs)
+    {
+        remaining_jobs[job.texture].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::vector<double> job_errors(jobs.size());
+    ParallelFor(static_cast<uint32_t>(jobs.size()),
+                [&](const uint32_t job_index)
+                {
+                    const auto& job = jobs[job_index];
+                    const auto& texture = textures[job.texture];
+                    const auto format = formats[job.texture];
+                    const uint32_t block_size = GetFormatInfo(format).block_size;
+                    const uint8_t* src = texture.pixels.data() + job.src_offset;
+                    uint8_t* dst = outputs[job.texture].data() + job.dst_offset;
+
+                    // Blocks past the edge of the small mips repeat the last row and column.
+                    for (uint32_t block_x = 0; block_x < (job.width + 3) / 4; ++block_x)
+                    {
+                        Block block{};
+                        for (uint32_t i = 0; i < k_block_texels; ++i)
+                        {
+                            const uint32_t x = std::min(block_x * 4 + i % 4, job.width - 1);
+                            const uint32_t y = std::min(job.block_row * 4 + i / 4, job.height - 1);
+                            const uint8_t* texel = src + (static_cast<size_t>(y) * job.width + x) * 4;
+                            for (uint32_t c = 0; c < 4; ++c)
+                            {
+                                block.channels[c][i] = texel[c];
+                            }
+                        }
+                        job_errors[job_index] += EncodeBlock(format, block, quality, dst + block_x * block_size);
+                    }
+
+                    if (remaining_jobs[job.texture].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    {
+                        textures[job.texture].format = format;
+                        textures[job.texture].pixels = std::move(outputs[job.texture]);
+                    }
+                },
+                max_threads);
+
+    std::vector<double> errors(textures.size());
+    std::vector<double> samples(textures.size());
+    for (uint32_t i = 0; i < jobs.size(); ++i)
+    {
+        const auto& job = jobs[i];
+        errors[job.texture] += job_errors[i];
+        samples[job.texture] += static_cast<double>((job.width + 3) / 4) * k_block_texels *
+                                GetFormatInfo(formats[job.texture]).channel_count;
+    }
+
+    for (uint32_t t = 0; t < textures.size(); ++t)
+    {
+        if (samples[t] == 0.0) continue;
+
+        const double mse = errors[t] / samples[t];
+        reports[t].psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+    }
+    return reports;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "swift_structs.hpp"
+#include "span"
+#include "vector"
+
+struct Texture;
+
+enum class CompressionQuality
+{
+    // Single pass endpoints from the principal axis.
+    eFast,
+    // Least squares endpoint refinement and p-bit search.
+    eNormal,
+    // Also searches the two subset BC7 partitions for opaque blocks.
+    eHigh,
+};
+
+struct CompressionReport
+{
+    Swift::Format format = Swift::Format::eRGBA8_UNORM;
+    // Over the channels the format stores and every mip, 0 when the texture was skipped.
+    double psnr = 0.0;
+};
+
+// Encodes every mip of the RGBA8 textures to the requested block compressed format in place. BC1, BC3, BC4, BC5 and
+// BC7 are supported, textures with another format request or a size that is not a multiple of 4 are left alone.
+// max_threads caps the encoding threads, 0 uses every hardware thread.
+std::vector<CompressionReport> CompressTextures(std::vector<Texture>& textures,
+                                                std::span<const Swift::Format> formats,
+                                                CompressionQuality quality,
+                                                uint32_t max_threads = 0);
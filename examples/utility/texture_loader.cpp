@@ -0,0 +1,468 @@
+#include "texture_loader.hpp"
+#include "importer.hpp"
+#include "algorithm"
+#include "cstring"
+#include "format"
+#include "fstream"
+
+namespace
+{
+    constexpr std::array<uint8_t, 4> dds_magic = {'D', 'D', 'S', ' '};
+    constexpr std::array<uint8_t, 12> ktx2_magic = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    constexpr uint32_t MakeFourCC(const char a, const char b, const char c, const char d)
+    {
+        return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+    }
+
+    struct DDSPixelFormat
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t four_cc;
+        uint32_t rgb_bit_count;
+        uint32_t r_mask;
+        uint32_t g_mask;
+        uint32_t b_mask;
+        uint32_t a_mask;
+    };
+
+    struct DDSHeader
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitch_or_linear_size;
+        uint32_t depth;
+        uint32_t mip_map_count;
+        uint32_t reserved1[11];
+        DDSPixelFormat pixel_format;
+        uint32_t caps;
+        uint32_t caps2;
+        uint32_t caps3;
+        uint32_t caps4;
+        uint32_t reserved2;
+    };
+    static_assert(sizeof(DDSHeader) == 124);
+
+    struct DDSHeaderDX10
+    {
+        uint32_t dxgi_format;
+        uint32_t resource_dimension;
+        uint32_t misc_flag;
+        uint32_t array_size;
+        uint32_t misc_flags2;
+    };
+
+    constexpr uint32_t dds_fourcc_flag = 0x4;
+    constexpr uint32_t dds_rgb_flag = 0x40;
+    constexpr uint32_t dds_cubemap_all_faces = 0xFE00;
+    constexpr uint32_t dds_volume_flag = 0x200000;
+    constexpr uint32_t dx10_texture_cube_flag = 0x4;
+    constexpr uint32_t dx10_texture_3d = 4;
+
+    // The 64 bit fields of the header are only 4 byte aligned in the file.
+#pragma pack(push, 4)
+    struct KTX2Header
+    {
+        uint32_t vk_format;
+        uint32_t type_size;
+        uint32_t pixel_width;
+        uint32_t pixel_height;
+        uint32_t pixel_depth;
+        uint32_t layer_count;
+        uint32_t face_count;
+        uint32_t level_count;
+        uint32_t supercompression_scheme;
+        uint32_t dfd_byte_offset;
+        uint32_t dfd_byte_length;
+        uint32_t kvd_byte_offset;
+        uint32_t kvd_byte_length;
+        uint64_t sgd_byte_offset;
+        uint64_t sgd_byte_length;
+    };
+#pragma pack(pop)
+    static_assert(sizeof(KTX2Header) == 68);
+
+    struct KTX2Level
+    {
+        uint64_t byte_offset;
+        uint64_t byte_length;
+        uint64_t uncompressed_byte_length;
+    };
+
+    template <size_t N> bool StartsWith(std::span<const uint8_t> data, const std::array<uint8_t, N>& magic)
+    {
+        return data.size() >= N && std::equal(magic.begin(), magic.end(), data.begin());
+    }
+
+    template <typename T> bool Read(std::span<const uint8_t> data, const size_t offset, T& value)
+    {
+        if (offset + sizeof(T) > data.size())
+        {
+            return false;
+        }
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        return true;
+    }
+
+    // Color textures are sampled without sRGB decoding on every path, like decoded images and the ones
+    // CompressTextures writes, so the sRGB formats load as their UNORM counterparts.
+    std::optional<Swift::Format> FromDXGIFormat(const uint32_t format)
+    {
+        switch (format)
+        {
+            case 2:
+                return Swift::Format::eRGBA32F;
+            case 10:
+                return Swift::Format::eRGBA16F;
+            case 28:
+            case 29:
+                return Swift::Format::eRGBA8_UNORM;
+            case 49:
+                return Swift::Format::eR8G8_UNORM;
+            case 61:
+                return Swift::Format::eR8_UNORM;
+            case 71:
+            case 72:
+                return Swift::Format::eBC1_UNORM;
+            case 74:
+            case 75:
+                return Swift::Format::eBC2_UNORM;
+            case 77:
+            case 78:
+                return Swift::Format::eBC3_UNORM;
+            case 80:
+                return Swift::Format::eBC4_UNORM;
+            case 81:
+                return Swift::Format::eBC4_SNORM;
+            case 83:
+                return Swift::Format::eBC5_UNORM;
+            case 84:
+                return Swift::Format::eBC5_SNORM;
+            case 95:
+                return Swift::Format::eBC6H_UF16;
+            case 96:
+                return Swift::Format::eBC6H_SF16;
+            case 98:
+            case 99:
+                return Swift::Format::eBC7_UNORM;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    // Same sRGB policy as FromDXGIFormat.
+    std::optional<Swift::Format> FromVkFormat(const uint32_t format)
+    {
+        switch (format)
+        {
+            case 9:
+                return Swift::Format::eR8_UNORM;
+            case 16:
+                return Swift::Format::eR8G8_UNORM;
+            case 37:
+            case 43:
+                return Swift::Format::eRGBA8_UNORM;
+            case 97:
+                return Swift::Format::eRGBA16F;
+            case 109:
+                return Swift::Format::eRGBA32F;
+            case 131:
+            case 132:
+            case 133:
+            case 134:
+                return Swift::Format::eBC1_UNORM;
+            case 135:
+            case 136:
+                return Swift::Format::eBC2_UNORM;
+            case 137:
+            case 138:
+                return Swift::Format::eBC3_UNORM;
+            case 139:
+                return Swift::Format::eBC4_UNORM;
+            case 140:
+                return Swift::Format::eBC4_SNORM;
+            case 141:
+                return Swift::Format::eBC5_UNORM;
+            case 142:
+                return Swift::Format::eBC5_SNORM;
+            case 143:
+                return Swift::Format::eBC6H_UF16;
+            case 144:
+                return Swift::Format::eBC6H_SF16;
+            case 145:
+            case 146:
+                return Swift::Format::eBC7_UNORM;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    std::optional<Swift::Format> FromDDSPixelFormat(const DDSPixelFormat& pixel_format)
+    {
+        if (pixel_format.flags & dds_fourcc_flag)
+        {
+            switch (pixel_format.four_cc)
+            {
+                case MakeFourCC('D', 'X', 'T', '1'):
+                    return Swift::Format::eBC1_UNORM;
+                case MakeFourCC('D', 'X', 'T', '2'):
+                case MakeFourCC('D', 'X', 'T', '3'):
+                    return Swift::Format::eBC2_UNORM;
+                case MakeFourCC('D', 'X', 'T', '4'):
+                case MakeFourCC('D', 'X', 'T', '5'):
+                    return Swift::Format::eBC3_UNORM;
+                case MakeFourCC('A', 'T', 'I', '1'):
+                case MakeFourCC('B', 'C', '4', 'U'):
+                    return Swift::Format::eBC4_UNORM;
+                case MakeFourCC('B', 'C', '4', 'S'):
+                    return Swift::Format::eBC4_SNORM;
+                case MakeFourCC('A', 'T', 'I', '2'):
+                case MakeFourCC('B', 'C', '5', 'U'):
+                    return Swift::Format::eBC5_UNORM;
+                case MakeFourCC('B', 'C', '5', 'S'):
+                    return Swift::Format::eBC5_SNORM;
+                // D3DFMT_A16B16G16R16F and D3DFMT_A32B32G32R32F.
+                case 113:
+                    return Swift::Format::eRGBA16F;
+                case 116:
+                    return Swift::Format::eRGBA32F;
+                default:
+                    return std::nullopt;
+            }
+        }
+
+        if ((pixel_format.flags & dds_rgb_flag) && pixel_format.rgb_bit_count == 32 && pixel_format.r_mask == 0xFF &&
+            pixel_format.g_mask == 0xFF00 && pixel_format.b_mask == 0xFF0000)
+        {
+            return Swift::Format::eRGBA8_UNORM;
+        }
+        return std::nullopt;
+    }
+
+    bool IsBlockCompressed(const Swift::Format format)
+    {
+        return format >= Swift::Format::eBC1_UNORM;
+    }
+
+    uint32_t GetBytesPerBlock(const Swift::Format format)
+    {
+        switch (format)
+        {
+            case Swift::Format::eRGBA8_UNORM:
+                return 4;
+            case Swift::Format::eRGBA16F:
+                return 8;
+            case Swift::Format::eRGBA32F:
+                return 16;
+            case Swift::Format::eR8_UNORM:
+                return 1;
+            case Swift::Format::eR8G8_UNORM:
+                return 2;
+            case Swift::Format::eBC1_UNORM:
+            case Swift::Format::eBC1_UNORM_SRGB:
+            case Swift::Format::eBC4_UNORM:
+            case Swift::Format::eBC4_SNORM:
+                return 8;
+            default:
+                return 16;
+        }
+    }
+
+    // Tightly packed size of one mip, the layout both containers store and CreateTexture expects.
+    size_t GetMipSize(const Swift::Format format, const uint32_t width, const uint32_t height, const uint32_t mip)
+    {
+        const uint32_t mip_width = std::max(width >> mip, 1u);
+        const uint32_t mip_height = std::max(height >> mip, 1u);
+        if (IsBlockCompressed(format))
+        {
+            return size_t((mip_width + 3) / 4) * ((mip_height + 3) / 4) * GetBytesPerBlock(format);
+        }
+        return size_t(mip_width) * mip_height * GetBytesPerBlock(format);
+    }
+
+    std::optional<Texture> LoadDDS(const std::span<const uint8_t> data, const std::string_view name)
+    {
+        DDSHeader header{};
+        if (!Read(data, dds_magic.size(), header) || header.size != sizeof(DDSHeader))
+        {
+            printf(std::format("Error: {} has an invalid DDS header\n", name).c_str());
+            return std::nullopt;
+        }
+
+        size_t offset = dds_magic.size() + sizeof(DDSHeader);
+        std::optional<Swift::Format> format;
+        uint32_t array_size = 1;
+        bool is_cube = false;
+        bool is_volume = header.caps2 & dds_volume_flag;
+        if ((header.pixel_format.flags & dds_fourcc_flag) && header.pixel_format.four_cc == MakeFourCC('D', 'X', '1', '0'))
+        {
+            DDSHeaderDX10 header_dx10{};
+            if (!Read(data, offset, header_dx10))
+            {
+                printf(std::format("Error: {} has an invalid DX10 header\n", name).c_str());
+                return std::nullopt;
+            }
+            offset += sizeof(DDSHeaderDX10);
+            format = FromDXGIFormat(header_dx10.dxgi_format);
+            array_size = std::max(header_dx10.array_size, 1u);
+            if (header_dx10.misc_flag & dx10_texture_cube_flag)
+            {
+                array_size *= 6;
+                is_cube = true;
+            }
+            is_volume = header_dx10.resource_dimension == dx10_texture_3d;
+        }
+        else
+        {
+            format = FromDDSPixelFormat(header.pixel_format);
+            if ((header.caps2 & dds_cubemap_all_faces) == dds_cubemap_all_faces)
+            {
+                array_size = 6;
+                is_cube = true;
+            }
+        }
+
+        if (!format)
+        {
+            printf(std::format("Error: {} has an unsupported DDS format\n", name).c_str());
+            return std::nullopt;
+        }
+        if (is_volume)
+        {
+            printf(std::format("Error: {} is a volume texture\n", name).c_str());
+            return std::nullopt;
+        }
+
+        Texture texture{
+            .name = std::string(name),
+            .width = header.width,
+            .height = header.height,
+            .mip_levels = uint16_t(std::max(header.mip_map_count, 1u)),
+            .array_size = uint16_t(array_size),
+            .is_cube = is_cube,
+            .format = *format,
+        };
+
+        // DDS already stores every mip of a slice before the next slice, so the payload is taken as is.
+        size_t size = 0;
+        for (uint32_t mip = 0; mip < texture.mip_levels; ++mip)
+        {
+            size += GetMipSize(texture.format, texture.width, texture.height, mip);
+        }
+        size *= texture.array_size;
+        if (offset + size > data.size())
+        {
+            printf(std::format("Error: {} is truncated\n", name).c_str());
+            return std::nullopt;
+        }
+        texture.pixels.assign(data.begin() + offset, data.begin() + offset + size);
+        return texture;
+    }
+
+    std::optional<Texture> LoadKTX2(const std::span<const uint8_t> data, const std::string_view name)
+    {
+        KTX2Header header{};
+        if (!Read(data, ktx2_magic.size(), header))
+        {
+            printf(std::format("Error: {} has an invalid KTX2 header\n", name).c_str());
+            return std::nullopt;
+        }
+
+        // BasisLZ and UASTC need the Basis Universal transcoder and zstd/zlib their decompressors, neither is a
+        // dependency here. Such files have to be converted to plain BC with ktx or basisu first.
+        if (header.supercompression_scheme != 0)
+        {
+            printf(std::format("Error: {} uses KTX2 supercompression scheme {}, which is not supported\n",
+                               name,
+                               header.supercompression_scheme)
+                       .c_str());
+            return std::nullopt;
+        }
+
+        const auto format = FromVkFormat(header.vk_format);
+        if (!format)
+        {
+            printf(std::format("Error: {} has unsupported Vulkan format {}\n", name, header.vk_format).c_str());
+            return std::nullopt;
+        }
+        if (header.pixel_depth > 1)
+        {
+            printf(std::format("Error: {} is a volume texture\n", name).c_str());
+            return std::nullopt;
+        }
+
+        Texture texture{
+            .name = std::string(name),
+            .width = header.pixel_width,
+            .height = header.pixel_height,
+            .mip_levels = uint16_t(std::max(header.level_count, 1u)),
+            .array_size = uint16_t(std::max(header.layer_count, 1u) * std::max(header.face_count, 1u)),
+            .is_cube = header.face_count == 6,
+            .format = *format,
+        };
+
+        std::vector<KTX2Level> levels(texture.mip_levels);
+        for (uint32_t mip = 0; mip < texture.mip_levels; ++mip)
+        {
+            const size_t offset = ktx2_magic.size() + sizeof(KTX2Header) + mip * sizeof(KTX2Level);
+            const size_t mip_size = GetMipSize(texture.format, texture.width, texture.height, mip);
+            auto& level = levels[mip];
+            if (!Read(data, offset, level) || level.byte_length < mip_size * texture.array_size ||
+                level.byte_offset + level.byte_length > data.size())
+            {
+                printf(std::format("Error: {} has an invalid level {}\n", name, mip).c_str());
+                return std::nullopt;
+            }
+            texture.pixels.resize(texture.pixels.size() + mip_size * texture.array_size);
+        }
+
+        // KTX2 groups every layer and face of a mip together, CreateTexture wants every mip of a slice together.
+        auto* dst = texture.pixels.data();
+        for (uint32_t slice = 0; slice < texture.array_size; ++slice)
+        {
+            for (uint32_t mip = 0; mip < texture.mip_levels; ++mip)
+            {
+                const size_t mip_size = GetMipSize(texture.format, texture.width, texture.height, mip);
+                std::memcpy(dst, data.data() + levels[mip].byte_offset + slice * mip_size, mip_size);
+                dst += mip_size;
+            }
+        }
+        return texture;
+    }
+} // namespace
+
+bool IsTextureContainer(const std::span<const uint8_t> data)
+{
+    return StartsWith(data, dds_magic) || StartsWith(data, ktx2_magic);
+}
+
+std::optional<Texture> LoadTextureContainer(const std::span<const uint8_t> data, const std::string_view name)
+{
+    if (StartsWith(data, dds_magic))
+    {
+        return LoadDDS(data, name);
+    }
+    if (StartsWith(data, ktx2_magic))
+    {
+        return LoadKTX2(data, name);
+    }
+    printf(std::format("Error: {} is not a DDS or KTX2 file\n", name).c_str());
+    return std::nullopt;
+}
+
+std::optional<Texture> LoadTextureFile(const std::string_view path)
+{
+    std::ifstream file(std::string(path), std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        printf(std::format("Error: failed to open {}\n", path).c_str());
+        return std::nullopt;
+    }
+    std::vector<uint8_t> data(file.tellg());
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return LoadTextureContainer(data, path);
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "cstdint"
+#include "optional"
+#include "span"
+#include "string_view"
+
+struct Texture;
+
+// True when the data starts with a DDS or KTX2 identifier.
+bool IsTextureContainer(std::span<const uint8_t> data);
+
+// Reads a DDS or KTX2 container into a texture with its stored format, mips and array slices, laid out slice by slice
+// the way Context::CreateTexture uploads them. Supercompressed KTX2 (BasisLZ, UASTC with zstd/zlib) is rejected.
+std::optional<Texture> LoadTextureContainer(std::span<const uint8_t> data, std::string_view name = "");
+
+std::optional<Texture> LoadTextureFile(std::string_view path);
@@ -0,0 +1,169 @@
+#include "vertex_quantizer.hpp"
+#include "importer.hpp"
+#include "algorithm"
+#include "cmath"
+#include "limits"
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+#include "glm/trigonometric.hpp"
+#include "glm/vec2.hpp"
+#include "glm/gtc/packing.hpp"
+
+namespace
+{
+    constexpr uint32_t k_normal_bits = 12;
+    constexpr uint32_t k_tangent_bits = 11;
+    constexpr uint32_t k_tangent_shift = k_normal_bits * 2;
+    constexpr uint32_t k_sign_shift = k_tangent_shift + k_tangent_bits * 2;
+
+    float SignNotZero(const float value)
+    {
+        return value >= 0.f ? 1.f : -1.f;
+    }
+
+    glm::vec2 EncodeOctahedral(glm::vec3 n)
+    {
+        n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if (n.z < 0.f)
+        {
+            return {(1.f - std::abs(n.y)) * SignNotZero(n.x), (1.f - std::abs(n.x)) * SignNotZero(n.y)};
+        }
+        return {n.x, n.y};
+    }
+
+    glm::vec3 DecodeOctahedral(const glm::vec2 encoded)
+    {
+        glm::vec3 n(encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y));
+        const float t = std::max(-n.z, 0.f);
+        n.x += n.x >= 0.f ? -t : t;
+        n.y += n.y >= 0.f ? -t : t;
+        return glm::normalize(n);
+    }
+
+    // Snorms are stored biased to 0 - 2^bits-2 so that zero stays exact.
+    float GetSnormBias(const uint32_t bits)
+    {
+        return static_cast<float>((1u << (bits - 1)) - 1);
+    }
+
+    float DecodeSnorm(const uint32_t value, const uint32_t bits)
+    {
+        const float bias = GetSnormBias(bits);
+        return (static_cast<float>(value) - bias) / bias;
+    }
+
+    glm::vec3 DecodeDirection(const uint32_t packed, const uint32_t bits)
+    {
+        const uint32_t mask = (1u << bits) - 1;
+        return DecodeOctahedral({DecodeSnorm(packed & mask, bits), DecodeSnorm(packed >> bits & mask, bits)});
+    }
+
+    // Rounding both components on their own can land up to twice as far off as the best of the four codes around the
+    // exact value, so all four are decoded and the closest one is kept.
+    uint32_t QuantizeDirection(const glm::vec3& direction, const uint32_t bits)
+    {
+        const auto bias = static_cast<uint32_t>(GetSnormBias(bits));
+        if (glm::dot(direction, direction) == 0.f)
+        {
+            return bias | bias << bits;
+        }
+
+        const glm::vec3 n = glm::normalize(direction);
+        const glm::vec2 encoded = EncodeOctahedral(n) * static_cast<float>(bias) + static_cast<float>(bias);
+        uint32_t best = 0;
+        float best_dot = -std::numeric_limits<float>::max();
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            const auto x = static_cast<uint32_t>(i & 1 ? std::ceil(encoded.x) : std::floor(encoded.x));
+            const auto y = static_cast<uint32_t>(i & 2 ? std::ceil(encoded.y) : std::floor(encoded.y));
+            const uint32_t packed = x | y << bits;
+            if (const float dot = glm::dot(n, DecodeDirection(packed, bits)); dot > best_dot)
+            {
+                best_dot = dot;
+                best = packed;
+            }
+        }
+        return best;
+    }
+
+    float GetAngleError(const glm::vec3& original, const glm::vec3& decoded)
+    {
+        if (glm::dot(original, original) == 0.f)
+        {
+            return 0.f;
+        }
+        const float cos_angle = std::clamp(glm::dot(glm::normalize(original), decoded), -1.f, 1.f);
+        return glm::degrees(std::acos(cos_angle));
+    }
+}  // namespace
+
+QuantizationReport QuantizeVertices(Mesh& mesh)
+{
+    QuantizationReport report{};
+    const auto& vertices = mesh.vertices;
+    if (vertices.empty())
+    {
+        return report;
+    }
+
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(-std::numeric_limits<float>::max());
+    for (const auto& vertex : vertices)
+    {
+        min = glm::min(min, vertex.position);
+        max = glm::max(max, vertex.position);
+    }
+    const glm::vec3 extent = max - min;
+    mesh.position_offset = min;
+    mesh.position_scale = extent / 65535.f;
+
+    mesh.quantized_vertices.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        const auto& vertex = vertices[i];
+        auto& quantized = mesh.quantized_vertices[i];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float position = extent[axis] > 0.f ? (vertex.position[axis] - min[axis]) / extent[axis] : 0.f;
+            quantized.position[axis] = static_cast<uint16_t>(std::clamp(std::lround(position * 65535.f), 0l, 65535l));
+        }
+
+        const uint64_t normal = QuantizeDirection(vertex.normal, k_normal_bits);
+        const uint64_t tangent = QuantizeDirection(glm::vec3(vertex.tangent), k_tangent_bits);
+        const uint64_t sign = vertex.tangent.w < 0.f ? 1 : 0;
+        const uint64_t packed = normal | tangent << k_tangent_shift | sign << k_sign_shift;
+        quantized.normal_tangent = {
+            static_cast<uint16_t>(packed),
+            static_cast<uint16_t>(packed >> 16),
+            static_cast<uint16_t>(packed >> 32),
+        };
+        quantized.uv = {glm::packHalf1x16(vertex.uv_x), glm::packHalf1x16(vertex.uv_y)};
+
+        const Vertex decoded = DecodeVertex(quantized, mesh.position_offset, mesh.position_scale);
+        report.max_position_error =
+            std::max(report.max_position_error, glm::distance(vertex.position, decoded.position));
+        report.max_normal_error = std::max(report.max_normal_error, GetAngleError(vertex.normal, decoded.normal));
+        report.max_tangent_error = std::max(report.max_tangent_error,
+                                            GetAngleError(glm::vec3(vertex.tangent), glm::vec3(decoded.tangent)));
+        report.max_uv_error = std::max(
+            {report.max_uv_error, std::abs(vertex.uv_x - decoded.uv_x), std::abs(vertex.uv_y - decoded.uv_y)});
+    }
+
+    std::vector<Vertex>().swap(mesh.vertices);
+    return report;
+}
+
+Vertex DecodeVertex(const QuantizedVertex& vertex, const glm::vec3& position_offset, const glm::vec3& position_scale)
+{
+    const uint64_t packed = uint64_t(vertex.normal_tangent[0]) | uint64_t(vertex.normal_tangent[1]) << 16 |
+                            uint64_t(vertex.normal_tangent[2]) << 32;
+    const glm::vec3 position(vertex.position[0], vertex.position[1], vertex.position[2]);
+    const glm::vec3 tangent = DecodeDirection(static_cast<uint32_t>(packed >> k_tangent_shift), k_tangent_bits);
+    return Vertex{
+        .position = position_offset + position * position_scale,
+        .uv_x = glm::unpackHalf1x16(vertex.uv[0]),
+        .normal = DecodeDirection(static_cast<uint32_t>(packed), k_normal_bits),
+        .uv_y = glm::unpackHalf1x16(vertex.uv[1]),
+        .tangent = glm::vec4(tangent, packed >> k_sign_shift & 1 ? -1.f : 1.f),
+    };
+}
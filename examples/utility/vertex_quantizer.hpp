@@ -0,0 +1,36 @@
+#pragma once
+#include "array"
+#include "cstdint"
+#include "glm/vec3.hpp"
+
+struct Vertex;
+struct Mesh;
+
+// 16 bytes against the 48 of Vertex, decoded by DecodeVertex here and in hello_pbr_inc.slang.
+struct QuantizedVertex
+{
+    // Unorm16 inside the mesh bounds, decoded as Mesh::position_offset + position * Mesh::position_scale.
+    std::array<uint16_t, 3> position;
+    // One 48 bit field: the octahedral normal as two 12 bit snorms from bit 0, the octahedral tangent as two 11 bit
+    // snorms from bit 24 and the bitangent sign in bit 46 (set when negative).
+    std::array<uint16_t, 3> normal_tangent;
+    // Half precision.
+    std::array<uint16_t, 2> uv;
+};
+static_assert(sizeof(QuantizedVertex) == 16);
+
+struct QuantizationReport
+{
+    // In mesh units.
+    float max_position_error = 0.f;
+    // In degrees.
+    float max_normal_error = 0.f;
+    float max_tangent_error = 0.f;
+    float max_uv_error = 0.f;
+};
+
+// Moves mesh.vertices into mesh.quantized_vertices and fills the position bounds. Positions are quantized against the
+// mesh bounds rather than per meshlet since meshlets share vertices. The report is measured by decoding every vertex.
+QuantizationReport QuantizeVertices(Mesh& mesh);
+
+Vertex DecodeVertex(const QuantizedVertex& vertex, const glm::vec3& position_offset, const glm::vec3& position_scale);
@@ -2,6 +2,9 @@
 #include "swift_command.hpp"
 #include "swift_macros.hpp"
 #include "d3d12_descriptor.hpp"
+#include "array"
+#include "optional"
+#include "vector"
 
 namespace Swift::D3D12
 {
@@ -48,17 +51,53 @@ namespace Swift::D3D12
         void ClearDepthStencil(ITextureView* depth_stencil, float depth, uint8_t stencil) override;
         void TransitionImage(ITexture* image, ResourceState new_state) override;
         void TransitionBuffer(IBuffer* buffer, ResourceState new_state) override;
+        void TransitionResources(std::span<const TextureTransition> textures,
+                                 std::span<const BufferTransition> buffers) override;
         void UAVBarrier(IBuffer* buffer) override;
         void UAVBarrier(ITexture* texture) override;
+        void InvalidateState() override;
+        const CommandStatistics& GetStatistics() const override { return m_statistics; }
 
     private:
+        // Root parameters 1 to 3, see Context::CreateRootSignature.
+        static constexpr uint32_t k_first_constant_buffer_slot = 1;
+        static constexpr uint32_t k_constant_buffer_slot_count = 3;
+
+        // What the list has bound for one pipeline type. Root arguments are kept separately for graphics and compute.
+        struct RootState
+        {
+            bool root_signature = false;
+            std::array<D3D12_GPU_VIRTUAL_ADDRESS, k_constant_buffer_slot_count> constant_buffers{};
+        };
+
+        RootState& GetRootState(ShaderType type);
+        void BindRootSignature(ShaderType type);
+        // Issues the constant buffers that changed since the last draw or dispatch of the bound shader's type.
+        void FlushConstantBuffers();
+
+
         Context* m_context;
         QueueType m_type;
+        bool m_enhanced_barriers = false;
         ID3D12GraphicsCommandList10* m_list = nullptr;
         ID3D12CommandAllocator* m_allocator = nullptr;
         DescriptorHeap* m_cbv_srv_uav_heap = nullptr;
         DescriptorHeap* m_sampler_heap = nullptr;
         ID3D12RootSignature* m_root_signature = nullptr;
         IShader* m_shader = nullptr;
+
+        bool m_descriptor_heaps = false;
+        ID3D12PipelineState* m_pipeline = nullptr;
+        RootState m_graphics_state{};
+        RootState m_compute_state{};
+        std::array<D3D12_GPU_VIRTUAL_ADDRESS, k_constant_buffer_slot_count> m_constant_buffers{};
+        std::optional<D3D12_VIEWPORT> m_viewport;
+        std::optional<D3D12_RECT> m_scissor;
+        CommandStatistics m_statistics{};
+
+        // Scratch for batching, kept to avoid allocating per transition.
+        std::vector<D3D12_TEXTURE_BARRIER> m_texture_barriers;
+        std::vector<D3D12_BUFFER_BARRIER> m_buffer_barriers;
+        std::vector<D3D12_RESOURCE_BARRIER> m_legacy_barriers;
     };
 }  // namespace Swift::D3D12
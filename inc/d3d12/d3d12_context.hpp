@@ -15,7 +15,10 @@ namespace Swift::D3D12
     class CommandSignature : public ICommandSignature
     {
     public:
-        explicit CommandSignature(ID3D12Device14* device, ID3D12RootSignature* root_signature, std::span<IndirectArgument> indirect_arguments);
+        CommandSignature(ID3D12Device14* device,
+                         ID3D12RootSignature* root_signature,
+                         std::span<IndirectArgument> indirect_arguments,
+                         uint32_t stride);
         ~CommandSignature() override;
         SWIFT_NO_COPY(CommandSignature);
         SWIFT_NO_MOVE(CommandSignature);
@@ -38,6 +41,7 @@ namespace Swift::D3D12
         [[nodiscard]] void* GetSwapchain() const override;
         [[nodiscard]] IDXGIFactory7* GetFactory() const { return m_factory; }
         [[nodiscard]] DescriptorHeap* GetRTVHeap() const { return m_rtv_heap.get(); }
+        [[nodiscard]] bool UsesEnhancedBarriers() const { return m_enhanced_barriers; }
         [[nodiscard]] DescriptorHeap* GetDSVHeap() const { return m_dsv_heap.get(); }
         [[nodiscard]] DescriptorHeap* GetCBVSRVUAVHeap() const { return m_cbv_srv_uav_heap.get(); }
         [[nodiscard]] DescriptorHeap* GetSamplerHeap() const { return m_sampler_heap.get(); }
@@ -45,6 +49,7 @@ namespace Swift::D3D12
 
         ICommand* CreateCommand(IQueue* queue, std::string_view debug_name = "") override;
         IQueue* CreateQueue(const QueueCreateInfo& info) override;
+        IFence* CreateFence(uint64_t initial_value = 0) override;
         IBuffer* CreateBuffer(const BufferCreateInfo& info) override;
         ITexture* CreateTexture(const TextureCreateInfo& info) override;
         ISampler* CreateSampler(const SamplerCreateInfo& info) override;
@@ -52,10 +57,11 @@ namespace Swift::D3D12
         IShader* CreateShader(const ComputeShaderCreateInfo& info) override;
         ITextureView* CreateTextureView(ITexture* texture, const TextureViewCreateInfo& info) override;
         IBufferView* CreateBufferView(IBuffer* buffer, const BufferViewCreateInfo& info) override;
-        ICommandSignature* CreateCommandSignature(std::span<IndirectArgument> indirect_arguments) override;
+        ICommandSignature* CreateCommandSignature(std::span<IndirectArgument> indirect_arguments, uint32_t stride) override;
 
         void DestroyCommand(ICommand* command) override;
         void DestroyQueue(IQueue* queue) override;
+        void DestroyFence(IFence* fence) override;
         void DestroyBuffer(IBuffer* buffer) override;
         void DestroyTexture(ITexture* texture) override;
         void DestroyShader(IShader* shader) override;
@@ -66,6 +72,7 @@ namespace Swift::D3D12
 
         void NewFrame() override;
         void Present(bool vsync) override;
+        void FlushUploads() override;
         void ResizeBuffers(uint32_t width, uint32_t height) override;
         uint32_t CalculateAlignedTextureSize(const TextureCreateInfo& info) override;
         uint32_t CalculateAlignedBufferSize(const BufferCreateInfo& info) override;
@@ -76,14 +83,27 @@ namespace Swift::D3D12
     private:
         void CreateBackend();
         void CreateDevice();
+        void QueryFeatures(const ContextCreateInfo& create_info);
         void CreateAllocator();
         void CreateDescriptorHeaps(const ContextCreateInfo& create_info);
-        void CreateFrameData();
+        void CreateFrameData(const ContextCreateInfo& create_info);
         void CreateQueues();
         void CreateTextures(const ContextCreateInfo& create_info);
         void CreateSwapchain(const ContextCreateInfo& create_info);
         void CreateMipMapShader();
         void CreateRootSignature();
+        ICommand* GetUploadCommand();
+        void RetireUploads();
+        void GenerateMips(ICommand* command, ITexture* texture, ReductionType reduction);
+        ISampler* GetMipMapSampler(ReductionType reduction) const;
+
+        struct UploadBatch
+        {
+            ICommand* command;
+            uint64_t fence_value;
+            std::vector<IBuffer*> buffers;
+            std::vector<ITextureView*> texture_views;
+        };
 
         IDXGIAdapter4* m_adapter = nullptr;
         IDXGIFactory7* m_factory = nullptr;
@@ -95,9 +115,12 @@ namespace Swift::D3D12
         std::unique_ptr<DescriptorHeap> m_cbv_srv_uav_heap{};
         std::unique_ptr<DescriptorHeap> m_sampler_heap{};
         IShader* m_mipmap_shader{};
+        UploadBatch m_upload_batch{};
+        std::vector<UploadBatch> m_pending_uploads;
         DXGI_ADAPTER_DESC3 m_adapter_desc{};
         ID3D12RootSignature* m_root_signature = nullptr;
-        ISampler* m_mipmap_sampler = nullptr;
+        std::array<ISampler*, 4> m_mipmap_samplers{};
         D3D12MA::Allocator* m_allocator;
+        bool m_enhanced_barriers = false;
     };
 }  // namespace Swift::D3D12
@@ -0,0 +1,25 @@
+#pragma once
+#include "swift_fence.hpp"
+#define NOMINMAX
+#include "directx/d3d12.h"
+
+namespace Swift::D3D12
+{
+    class Fence final : public IFence
+    {
+    public:
+        SWIFT_NO_COPY(Fence);
+        SWIFT_NO_MOVE(Fence);
+
+        Fence(ID3D12Device14* device, uint64_t initial_value);
+        ~Fence() override;
+
+        void* GetFence() override { return m_fence; }
+        uint64_t GetCompletedValue() override { return m_fence->GetCompletedValue(); }
+        void Signal(uint64_t value) override { m_fence->Signal(value); }
+        void SetEventOnCompletion(uint64_t value, FenceEvent& event) override;
+
+    private:
+        ID3D12Fence* m_fence = nullptr;
+    };
+}  // namespace Swift::D3D12
@@ -1,4 +1,5 @@
 #pragma once
+#include "d3d12_fence.hpp"
 #include "swift_queue.hpp"
 #include "swift_structs.hpp"
 #define NOMINMAX
@@ -16,13 +17,16 @@ namespace Swift::D3D12
         ~Queue() override;
 
         void* GetQueue() override { return m_queue; }
-        void Wait(uint64_t fence_value) override;
+        IFence* GetFence() override { return &m_fence; }
         void WaitIdle() override;
-        uint64_t Execute(std::span<ICommand*> commands) override;
+        uint64_t Submit(const SubmitInfo& info) override;
+        uint64_t Signal() override;
+        void Signal(IFence* fence, uint64_t value) override;
+        void WaitForFence(IFence* fence, uint64_t value) override;
 
     private:
         uint64_t m_fence_value = 0;
         ID3D12CommandQueue* m_queue = nullptr;
-        ID3D12Fence* m_fence = nullptr;
+        Fence m_fence;
     };
 }  // namespace Swift::D3D12
@@ -269,8 +269,14 @@ namespace Swift::RG
         void Execute();
 
     private:
+        // A node's transitions are gathered and recorded as one barrier before it runs.
+        void AddTransitions(const std::vector<ResourceHandle>& handles, ResourceState state);
+        void FlushTransitions();
+
         std::unordered_map<std::string, std::variant<RenderNode, ComputeNode, CopyNode>> m_nodes;
         std::vector<ITextureView*> m_render_targets;
+        std::vector<TextureTransition> m_texture_transitions;
+        std::vector<BufferTransition> m_buffer_transitions;
         ICommand* m_command = nullptr;
     };
 }  // namespace Swift::RG
\ No newline at end of file
@@ -4,6 +4,11 @@
 #include "swift_structs.hpp"
 
 #include <filesystem>
+#include <format>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
 
 namespace Swift
 {
@@ -70,6 +75,12 @@ namespace Swift
             return *this;
         }
 
+        TextureBuilder& SetMipReduction(const ReductionType reduction)
+        {
+            m_mip_reduction = reduction;
+            return *this;
+        }
+
         TextureBuilder& SetArraySize(const uint32_t array_size)
         {
             m_array_size = array_size;
@@ -109,6 +120,7 @@ namespace Swift
                 .array_size = m_array_size,
                 .format = m_format,
                 .gen_mipmaps = m_gen_mipmaps,
+                .mip_reduction = m_mip_reduction,
                 .data = m_data,
                 .msaa = m_msaa,
                 .flags = m_texture_flags,
@@ -129,6 +141,7 @@ namespace Swift
         uint16_t m_mip_levels = 1;
         uint16_t m_array_size = 1;
         bool m_gen_mipmaps = false;
+        ReductionType m_mip_reduction = ReductionType::eStandard;
         Format m_format = Format::eRGBA8_UNORM;
         EnumFlags<TextureFlags> m_texture_flags = TextureFlags::eNone;
         std::string_view m_name;
@@ -459,4 +472,149 @@ namespace Swift
         std::string_view m_name;
     };
 
+    // Checks a command signature against the root signature (32 root constants at parameter 0, constant buffers at 1 to
+    // 3) and the packing rules of indirect commands. stride 0 means tightly packed. Returns the first problem found.
+    inline std::optional<std::string> ValidateIndirectArguments(const std::span<const IndirectArgument> arguments,
+                                                                const uint32_t stride)
+    {
+        constexpr uint32_t max_root_constants = 32;
+        uint64_t written_constants = 0;
+        uint32_t written_slots = 0;
+        uint32_t size = 0;
+        for (size_t i = 0; i < arguments.size(); ++i)
+        {
+            const auto& argument = arguments[i];
+            const bool is_dispatch = argument.type == IndirectArgumentType::eDispatch ||
+                                     argument.type == IndirectArgumentType::eMeshDispatch;
+            if (is_dispatch != (i + 1 == arguments.size()))
+            {
+                return std::format("Argument {}: the dispatch has to be the last argument and there can only be one", i);
+            }
+
+            switch (argument.type)
+            {
+                case IndirectArgumentType::ePushConstant:
+                case IndirectArgumentType::eDrawId:
+                {
+                    const uint32_t count = GetIndirectArgumentSize(argument) / sizeof(uint32_t);
+                    if (count == 0 || GetIndirectArgumentSize(argument) % sizeof(uint32_t) != 0)
+                    {
+                        return std::format("Argument {}: root constants are set in whole 32 bit values", i);
+                    }
+                    if (argument.offset + count > max_root_constants)
+                    {
+                        return std::format("Argument {}: root constants {} to {} are past the {} available",
+                                           i,
+                                           argument.offset,
+                                           argument.offset + count - 1,
+                                           max_root_constants);
+                    }
+                    const uint64_t mask = ((uint64_t{1} << count) - 1) << argument.offset;
+                    if (written_constants & mask)
+                    {
+                        return std::format("Argument {}: root constants written by an earlier argument", i);
+                    }
+                    written_constants |= mask;
+                    break;
+                }
+                case IndirectArgumentType::eConstantBuffer:
+                    if (argument.slot < 1 || argument.slot > 3)
+                    {
+                        return std::format("Argument {}: root parameter {} is not a constant buffer slot", i, argument.slot);
+                    }
+                    if (written_slots & 1u << argument.slot)
+                    {
+                        return std::format("Argument {}: constant buffer slot {} written twice", i, argument.slot);
+                    }
+                    written_slots |= 1u << argument.slot;
+                    break;
+                case IndirectArgumentType::eDispatch:
+                case IndirectArgumentType::eMeshDispatch:
+                    break;
+            }
+            size += GetIndirectArgumentSize(argument);
+        }
+
+        if (arguments.empty())
+        {
+            return std::string("A command signature needs a dispatch");
+        }
+        if (stride != 0 && (stride % sizeof(uint32_t) != 0 || stride < size))
+        {
+            return std::format("Stride {} does not hold the {} bytes of arguments or is not 4 byte aligned", stride, size);
+        }
+        return std::nullopt;
+    }
+
+    // Arguments are laid out in the order they are added. Pass sizeof of the struct the argument buffer holds as the
+    // stride and compare offsetof of its members against GetArgumentOffset.
+    struct CommandSignatureBuilder
+    {
+        explicit CommandSignatureBuilder(IContext* context, const uint32_t stride = 0) : m_context(context), m_stride(stride)
+        {
+        }
+
+        // offset in 32 bit values, size in bytes.
+        CommandSignatureBuilder& AddPushConstants(const uint32_t size, const uint32_t offset = 0)
+        {
+            m_arguments.emplace_back(
+                IndirectArgument{.type = IndirectArgumentType::ePushConstant, .size = size, .offset = offset});
+            return *this;
+        }
+
+        CommandSignatureBuilder& AddDrawId(const uint32_t offset)
+        {
+            m_arguments.emplace_back(IndirectArgument{.type = IndirectArgumentType::eDrawId, .offset = offset});
+            return *this;
+        }
+
+        CommandSignatureBuilder& AddConstantBuffer(const uint32_t slot)
+        {
+            m_arguments.emplace_back(IndirectArgument{.type = IndirectArgumentType::eConstantBuffer, .slot = slot});
+            return *this;
+        }
+
+        CommandSignatureBuilder& AddDispatch()
+        {
+            m_arguments.emplace_back(IndirectArgument{.type = IndirectArgumentType::eDispatch});
+            return *this;
+        }
+
+        CommandSignatureBuilder& AddMeshDispatch()
+        {
+            m_arguments.emplace_back(IndirectArgument{.type = IndirectArgumentType::eMeshDispatch});
+            return *this;
+        }
+
+        // Byte offset of the argument within one command.
+        [[nodiscard]] uint32_t GetArgumentOffset(const size_t index) const
+        {
+            uint32_t offset = 0;
+            for (size_t i = 0; i < index && i < m_arguments.size(); ++i)
+            {
+                offset += GetIndirectArgumentSize(m_arguments[i]);
+            }
+            return offset;
+        }
+
+        [[nodiscard]] uint32_t GetStride() const { return m_stride != 0 ? m_stride : GetArgumentOffset(m_arguments.size()); }
+        [[nodiscard]] std::optional<std::string> Validate() const { return ValidateIndirectArguments(m_arguments, m_stride); }
+
+        // nullptr when the layout is invalid.
+        [[nodiscard]] ICommandSignature* Build() const
+        {
+            if (const auto error = Validate())
+            {
+                printf(std::format("Invalid command signature: {}\n", error.value()).c_str());
+                return nullptr;
+            }
+            auto arguments = m_arguments;
+            return m_context->CreateCommandSignature(arguments, m_stride);
+        }
+
+    private:
+        IContext* m_context = nullptr;
+        uint32_t m_stride = 0;
+        std::vector<IndirectArgument> m_arguments;
+    };
 }  // namespace Swift
@@ -8,6 +8,35 @@ namespace Swift
 {
     class ICommandSignature;
     class IContext;
+
+    struct StateCounter
+    {
+        uint32_t issued = 0;
+        uint32_t filtered = 0;
+    };
+
+    // API calls made and skipped because the state was already bound, since the last Begin.
+    struct CommandStatistics
+    {
+        StateCounter pipelines;
+        StateCounter root_signatures;
+        StateCounter constant_buffers;
+        StateCounter viewports;
+        StateCounter scissors;
+    };
+
+    struct TextureTransition
+    {
+        ITexture* texture;
+        ResourceState state;
+    };
+
+    struct BufferTransition
+    {
+        IBuffer* buffer;
+        ResourceState state;
+    };
+
     class ICommand
     {
     public:
@@ -58,9 +87,17 @@ namespace Swift
         virtual void ClearDepthStencil(ITextureView* texture_handle, float depth, uint8_t stencil) = 0;
         virtual void TransitionImage(ITexture* image, ResourceState new_state) = 0;
         virtual void TransitionBuffer(IBuffer* buffer, ResourceState new_state) = 0;
+        // All transitions in one barrier call. Resources already in the requested state are skipped.
+        virtual void TransitionResources(std::span<const TextureTransition> textures,
+                                         std::span<const BufferTransition> buffers) = 0;
         virtual void UAVBarrier(IBuffer* buffer) = 0;
         virtual void UAVBarrier(ITexture* texture) = 0;
 
+        // Bound state is cached so redundant binds are skipped. Recording into GetCommandList() directly bypasses the
+        // cache, call this afterwards so the next binds are issued again.
+        virtual void InvalidateState() = 0;
+        [[nodiscard]] virtual const CommandStatistics& GetStatistics() const = 0;
+
     protected:
         SWIFT_CONSTRUCT(ICommand);
     };
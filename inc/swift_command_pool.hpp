@@ -0,0 +1,57 @@
+#pragma once
+#include "swift_macros.hpp"
+#include "cstdint"
+#include "mutex"
+#include "string_view"
+#include "vector"
+
+namespace Swift
+{
+    class ICommand;
+    class IContext;
+    class IQueue;
+
+    // Hands out command lists for one queue, any number per frame. Every list has its own allocator, so threads record
+    // into the lists they acquired concurrently, and a list returns to the pool only once the fence value of the frame
+    // that used it has been reached. Acquire is the only thread safe call, the frame calls belong to one thread.
+    class CommandPool
+    {
+    public:
+        CommandPool(IContext* context, IQueue* queue, uint32_t frame_count);
+        ~CommandPool();
+        SWIFT_NO_COPY(CommandPool);
+        SWIFT_NO_MOVE(CommandPool);
+
+        // Waits until the GPU finished the frame that last used the slot and recycles its lists.
+        void BeginFrame(uint32_t frame_index);
+        // A list that is not recording yet, Begin resets its allocator. The debug name only applies to new lists.
+        [[nodiscard]] ICommand* Acquire(std::string_view debug_name = "");
+        // The fence value on the pool's queue that retires every list acquired since BeginFrame. Lists executed before
+        // the value was signaled are covered, so the last submission of the frame is enough.
+        void EndFrame(uint64_t fence_value);
+        // Creates lists up front, new lists are otherwise created through the context inside Acquire.
+        void Reserve(uint32_t count);
+
+        // In acquisition order. Acquiring on one thread in submission order and recording on others keeps the order
+        // deterministic.
+        [[nodiscard]] const std::vector<ICommand*>& GetFrameCommands() const { return m_frames[m_frame_index].commands; }
+        [[nodiscard]] uint32_t GetFrameIndex() const { return m_frame_index; }
+        [[nodiscard]] uint32_t GetFrameCount() const { return static_cast<uint32_t>(m_frames.size()); }
+        [[nodiscard]] IQueue* GetQueue() const { return m_queue; }
+
+    private:
+        struct Frame
+        {
+            std::vector<ICommand*> commands;
+            uint64_t fence_value = 0;
+        };
+
+        IContext* m_context;
+        IQueue* m_queue;
+        std::vector<Frame> m_frames;
+        uint32_t m_frame_index = 0;
+        std::mutex m_mutex;
+        std::vector<ICommand*> m_free_commands;
+        std::vector<ICommand*> m_commands;
+    };
+}  // namespace Swift
@@ -0,0 +1,331 @@
+#pragma once
+#include "swift_command.hpp"
+#include "swift_macros.hpp"
+#include "cstddef"
+#include "memory"
+#include "string"
+#include "vector"
+
+namespace Swift
+{
+    enum class CommandType : uint32_t
+    {
+        eSetViewport,
+        eSetScissor,
+        ePushConstants,
+        eBindShader,
+        eDispatchMesh,
+        eExecuteIndirect,
+        eDispatchCompute,
+        eCopyBufferToTexture,
+        eCopyTextureToTexture,
+        eCopyBufferToBuffer,
+        eBindConstantBuffer,
+        eBeginRender,
+        eEndRender,
+        eClearRenderTarget,
+        eClearDepthStencil,
+        eTransitionImage,
+        eTransitionBuffer,
+        eUAVBarrierBuffer,
+        eUAVBarrierTexture,
+        eInvalidateState,
+        eTransitionResources,
+    };
+
+    // Every packet is a header followed by its command struct and any trailing data. size covers all of it and is a
+    // multiple of k_command_alignment, so the next header follows directly. Resources are stored as the pointers they
+    // were recorded with, which keeps them usable as ids in a serialized stream.
+    constexpr size_t k_command_alignment = 8;
+
+    struct CommandHeader
+    {
+        CommandType type;
+        uint32_t size;
+    };
+
+    struct EmptyCommand
+    {
+    };
+
+    struct SetViewportCommand
+    {
+        Viewport viewport;
+    };
+
+    struct SetScissorCommand
+    {
+        Scissor scissor;
+    };
+
+    // Followed by size bytes of constants.
+    struct PushConstantsCommand
+    {
+        uint32_t size;
+        uint32_t offset;
+    };
+
+    struct BindShaderCommand
+    {
+        IShader* shader;
+    };
+
+    // eDispatchMesh and eDispatchCompute.
+    struct DispatchCommand
+    {
+        uint32_t group_x;
+        uint32_t group_y;
+        uint32_t group_z;
+    };
+
+    struct ExecuteIndirectCommand
+    {
+        ICommandSignature* signature;
+        IBuffer* argument_buffer;
+        IBuffer* count_buffer;
+        uint32_t max_commands;
+        uint32_t argument_offset;
+        uint32_t count_offset;
+    };
+
+    struct CopyBufferToTextureCommand
+    {
+        IBuffer* buffer;
+        ITexture* texture;
+        uint16_t mip_levels;
+        uint16_t array_size;
+    };
+
+    struct CopyTextureToTextureCommand
+    {
+        ITexture* src;
+        ITexture* dst;
+        TextureCopyRegion region;
+    };
+
+    struct CopyBufferToBufferCommand
+    {
+        IBuffer* src;
+        IBuffer* dst;
+        BufferCopyRegion region;
+    };
+
+    struct BindConstantBufferCommand
+    {
+        IBuffer* buffer;
+        uint32_t slot;
+        uint32_t offset;
+    };
+
+    // Followed by color_count RenderAttachmentInfos.
+    struct BeginRenderCommand
+    {
+        uint32_t color_count;
+        bool has_depth;
+        DepthAttachmentInfo depth;
+    };
+
+    struct ClearRenderTargetCommand
+    {
+        ITextureView* render_target;
+        Float4 color;
+    };
+
+    struct ClearDepthStencilCommand
+    {
+        ITextureView* depth_stencil;
+        float depth;
+        uint8_t stencil;
+    };
+
+    struct TransitionImageCommand
+    {
+        ITexture* texture;
+        ResourceState state;
+    };
+
+    struct TransitionBufferCommand
+    {
+        IBuffer* buffer;
+        ResourceState state;
+    };
+
+    // Followed by texture_count TextureTransitions, then buffer_count BufferTransitions.
+    struct TransitionResourcesCommand
+    {
+        uint32_t texture_count;
+        uint32_t buffer_count;
+    };
+
+    struct UAVBarrierBufferCommand
+    {
+        IBuffer* buffer;
+    };
+
+    struct UAVBarrierTextureCommand
+    {
+        ITexture* texture;
+    };
+
+    // Linear allocator for command packets. Memory comes in blocks that are kept across Reset, so recording the same
+    // frame again does not allocate.
+    class CommandArena
+    {
+    public:
+        explicit CommandArena(size_t block_size = 64 * 1024);
+        SWIFT_NO_COPY(CommandArena);
+        SWIFT_NO_MOVE(CommandArena);
+
+        // Aligned to k_command_alignment. Allocations larger than the block size get a block of their own.
+        [[nodiscard]] std::byte* Allocate(size_t size);
+        void Reset();
+        // The used part of every block in allocation order. Allocations never straddle blocks.
+        [[nodiscard]] const std::vector<std::span<const std::byte>>& GetBlocks() const { return m_used_blocks; }
+        [[nodiscard]] size_t GetUsedSize() const;
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<std::byte[]> data;
+            size_t capacity = 0;
+        };
+
+        size_t m_block_size;
+        std::vector<Block> m_blocks;
+        std::vector<std::span<const std::byte>> m_used_blocks;
+    };
+
+    // Records into a CommandArena instead of an API, on any platform. ReplayCommands turns the stream into calls on a
+    // backend command afterwards, any number of times. Resource states are tracked by the command the stream is replayed
+    // into, so transitions resolve in replay order.
+    class CommandRecorder final : public ICommand
+    {
+    public:
+        explicit CommandRecorder(size_t block_size = 64 * 1024);
+        SWIFT_NO_COPY(CommandRecorder);
+        SWIFT_NO_MOVE(CommandRecorder);
+
+        void* GetCommandList() override { return nullptr; }
+        void* GetCommandAllocator() override { return nullptr; }
+        // Begin drops the previous recording, End marks the stream complete.
+        void Begin() override;
+        void End() override;
+        void SetViewport(const Viewport& viewport) override;
+        void SetScissor(const Scissor& scissor) override;
+        void PushConstants(const void* data, uint32_t size, uint32_t offset = 0) override;
+        void BindShader(IShader* shader) override;
+        void DispatchMesh(uint32_t group_x, uint32_t group_y, uint32_t group_z) override;
+        void ExecuteIndirect(ICommandSignature* signature,
+                             uint32_t max_commands,
+                             IBuffer* argument_buffer,
+                             uint32_t argument_offset,
+                             IBuffer* count_buffer,
+                             uint32_t count_offset) override;
+        void DispatchCompute(uint32_t group_x, uint32_t group_y, uint32_t group_z) override;
+        void CopyBufferToTexture(IBuffer* buffer, ITexture* texture, uint16_t mip_levels = 1, uint16_t array_size = 1) override;
+        void CopyTextureToTexture(ITexture* src, ITexture* dst, const TextureCopyRegion& copy_region) override;
+        void CopyBufferToBuffer(IBuffer* src, IBuffer* dst, const BufferCopyRegion& region) override;
+        void BindConstantBuffer(IBuffer* buffer, uint32_t slot, uint32_t offset = 0) override;
+        void BeginRender(std::span<const RenderAttachmentInfo> color_attachments,
+                         const std::optional<const DepthAttachmentInfo>& depth_attachment) override;
+        using ICommand::BeginRender;
+        void EndRender() override;
+        void ClearRenderTarget(ITextureView* render_target, const Float4& color) override;
+        void ClearDepthStencil(ITextureView* depth_stencil, float depth, uint8_t stencil) override;
+        void TransitionImage(ITexture* image, ResourceState new_state) override;
+        void TransitionBuffer(IBuffer* buffer, ResourceState new_state) override;
+        void TransitionResources(std::span<const TextureTransition> textures,
+                                 std::span<const BufferTransition> buffers) override;
+        void UAVBarrier(IBuffer* buffer) override;
+        void UAVBarrier(ITexture* texture) override;
+        // Recorded as well, so the command replayed into drops its cache at the same point.
+        void InvalidateState() override;
+        const CommandStatistics& GetStatistics() const override { return m_statistics; }
+
+        [[nodiscard]] const std::vector<std::span<const std::byte>>& GetStream() const { return m_arena.GetBlocks(); }
+        [[nodiscard]] uint32_t GetCommandCount() const { return m_command_count; }
+        [[nodiscard]] bool IsRecording() const { return m_recording; }
+        // The packets as one contiguous buffer, for writing a frame out and replaying it later.
+        [[nodiscard]] std::vector<std::byte> Serialize() const;
+
+    private:
+        template<typename T>
+        T& Emplace(CommandType type, size_t trailing_size = 0);
+
+        CommandArena m_arena;
+        uint32_t m_command_count = 0;
+        bool m_recording = false;
+        CommandStatistics m_statistics{};
+    };
+
+    // Calls command for every packet in order. Stops at the first malformed packet and returns false, the commands
+    // before it have been replayed.
+    bool ReplayCommands(std::span<const std::span<const std::byte>> stream, ICommand* command);
+    bool ReplayCommands(std::span<const std::byte> data, ICommand* command);
+
+    struct CommandValidationError
+    {
+        uint32_t command_index;
+        std::string message;
+    };
+
+    // Checks the calls it receives without an API behind it, so streams recorded anywhere can be checked on any
+    // platform: binds and draws against the bound shader type, render pass nesting, root slots and argument ranges.
+    class CommandValidator final : public ICommand
+    {
+    public:
+        CommandValidator() = default;
+        SWIFT_NO_COPY(CommandValidator);
+        SWIFT_NO_MOVE(CommandValidator);
+
+        void* GetCommandList() override { return nullptr; }
+        void* GetCommandAllocator() override { return nullptr; }
+        void Begin() override;
+        void End() override;
+        void SetViewport(const Viewport& viewport) override;
+        void SetScissor(const Scissor& scissor) override;
+        void PushConstants(const void* data, uint32_t size, uint32_t offset = 0) override;
+        void BindShader(IShader* shader) override;
+        void DispatchMesh(uint32_t group_x, uint32_t group_y, uint32_t group_z) override;
+        void ExecuteIndirect(ICommandSignature* signature,
+                             uint32_t max_commands,
+                             IBuffer* argument_buffer,
+                             uint32_t argument_offset,
+                             IBuffer* count_buffer,
+                             uint32_t count_offset) override;
+        void DispatchCompute(uint32_t group_x, uint32_t group_y, uint32_t group_z) override;
+        void CopyBufferToTexture(IBuffer* buffer, ITexture* texture, uint16_t mip_levels = 1, uint16_t array_size = 1) override;
+        void CopyTextureToTexture(ITexture* src, ITexture* dst, const TextureCopyRegion& copy_region) override;
+        void CopyBufferToBuffer(IBuffer* src, IBuffer* dst, const BufferCopyRegion& region) override;
+        void BindConstantBuffer(IBuffer* buffer, uint32_t slot, uint32_t offset = 0) override;
+        void BeginRender(std::span<const RenderAttachmentInfo> color_attachments,
+                         const std::optional<const DepthAttachmentInfo>& depth_attachment) override;
+        using ICommand::BeginRender;
+        void EndRender() override;
+        void ClearRenderTarget(ITextureView* render_target, const Float4& color) override;
+        void ClearDepthStencil(ITextureView* depth_stencil, float depth, uint8_t stencil) override;
+        void TransitionImage(ITexture* image, ResourceState new_state) override;
+        void TransitionBuffer(IBuffer* buffer, ResourceState new_state) override;
+        void TransitionResources(std::span<const TextureTransition> textures,
+                                 std::span<const BufferTransition> buffers) override;
+        void UAVBarrier(IBuffer* buffer) override;
+        void UAVBarrier(ITexture* texture) override;
+        void InvalidateState() override;
+        const CommandStatistics& GetStatistics() const override { return m_statistics; }
+
+        // Begin clears them, End adds a render pass that is still open.
+        [[nodiscard]] const std::vector<CommandValidationError>& GetErrors() const { return m_errors; }
+        [[nodiscard]] bool IsValid() const { return m_errors.empty(); }
+
+    private:
+        void Error(std::string message);
+        void RequireShader(ShaderType type, const char* command);
+        void RequireOutsideRender(const char* command);
+
+        IShader* m_shader = nullptr;
+        bool m_in_render = false;
+        uint32_t m_command_index = 0;
+        std::vector<CommandValidationError> m_errors;
+        CommandStatistics m_statistics{};
+    };
+}  // namespace Swift
@@ -1,15 +1,19 @@
 #pragma once
 #include "swift_command.hpp"
+#include "swift_command_pool.hpp"
+#include "swift_fence.hpp"
 #include "swift_macros.hpp"
 #include "swift_queue.hpp"
 #include "swift_texture.hpp"
 #include "swift_shader.hpp"
 #include "swift_structs.hpp"
 #include "array"
+#include "span"
 #include "swift_texture_view.hpp"
 #include "swift_buffer_view.hpp"
 #include "swift_sampler.hpp"
 #include "swift_buffer.hpp"
+#include "memory"
 #include "vector"
 
 namespace Swift
@@ -21,8 +25,17 @@ namespace Swift
         SWIFT_NO_COPY(ICommandSignature);
         SWIFT_NO_MOVE(ICommandSignature);
 
-        explicit ICommandSignature(std::span<IndirectArgument> indirect_arguments) {};
+        explicit ICommandSignature(std::span<IndirectArgument> indirect_arguments, const uint32_t stride)
+            : m_arguments(indirect_arguments.begin(), indirect_arguments.end()), m_stride(stride)
+        {
+        }
         [[nodiscard]] virtual void* GetSignature() = 0;
+        [[nodiscard]] std::span<const IndirectArgument> GetArguments() const { return m_arguments; }
+        [[nodiscard]] uint32_t GetStride() const { return m_stride; }
+
+    private:
+        std::vector<IndirectArgument> m_arguments;
+        uint32_t m_stride;
     };
     class IContext
     {
@@ -39,6 +52,7 @@ namespace Swift
 
         [[nodiscard]] virtual ICommand* CreateCommand(IQueue* queue, std::string_view debug_name = "") = 0;
         [[nodiscard]] virtual IQueue* CreateQueue(const QueueCreateInfo& info) = 0;
+        [[nodiscard]] virtual IFence* CreateFence(uint64_t initial_value = 0) = 0;
         [[nodiscard]] virtual IBuffer* CreateBuffer(const BufferCreateInfo& info) = 0;
         [[nodiscard]] virtual ITexture* CreateTexture(const TextureCreateInfo& info) = 0;
         [[nodiscard]] virtual IShader* CreateShader(const GraphicsShaderCreateInfo& info) = 0;
@@ -46,10 +60,13 @@ namespace Swift
         [[nodiscard]] virtual ITextureView* CreateTextureView(ITexture* texture, const TextureViewCreateInfo& info) = 0;
         [[nodiscard]] virtual IBufferView* CreateBufferView(IBuffer* buffer, const BufferViewCreateInfo& info) = 0;
         [[nodiscard]] virtual ISampler* CreateSampler(const SamplerCreateInfo& info) = 0;
-        [[nodiscard]] virtual ICommandSignature* CreateCommandSignature(std::span<IndirectArgument> indirect_arguments) = 0;
+        // stride 0 packs the commands tightly, CommandSignatureBuilder checks the layout first.
+        [[nodiscard]] virtual ICommandSignature* CreateCommandSignature(std::span<IndirectArgument> indirect_arguments,
+                                                                        uint32_t stride = 0) = 0;
 
         virtual void DestroyCommand(ICommand* command) = 0;
         virtual void DestroyQueue(IQueue* queue) = 0;
+        virtual void DestroyFence(IFence* fence) = 0;
         virtual void DestroyBuffer(IBuffer* buffer) = 0;
         virtual void DestroyTexture(ITexture* texture) = 0;
         virtual void DestroyShader(IShader* shader) = 0;
@@ -60,16 +77,25 @@ namespace Swift
 
         virtual void NewFrame() = 0;
         virtual void Present(bool vsync) = 0;
+        // Submits pending texture uploads, done implicitly by Present. Only needed before executing your own commands
+        // that read those textures earlier in the frame.
+        virtual void FlushUploads() = 0;
         virtual void ResizeBuffers(uint32_t width, uint32_t height) = 0;
         virtual uint32_t CalculateAlignedTextureSize(const TextureCreateInfo& info) = 0;
         virtual uint32_t CalculateAlignedBufferSize(const BufferCreateInfo& info) = 0;
 
-        std::array<ITexture*, 3>& GetSwapchainTextures() { return m_swapchain_textures; }
-        std::array<ITextureView*, 3>& GetSwapchainRenderTargets() { return m_swapchain_render_targets; }
+        std::span<ITexture* const> GetSwapchainTextures() const { return m_swapchain_textures; }
+        std::span<ITextureView* const> GetSwapchainRenderTargets() const { return m_swapchain_render_targets; }
         virtual ITexture* GetCurrentSwapchainTexture() const = 0;
         virtual ITextureView* GetCurrentRenderTarget() const = 0;
+        // Acquired from the command pool by NewFrame and executed by Present.
         ICommand* GetCurrentCommand() const { return m_frame_data[m_frame_index].command; }
+        // Graphics queue lists for the current frame, for recording on other threads. They are recycled with the frame
+        // slot, so they have to be executed on the graphics queue before Present.
+        CommandPool* GetCommandPool() const { return m_command_pool.get(); }
+        // In [0, GetFramesInFlight()), for indexing per frame resources the GPU may still be reading.
         uint32_t GetFrameIndex() const { return m_frame_index; }
+        uint32_t GetFramesInFlight() const { return static_cast<uint32_t>(m_frame_data.size()); }
         IQueue* GetGraphicsQueue() const { return m_graphics_queue; }
 
     protected:
@@ -84,14 +110,17 @@ namespace Swift
             ICommand* command;
             uint64_t fence_value;
         };
-        std::array<FrameData, 3> m_frame_data{};
+        std::vector<FrameData> m_frame_data;
+        std::unique_ptr<CommandPool> m_command_pool;
         uint32_t m_frame_index{};
-        std::array<ITexture*, 3> m_swapchain_textures{};
-        std::array<ITextureView*, 3> m_swapchain_render_targets{};
+        std::vector<ITexture*> m_swapchain_textures;
+        std::vector<ITextureView*> m_swapchain_render_targets;
         std::vector<ICommand*> m_commands;
         std::vector<uint32_t> m_free_commands;
         std::vector<IQueue*> m_queues;
         std::vector<uint32_t> m_free_queues;
+        std::vector<IFence*> m_fences;
+        std::vector<uint32_t> m_free_fences;
         std::vector<IBuffer*> m_buffers;
         std::vector<uint32_t> m_free_buffers;
         std::vector<ITexture*> m_textures;
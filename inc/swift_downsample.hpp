@@ -0,0 +1,24 @@
+#pragma once
+#include "swift_structs.hpp"
+#include "vector"
+#include "algorithm"
+
+namespace Swift
+{
+    struct MipLevel
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<Float4> texels;
+    };
+
+    inline UInt2 CalculateMipSize(const uint32_t width, const uint32_t height, const uint32_t mip)
+    {
+        return {std::max(width >> mip, 1u), std::max(height >> mip, 1u)};
+    }
+
+    // CPU reference of the mip reduction, for checking mips and depth pyramids without a GPU. Returns mip_count levels
+    // after the base, each texel being the average, minimum or maximum of the 2x2 texels above it. Reads past the edge
+    // of an odd sized level are clamped to its last row or column.
+    std::vector<MipLevel> DownsampleReference(const MipLevel& base, uint32_t mip_count, ReductionType reduction);
+}  // namespace Swift
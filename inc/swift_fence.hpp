@@ -0,0 +1,107 @@
+#pragma once
+#include "swift_macros.hpp"
+#include "atomic"
+#include "chrono"
+#include "cstdint"
+#include "mutex"
+#include "optional"
+#include "span"
+#include "vector"
+#ifndef SWIFT_WINDOWS
+#include "condition_variable"
+#endif
+
+namespace Swift
+{
+    constexpr auto k_infinite_timeout = std::chrono::milliseconds::max();
+
+    // Auto resetting OS event. Every thread that waits on fences gets its own, so waiters never steal each other's
+    // wake ups.
+    class FenceEvent
+    {
+    public:
+        FenceEvent();
+        ~FenceEvent();
+        SWIFT_NO_COPY(FenceEvent);
+        SWIFT_NO_MOVE(FenceEvent);
+
+        void Set();
+        // Consumes the signal, false when the timeout passed first.
+        bool Wait(std::chrono::milliseconds timeout);
+        // The Win32 event handle, nullptr on other platforms.
+        [[nodiscard]] void* GetHandle() const { return m_handle; }
+
+    private:
+        void* m_handle = nullptr;
+#ifndef SWIFT_WINDOWS
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_signaled = false;
+#endif
+    };
+
+    // A timeline: a 64 bit value that only goes up, signaled by queues on the GPU or by the CPU.
+    class IFence
+    {
+    public:
+        SWIFT_DESTRUCT(IFence);
+        SWIFT_NO_COPY(IFence);
+        SWIFT_NO_MOVE(IFence);
+
+        // The API object, nullptr for fences that only live on the CPU.
+        [[nodiscard]] virtual void* GetFence() = 0;
+        [[nodiscard]] virtual uint64_t GetCompletedValue() = 0;
+        [[nodiscard]] bool IsComplete(const uint64_t value) { return GetCompletedValue() >= value; }
+        virtual void Signal(uint64_t value) = 0;
+        // Blocks on the event of the calling thread, false when the timeout passed first.
+        bool Wait(uint64_t value, std::chrono::milliseconds timeout = k_infinite_timeout);
+
+        // Sets event once the fence reaches value, right away if it already has. RemoveEvent drops the registrations
+        // that have not fired yet, where the API allows it.
+        virtual void SetEventOnCompletion(uint64_t value, FenceEvent& event) = 0;
+        virtual void RemoveEvent(FenceEvent&) {}
+
+    protected:
+        IFence() = default;
+    };
+
+    struct FenceWait
+    {
+        IFence* fence;
+        uint64_t value;
+    };
+    using FenceSignal = FenceWait;
+
+    // Both block on one event for all fences. WaitForAllFences returns false on timeout, WaitForAnyFence the index of a
+    // completed wait or nothing on timeout.
+    bool WaitForAllFences(std::span<const FenceWait> waits, std::chrono::milliseconds timeout = k_infinite_timeout);
+    std::optional<size_t> WaitForAnyFence(std::span<const FenceWait> waits,
+                                          std::chrono::milliseconds timeout = k_infinite_timeout);
+
+    // Signaled from the CPU only. Behaves like a GPU fence for the waits above, which makes it usable in tests and for
+    // CPU side producers.
+    class CpuFence final : public IFence
+    {
+    public:
+        explicit CpuFence(uint64_t initial_value = 0);
+        SWIFT_NO_COPY(CpuFence);
+        SWIFT_NO_MOVE(CpuFence);
+
+        void* GetFence() override { return nullptr; }
+        uint64_t GetCompletedValue() override { return m_value.load(std::memory_order_acquire); }
+        void Signal(uint64_t value) override;
+        void SetEventOnCompletion(uint64_t value, FenceEvent& event) override;
+        void RemoveEvent(FenceEvent& event) override;
+
+    private:
+        struct Waiter
+        {
+            uint64_t value;
+            FenceEvent* event;
+        };
+
+        std::atomic<uint64_t> m_value;
+        std::mutex m_mutex;
+        std::vector<Waiter> m_waiters;
+    };
+}  // namespace Swift
@@ -1,11 +1,22 @@
 #pragma once
 #include "span"
 #include "swift_command.hpp"
+#include "swift_fence.hpp"
 #include "swift_macros.hpp"
 
 namespace Swift
 {
     class ICommand;
+
+    // One ExecuteCommandLists call: the queue waits on the GPU for every wait, runs the commands in order, then signals
+    // its own fence and every signal.
+    struct SubmitInfo
+    {
+        std::span<ICommand* const> commands;
+        std::span<const FenceWait> waits;
+        std::span<const FenceSignal> signals;
+    };
+
     class IQueue
     {
     public:
@@ -14,14 +25,71 @@ namespace Swift
         SWIFT_NO_COPY(IQueue);
 
         virtual void* GetQueue() = 0;
-        virtual void Wait(uint64_t fence_value) = 0;
+        // Signaled with the value Execute returns once the work it submitted has finished.
+        [[nodiscard]] virtual IFence* GetFence() = 0;
+        [[nodiscard]] bool IsComplete(const uint64_t fence_value) { return GetFence()->IsComplete(fence_value); }
+        // False when the timeout passed first.
+        bool Wait(const uint64_t fence_value, const std::chrono::milliseconds timeout = k_infinite_timeout)
+        {
+            return GetFence()->Wait(fence_value, timeout);
+        }
         virtual void WaitIdle() = 0;
-        virtual uint64_t Execute(std::span<ICommand*> commands) = 0;
-        virtual uint64_t Execute(ICommand* command) { return Execute(std::span{&command, 1}); }
+        // Returns the value the queue's fence reaches once the commands have finished, any number of commands is
+        // submitted at once.
+        virtual uint64_t Submit(const SubmitInfo& info) = 0;
+        uint64_t Execute(const std::span<ICommand* const> commands)
+        {
+            return Submit({.commands = commands, .waits = {}, .signals = {}});
+        }
+        uint64_t Execute(ICommand* command) { return Execute(std::span{&command, 1}); }
+        // Signals the queue's own fence with the next value once the work executed so far has finished, Execute does
+        // this itself. Fences without an API object (CpuFence) cannot be signaled by a queue and are left alone.
+        virtual uint64_t Signal() = 0;
+        virtual void Signal(IFence* fence, uint64_t value) = 0;
+        // Work executed on this queue after the call starts once fence reaches value, without blocking the CPU. A CpuFence
+        // is waited on the CPU instead.
+        virtual void WaitForFence(IFence* fence, uint64_t value) = 0;
+        void WaitForQueue(IQueue* other, const uint64_t value) { WaitForFence(other->GetFence(), value); }
         [[nodiscard]] QueueType GetQueueType() const { return m_type; }
 
     protected:
         explicit IQueue(const QueueType type) : m_type(type) {}
         QueueType m_type;
     };
+
+    // Hands a resource from one queue to another. The source records ReleaseOwnership and executes it, then the
+    // destination makes its queue wait on that submission and records the transition into the state it needs. The
+    // resource passes through eCommon since copy and compute queues cannot use every state the graphics queue can.
+    // Resource states are tracked at record time, so the release has to be recorded before the acquire.
+    inline void ReleaseOwnership(ICommand* command, ITexture* texture)
+    {
+        command->TransitionImage(texture, ResourceState::eCommon);
+    }
+
+    inline void ReleaseOwnership(ICommand* command, IBuffer* buffer)
+    {
+        command->TransitionBuffer(buffer, ResourceState::eCommon);
+    }
+
+    inline void AcquireOwnership(IQueue* queue,
+                                 ICommand* command,
+                                 ITexture* texture,
+                                 const ResourceState state,
+                                 IQueue* source,
+                                 const uint64_t source_value)
+    {
+        queue->WaitForQueue(source, source_value);
+        command->TransitionImage(texture, state);
+    }
+
+    inline void AcquireOwnership(IQueue* queue,
+                                 ICommand* command,
+                                 IBuffer* buffer,
+                                 const ResourceState state,
+                                 IQueue* source,
+                                 const uint64_t source_value)
+    {
+        queue->WaitForQueue(source, source_value);
+        command->TransitionBuffer(buffer, state);
+    }
 }  // namespace Swift
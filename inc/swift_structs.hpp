@@ -106,6 +106,16 @@ namespace Swift
         uint32_t rtv_handle_count = 64;
         uint32_t dsv_handle_count = 64;
         uint32_t sampler_handle_count = 1024;
+        // Frames the CPU may record ahead of the GPU, each with its own command list. Independent of the back buffer
+        // count, which has to be at least two.
+        uint32_t frames_in_flight = 3;
+        uint32_t swapchain_buffer_count = 3;
+        // With the frame latency waitable object NewFrame blocks until the swapchain can take another frame instead of
+        // on the GPU fence, which keeps input latency at max_frame_latency presents. 0 means frames_in_flight.
+        bool frame_latency_waitable = true;
+        uint32_t max_frame_latency = 0;
+        // Barriers with explicit sync, access and layout where the device supports them, legacy transitions otherwise.
+        bool enhanced_barriers = true;
     };
 
     enum class PolygonMode
@@ -381,6 +391,8 @@ namespace Swift
         eDepthStencil = 1 << 2,
         eShaderResource = 1 << 3,
         eUnorderedAccess = 1 << 4,
+        // The array slices are cube faces, six per cube, and shader resource views sample them as cubes.
+        eCube = 1 << 5,
     };
 
     enum class BufferFlags
@@ -398,6 +410,7 @@ namespace Swift
         uint16_t array_size = 1;
         Format format = Format::eRGBA8_UNORM;
         bool gen_mipmaps = false;
+        ReductionType mip_reduction = ReductionType::eStandard;
         const void* data = nullptr;
         std::optional<MSAA> msaa = std::nullopt;
         EnumFlags<TextureFlags> flags;
@@ -494,17 +507,42 @@ namespace Swift
         uint8_t clear_stencil;
     };
 
+    // Indirect commands are tightly packed in argument order, the dispatch comes last. Mesh dispatches are the
+    // vertex-less draws, pipelines read their geometry from buffers.
     enum class IndirectArgumentType
     {
+        // size bytes of root constants at offset, in 32 bit values.
         ePushConstant,
         eDispatch,
         eMeshDispatch,
+        // The address of the root constant buffer at slot, one of root parameters 1 to 3.
+        eConstantBuffer,
+        // One root constant at offset, in 32 bit values, such as the instance or material of the draw.
+        eDrawId,
     };
 
     struct IndirectArgument
     {
         IndirectArgumentType type;
-        uint32_t size;
-        uint32_t offset;
-    };
+        uint32_t size = 0;
+        uint32_t offset = 0;
+        uint32_t slot = 0;
+    };
+
+    constexpr uint32_t GetIndirectArgumentSize(const IndirectArgument& argument)
+    {
+        switch (argument.type)
+        {
+            case IndirectArgumentType::ePushConstant:
+                return argument.size;
+            case IndirectArgumentType::eDispatch:
+            case IndirectArgumentType::eMeshDispatch:
+                return 3 * sizeof(uint32_t);
+            case IndirectArgumentType::eConstantBuffer:
+                return sizeof(uint64_t);
+            case IndirectArgumentType::eDrawId:
+                return sizeof(uint32_t);
+        }
+        return 0;
+    }
 }  // namespace Swift
@@ -1,8 +1,10 @@
 import subprocess
+import sys
 from pathlib import Path
 import re
 
-SLANG_BINARY = (
+# The slangc next to the examples' slang libraries unless a path is given as the first argument.
+SLANG_BINARY = Path(sys.argv[1]) if len(sys.argv) > 1 else (
         Path(__file__).resolve().parent.parent
         / "examples"
         / "extern"
@@ -76,11 +78,12 @@ def main():
 
         name = file.stem.replace("-", "_")
 
+        # A header without one of the shaders would silently disable the path using it, keep the old one instead.
         try:
             bytecode = compile_to_dxil(file)
-        except subprocess.CalledProcessError as e:
+        except (subprocess.CalledProcessError, OSError) as e:
             print(f"Failed: {file}: {e}")
-            continue
+            sys.exit(1)
 
         size = len(bytecode)
         bytes_cpp = ", ".join(f"0x{b:02x}" for b in bytecode)
@@ -10,6 +10,18 @@ Swift::D3D12::BufferView::BufferView(Context* m_context, IBuffer* buffer, const
     m_data = heap->Allocate();
     auto* device = static_cast<ID3D12Device*>(m_context->GetDevice());
     auto* resource = static_cast<ID3D12Resource*>(buffer->GetResource());
+    if (create_info.type == BufferViewType::eUnorderedAccess)
+    {
+        const D3D12_UNORDERED_ACCESS_VIEW_DESC desc{.Format = DXGI_FORMAT_UNKNOWN,
+                                                    .ViewDimension = D3D12_UAV_DIMENSION_BUFFER,
+                                                    .Buffer = {
+                                                        .FirstElement = create_info.first_element,
+                                                        .NumElements = create_info.num_elements,
+                                                        .StructureByteStride = create_info.element_size,
+                                                    }};
+        device->CreateUnorderedAccessView(resource, nullptr, &desc, m_data.cpu_handle);
+        return;
+    }
     const D3D12_SHADER_RESOURCE_VIEW_DESC desc{.Format = DXGI_FORMAT_UNKNOWN,
                                                .ViewDimension = D3D12_SRV_DIMENSION_BUFFER,
                                                .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
@@ -5,6 +5,8 @@
 #include "swift_texture.hpp"
 #include "d3d12/d3d12_shader.hpp"
 #include "array"
+#include "cstring"
+#include "format"
 #include "d3d12/d3d12_texture_view.hpp"
 
 Swift::D3D12::Command::Command(IContext* context,
@@ -15,6 +17,7 @@ Swift::D3D12::Command::Command(IContext* context,
                                std::string_view debug_name)
     : m_context(static_cast<Context*>(context)),
       m_type(type),
+      m_enhanced_barriers(m_context->UsesEnhancedBarriers()),
       m_cbv_srv_uav_heap(cbv_heap),
       m_sampler_heap(sampler_heap),
       m_root_signature(root_signature)
@@ -42,16 +45,12 @@ void Swift::D3D12::Command::Begin()
 
     m_list->Reset(m_allocator, nullptr);
 
-    if (m_list->GetType() != D3D12_COMMAND_LIST_TYPE_COPY)
-    {
-        const auto descriptor_heaps = std::array{m_cbv_srv_uav_heap->GetHeap(), m_sampler_heap->GetHeap()};
-        m_list->SetDescriptorHeaps(2, descriptor_heaps.data());
-        m_list->SetGraphicsRootSignature(m_root_signature);
-        m_list->SetComputeRootSignature(m_root_signature);
-
-        m_list->SetGraphicsRootDescriptorTable(4, m_cbv_srv_uav_heap->GetHeap()->GetGPUDescriptorHandleForHeapStart());
-        m_list->SetGraphicsRootDescriptorTable(5, m_sampler_heap->GetHeap()->GetGPUDescriptorHandleForHeapStart());
-    }
+    // A reset list starts without any state. The root signatures and descriptor heaps are bound with the first shader
+    // of their type, so copy lists and lists that only clear or transition never set them.
+    InvalidateState();
+    m_shader = nullptr;
+    m_constant_buffers = {};
+    m_statistics = {};
 }
 
 void Swift::D3D12::Command::End() { m_list->Close(); }
@@ -66,6 +65,13 @@ void Swift::D3D12::Command::SetViewport(const Viewport& viewport)
         viewport.depth_range.x,
         viewport.depth_range.y,
     };
+    if (m_viewport && std::memcmp(&m_viewport.value(), &dx_viewport, sizeof(D3D12_VIEWPORT)) == 0)
+    {
+        m_statistics.viewports.filtered++;
+        return;
+    }
+    m_viewport = dx_viewport;
+    m_statistics.viewports.issued++;
     m_list->RSSetViewports(1, &dx_viewport);
 }
 
@@ -75,6 +81,13 @@ void Swift::D3D12::Command::SetScissor(const Scissor& scissor)
                                    static_cast<int>(scissor.offset.y),
                                    static_cast<int>(scissor.dimensions.x),
                                    static_cast<int>(scissor.dimensions.y)};
+    if (m_scissor && std::memcmp(&m_scissor.value(), &dx_scissor, sizeof(D3D12_RECT)) == 0)
+    {
+        m_statistics.scissors.filtered++;
+        return;
+    }
+    m_scissor = dx_scissor;
+    m_statistics.scissors.issued++;
     m_list->RSSetScissorRects(1, &dx_scissor);
 }
 
@@ -94,11 +107,22 @@ void Swift::D3D12::Command::PushConstants(const void* data, const uint32_t size,
 void Swift::D3D12::Command::BindShader(IShader* shader)
 {
     m_shader = shader;
-    m_list->SetPipelineState(static_cast<ID3D12PipelineState*>(shader->GetPipeline()));
+    BindRootSignature(shader->GetShaderType());
+
+    auto* const pipeline = static_cast<ID3D12PipelineState*>(shader->GetPipeline());
+    if (pipeline == m_pipeline)
+    {
+        m_statistics.pipelines.filtered++;
+        return;
+    }
+    m_pipeline = pipeline;
+    m_statistics.pipelines.issued++;
+    m_list->SetPipelineState(pipeline);
 }
 
 void Swift::D3D12::Command::DispatchMesh(const uint32_t group_x, const uint32_t group_y, const uint32_t group_z)
 {
+    FlushConstantBuffers();
     m_list->DispatchMesh(group_x, group_y, group_z);
 }
 void Swift::D3D12::Command::ExecuteIndirect(ICommandSignature* signature,
@@ -115,11 +139,26 @@ void Swift::D3D12::Command::ExecuteIndirect(ICommandSignature* signature,
         co_buffer = static_cast<ID3D12Resource*>(count_buffer->GetResource());
     }
     auto* sig = static_cast<ID3D12CommandSignature*>(signature->GetSignature());
+    FlushConstantBuffers();
     m_list->ExecuteIndirect(sig, max_commands, arg_buffer, argument_offset, co_buffer, count_offset);
+
+    // Constant buffers the signature wrote are left at whatever the last command set, the next draw binds them again.
+    if (!m_shader) return;
+    auto& state = GetRootState(m_shader->GetShaderType());
+    for (const auto& argument : signature->GetArguments())
+    {
+        if (argument.type != IndirectArgumentType::eConstantBuffer) continue;
+        const uint32_t index = argument.slot - k_first_constant_buffer_slot;
+        if (index < k_constant_buffer_slot_count)
+        {
+            state.constant_buffers[index] = 0;
+        }
+    }
 }
 
 void Swift::D3D12::Command::DispatchCompute(const uint32_t group_x, const uint32_t group_y, const uint32_t group_z)
 {
+    FlushConstantBuffers();
     m_list->Dispatch(group_x, group_y, group_z);
 }
 
@@ -197,8 +236,21 @@ void Swift::D3D12::Command::CopyBufferToBuffer(IBuffer* src, IBuffer* dst, const
 
 void Swift::D3D12::Command::BindConstantBuffer(IBuffer* buffer, const uint32_t slot, const uint32_t offset)
 {
-    m_list->SetGraphicsRootConstantBufferView(slot, buffer->GetVirtualAddress() + offset);
-    m_list->SetComputeRootConstantBufferView(slot, buffer->GetVirtualAddress() + offset);
+    if (slot < k_first_constant_buffer_slot || slot >= k_first_constant_buffer_slot + k_constant_buffer_slot_count)
+    {
+        printf(std::format("Root parameter {} is not a constant buffer slot\n", slot).c_str());
+        return;
+    }
+
+    // Only recorded here, the next draw or dispatch issues it for the pipeline type it uses.
+    auto& address = m_constant_buffers[slot - k_first_constant_buffer_slot];
+    const D3D12_GPU_VIRTUAL_ADDRESS new_address = buffer->GetVirtualAddress() + offset;
+    if (address == new_address)
+    {
+        m_statistics.constant_buffers.filtered++;
+        return;
+    }
+    address = new_address;
 }
 
 void Swift::D3D12::Command::BeginRender(const std::span<const RenderAttachmentInfo> color_attachments,
@@ -259,35 +311,107 @@ void Swift::D3D12::Command::ClearDepthStencil(ITextureView* depth_stencil, const
 
 void Swift::D3D12::Command::TransitionImage(ITexture* image, const ResourceState new_state)
 {
-    const auto new_dx_state = ToResourceState(new_state);
-    if (image->GetState() == new_state) return;
-    const auto barrier = D3D12_RESOURCE_BARRIER{.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-                                                .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-                                                .Transition = {
-                                                    .pResource = static_cast<ID3D12Resource*>(image->GetResource()),
-                                                    .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-                                                    .StateBefore = ToResourceState(image->GetState()),
-                                                    .StateAfter = new_dx_state,
-                                                }};
-    image->SetState(new_state);
-    m_list->ResourceBarrier(1, &barrier);
+    const TextureTransition transition{.texture = image, .state = new_state};
+    TransitionResources(std::span(&transition, 1), {});
 }
 
-void Swift::D3D12::Command::TransitionBuffer(IBuffer* buffer, ResourceState new_state)
+void Swift::D3D12::Command::TransitionBuffer(IBuffer* buffer, const ResourceState new_state)
 {
-    const auto new_dx_state = ToResourceState(new_state);
-    if (buffer->GetState() == new_state) return;
-    const auto barrier = D3D12_RESOURCE_BARRIER{.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-                                                .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-                                                .Transition = {
-                                                    .pResource = static_cast<ID3D12Resource*>(buffer->GetResource()),
-                                                    .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-                                                    .StateBefore = ToResourceState(buffer->GetState()),
-                                                    .StateAfter = new_dx_state,
-                                                }};
-    buffer->SetState(new_state);
-    m_list->ResourceBarrier(1, &barrier);
+    const BufferTransition transition{.buffer = buffer, .state = new_state};
+    TransitionResources({}, std::span(&transition, 1));
+}
+
+void Swift::D3D12::Command::TransitionResources(const std::span<const TextureTransition> textures,
+                                                const std::span<const BufferTransition> buffers)
+{
+    if (m_enhanced_barriers)
+    {
+        m_texture_barriers.clear();
+        m_buffer_barriers.clear();
+        for (const auto& [texture, state] : textures)
+        {
+            if (texture->GetState() == state) continue;
+            const auto before = ToBarrierState(texture->GetState());
+            const auto after = ToBarrierState(state);
+            m_texture_barriers.emplace_back(D3D12_TEXTURE_BARRIER{
+                .SyncBefore = before.sync,
+                .SyncAfter = after.sync,
+                .AccessBefore = before.access,
+                .AccessAfter = after.access,
+                .LayoutBefore = before.layout,
+                .LayoutAfter = after.layout,
+                .pResource = static_cast<ID3D12Resource*>(texture->GetResource()),
+                .Subresources = {.IndexOrFirstMipLevel = 0xffffffff},
+                .Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE,
+            });
+            texture->SetState(state);
+        }
+        for (const auto& [buffer, state] : buffers)
+        {
+            if (buffer->GetState() == state) continue;
+            const auto before = ToBarrierState(buffer->GetState());
+            const auto after = ToBarrierState(state);
+            m_buffer_barriers.emplace_back(D3D12_BUFFER_BARRIER{
+                .SyncBefore = before.sync,
+                .SyncAfter = after.sync,
+                .AccessBefore = before.access,
+                .AccessAfter = after.access,
+                .pResource = static_cast<ID3D12Resource*>(buffer->GetResource()),
+                .Offset = 0,
+                .Size = UINT64_MAX,
+            });
+            buffer->SetState(state);
+        }
+
+        std::array<D3D12_BARRIER_GROUP, 2> groups{};
+        uint32_t group_count = 0;
+        if (!m_texture_barriers.empty())
+        {
+            groups[group_count].Type = D3D12_BARRIER_TYPE_TEXTURE;
+            groups[group_count].NumBarriers = static_cast<uint32_t>(m_texture_barriers.size());
+            groups[group_count].pTextureBarriers = m_texture_barriers.data();
+            group_count++;
+        }
+        if (!m_buffer_barriers.empty())
+        {
+            groups[group_count].Type = D3D12_BARRIER_TYPE_BUFFER;
+            groups[group_count].NumBarriers = static_cast<uint32_t>(m_buffer_barriers.size());
+            groups[group_count].pBufferBarriers = m_buffer_barriers.data();
+            group_count++;
+        }
+        if (group_count == 0) return;
+        m_list->Barrier(group_count, groups.data());
+        return;
+    }
+
+    m_legacy_barriers.clear();
+    const auto add_transition = [this](ID3D12Resource* resource, const ResourceState before, const ResourceState after)
+    {
+        m_legacy_barriers.emplace_back(D3D12_RESOURCE_BARRIER{.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+                                                              .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+                                                              .Transition = {
+                                                                  .pResource = resource,
+                                                                  .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+                                                                  .StateBefore = ToResourceState(before),
+                                                                  .StateAfter = ToResourceState(after),
+                                                              }});
+    };
+    for (const auto& [texture, state] : textures)
+    {
+        if (texture->GetState() == state) continue;
+        add_transition(static_cast<ID3D12Resource*>(texture->GetResource()), texture->GetState(), state);
+        texture->SetState(state);
+    }
+    for (const auto& [buffer, state] : buffers)
+    {
+        if (buffer->GetState() == state) continue;
+        add_transition(static_cast<ID3D12Resource*>(buffer->GetResource()), buffer->GetState(), state);
+        buffer->SetState(state);
+    }
+    if (m_legacy_barriers.empty()) return;
+    m_list->ResourceBarrier(static_cast<uint32_t>(m_legacy_barriers.size()), m_legacy_barriers.data());
 }
+
 void Swift::D3D12::Command::UAVBarrier(IBuffer* buffer)
 {
     const auto barrier = D3D12_RESOURCE_BARRIER{.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV,
@@ -306,4 +430,76 @@ void Swift::D3D12::Command::UAVBarrier(ITexture* texture)
                                                     .pResource = static_cast<ID3D12Resource*>(texture->GetResource()),
                                                 }};
     m_list->ResourceBarrier(1, &barrier);
-}
\ No newline at end of file
+}
+
+void Swift::D3D12::Command::InvalidateState()
+{
+    m_descriptor_heaps = false;
+    m_pipeline = nullptr;
+    m_graphics_state = {};
+    m_compute_state = {};
+    m_viewport.reset();
+    m_scissor.reset();
+}
+
+Swift::D3D12::Command::RootState& Swift::D3D12::Command::GetRootState(const ShaderType type)
+{
+    return type == ShaderType::eCompute ? m_compute_state : m_graphics_state;
+}
+
+void Swift::D3D12::Command::BindRootSignature(const ShaderType type)
+{
+    auto& state = GetRootState(type);
+    if (state.root_signature)
+    {
+        m_statistics.root_signatures.filtered++;
+        return;
+    }
+
+    if (!m_descriptor_heaps)
+    {
+        const auto descriptor_heaps = std::array{m_cbv_srv_uav_heap->GetHeap(), m_sampler_heap->GetHeap()};
+        m_list->SetDescriptorHeaps(2, descriptor_heaps.data());
+        m_descriptor_heaps = true;
+    }
+
+    // Setting a root signature clears its root arguments.
+    state = {.root_signature = true};
+    m_statistics.root_signatures.issued++;
+    switch (type)
+    {
+        case ShaderType::eGraphics:
+            m_list->SetGraphicsRootSignature(m_root_signature);
+            m_list->SetGraphicsRootDescriptorTable(4, m_cbv_srv_uav_heap->GetHeap()->GetGPUDescriptorHandleForHeapStart());
+            m_list->SetGraphicsRootDescriptorTable(5, m_sampler_heap->GetHeap()->GetGPUDescriptorHandleForHeapStart());
+            break;
+        case ShaderType::eCompute:
+            m_list->SetComputeRootSignature(m_root_signature);
+            break;
+    }
+}
+
+void Swift::D3D12::Command::FlushConstantBuffers()
+{
+    if (!m_shader) return;
+
+    const auto type = m_shader->GetShaderType();
+    BindRootSignature(type);
+    auto& state = GetRootState(type);
+    for (uint32_t i = 0; i < k_constant_buffer_slot_count; ++i)
+    {
+        const D3D12_GPU_VIRTUAL_ADDRESS address = m_constant_buffers[i];
+        if (address == 0 || state.constant_buffers[i] == address) continue;
+
+        state.constant_buffers[i] = address;
+        m_statistics.constant_buffers.issued++;
+        if (type == ShaderType::eCompute)
+        {
+            m_list->SetComputeRootConstantBufferView(k_first_constant_buffer_slot + i, address);
+        }
+        else
+        {
+            m_list->SetGraphicsRootConstantBufferView(k_first_constant_buffer_slot + i, address);
+        }
+    }
+}
@@ -2,6 +2,7 @@
 #include "d3d12/d3d12_helpers.hpp"
 #include "d3d12/d3d12_buffer.hpp"
 #include "d3d12/d3d12_command.hpp"
+#include "d3d12/d3d12_fence.hpp"
 #include "d3d12/d3d12_queue.hpp"
 #include "d3d12/d3d12_shader.hpp"
 #include "d3d12/d3d12_texture.hpp"
@@ -26,50 +27,50 @@ namespace Swift::D3D12
 {
     CommandSignature::CommandSignature(ID3D12Device14* device,
                                        ID3D12RootSignature* root_signature,
-                                       const std::span<IndirectArgument> indirect_arguments)
-        : ICommandSignature(indirect_arguments)
+                                       const std::span<IndirectArgument> indirect_arguments,
+                                       const uint32_t stride)
+        : ICommandSignature(indirect_arguments, stride)
     {
         std::vector<D3D12_INDIRECT_ARGUMENT_DESC> args;
         uint32_t total_size = 0;
+        bool changes_root_arguments = false;
         for (const auto& arg : indirect_arguments)
         {
+            D3D12_INDIRECT_ARGUMENT_DESC new_arg{};
             switch (arg.type)
             {
                 case IndirectArgumentType::ePushConstant:
-                {
-                    D3D12_INDIRECT_ARGUMENT_DESC new_arg{};
+                case IndirectArgumentType::eDrawId:
                     new_arg.Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
                     new_arg.Constant.RootParameterIndex = 0;
                     new_arg.Constant.DestOffsetIn32BitValues = arg.offset;
-                    new_arg.Constant.Num32BitValuesToSet = arg.size / sizeof(uint32_t);
-                    args.emplace_back(new_arg);
-                    total_size += arg.size;
-                }
-                break;
+                    new_arg.Constant.Num32BitValuesToSet = GetIndirectArgumentSize(arg) / sizeof(uint32_t);
+                    changes_root_arguments = true;
+                    break;
+                case IndirectArgumentType::eConstantBuffer:
+                    new_arg.Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
+                    new_arg.ConstantBufferView.RootParameterIndex = arg.slot;
+                    changes_root_arguments = true;
+                    break;
                 case IndirectArgumentType::eDispatch:
-                {
-                    D3D12_INDIRECT_ARGUMENT_DESC new_arg{};
                     new_arg.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
-                    total_size += sizeof(D3D12_DISPATCH_ARGUMENTS);
-                    args.emplace_back(new_arg);
-                }
-                break;
+                    break;
                 case IndirectArgumentType::eMeshDispatch:
-                {
-                    D3D12_INDIRECT_ARGUMENT_DESC new_arg{};
                     new_arg.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH_MESH;
-                    total_size += sizeof(D3D12_DISPATCH_MESH_ARGUMENTS);
-                    args.emplace_back(new_arg);
-                }
-                break;
+                    break;
             }
+            total_size += GetIndirectArgumentSize(arg);
+            args.emplace_back(new_arg);
         }
         D3D12_COMMAND_SIGNATURE_DESC sigDesc = {};
-        sigDesc.ByteStride = total_size;
+        sigDesc.ByteStride = stride != 0 ? stride : total_size;
         sigDesc.NumArgumentDescs = args.size();
         sigDesc.pArgumentDescs = args.data();
         sigDesc.NodeMask = 0;
-        device->CreateCommandSignature(&sigDesc, root_signature, IID_PPV_ARGS(&m_command_signature));
+        // The root signature is only allowed when root arguments change.
+        device->CreateCommandSignature(&sigDesc,
+                                       changes_root_arguments ? root_signature : nullptr,
+                                       IID_PPV_ARGS(&m_command_signature));
     }
 
     CommandSignature::~CommandSignature() { m_command_signature->Release(); }
@@ -78,11 +79,12 @@ namespace Swift::D3D12
     {
         CreateBackend();
         CreateDevice();
+        QueryFeatures(create_info);
         CreateAllocator();
         CreateDescriptorHeaps(create_info);
         CreateRootSignature();
         CreateQueues();
-        CreateFrameData();
+        CreateFrameData(create_info);
         CreateSwapchain(create_info);
         CreateTextures(create_info);
         CreateMipMapShader();
@@ -90,7 +92,10 @@ namespace Swift::D3D12
 
     Context::~Context()
     {
+        FlushUploads();
         m_graphics_queue->WaitIdle();
+        RetireUploads();
+        m_command_pool.reset();
 
         m_root_signature->Release();
         m_swapchain.reset();
@@ -101,6 +106,11 @@ namespace Swift::D3D12
             DestroyQueue(queue);
         }
 
+        for (auto* fence : m_fences)
+        {
+            DestroyFence(fence);
+        }
+
         for (auto* shader : m_shaders)
         {
             DestroyShader(shader);
@@ -175,6 +185,11 @@ namespace Swift::D3D12
         return CreateObject([&] { return new Queue(m_device, info); }, m_queues, m_free_queues);
     }
 
+    IFence* Context::CreateFence(const uint64_t initial_value)
+    {
+        return CreateObject([&] { return new Fence(m_device, initial_value); }, m_fences, m_free_fences);
+    }
+
     IBuffer* Context::CreateBuffer(const BufferCreateInfo& info)
     {
         return CreateObject([&] { return new Buffer(this, info); }, m_buffers, m_free_buffers);
@@ -212,79 +227,18 @@ namespace Swift::D3D12
 
                 src += num_rows[i] * row_sizes[i];
             }
-            auto* const copy_command = CreateCommand(m_graphics_queue);
-            copy_command->Begin();
-            copy_command->CopyBufferToTexture(upload_buffer, texture, create_info.mip_levels, create_info.array_size);
-            copy_command->TransitionImage(texture, ResourceState::eCommon);
-            copy_command->End();
 
-            const auto value = m_graphics_queue->Execute(copy_command);
-            m_graphics_queue->Wait(value);
+            // Recorded into the shared upload batch instead of waiting here, the batch is submitted ahead of the frame
+            // and the staging memory is released once its fence has passed.
+            auto* const command = GetUploadCommand();
+            command->CopyBufferToTexture(upload_buffer, texture, create_info.mip_levels, create_info.array_size);
+            m_upload_batch.buffers.emplace_back(upload_buffer);
 
-            DestroyCommand(copy_command);
-            DestroyBuffer(upload_buffer);
-
-            if (create_info.gen_mipmaps)
+            if (create_info.gen_mipmaps && texture->GetCreateInfo().mip_levels > 1)
             {
-                create_info.mip_levels = info.mip_levels == 0 ? CalculateMaxMips(info.width, info.height) : info.mip_levels;
-                std::vector<ITextureView*> texture_srvs;
-                std::vector<ITextureView*> texture_uavs;
-
-                auto* const command = CreateCommand(m_graphics_queue);
-                command->Begin();
-
-                command->BindShader(m_mipmap_shader);
-
-                for (uint32_t src_mip = 0; src_mip < create_info.mip_levels - 1; src_mip++)
-                {
-                    texture_srvs.emplace_back(CreateTextureView(texture,
-                                                                {
-                                                                    .type = TextureViewType::eShaderResource,
-                                                                    .base_mip_level = src_mip,
-                                                                }));
-                    texture_uavs.emplace_back(CreateTextureView(texture,
-                                                                {
-                                                                    .type = TextureViewType::eShaderResource,
-                                                                    .base_mip_level = src_mip + 1,
-                                                                }));
-
-                    struct PushConstant
-                    {
-                        uint32_t sampler_index;
-                        uint32_t mip1_index;
-                        uint32_t src_index;
-                        std::array<float, 2> texel_size;
-                    };
-
-                    const uint32_t dst_width = std::max(create_info.width >> (src_mip + 1), 1u);
-                    const uint32_t dst_height = std::max(create_info.height >> (src_mip + 1), 1u);
-
-                    PushConstant pc{
-                        .sampler_index = m_mipmap_sampler->GetDescriptorIndex(),
-                        .mip1_index = texture_uavs[src_mip]->GetDescriptorIndex(),
-                        .src_index = texture_srvs[src_mip]->GetDescriptorIndex(),
-                        .texel_size = {1.0f / static_cast<float>(dst_width), 1.0f / static_cast<float>(dst_height)}};
-                    command->PushConstants(&pc, sizeof(PushConstant));
-
-                    command->DispatchCompute(std::max(dst_width / 8u, 1u), std::max(dst_height / 8u, 1u), 1);
-
-                    command->UAVBarrier(texture);
-                }
-
-                command->End();
-                const auto fence_value = GetGraphicsQueue()->Execute(command);
-                GetGraphicsQueue()->Wait(fence_value);
-
-                for (auto* texture_uav : texture_uavs)
-                {
-                    DestroyTextureView(texture_uav);
-                }
-
-                for (auto* texture_srv : texture_srvs)
-                {
-                    DestroyTextureView(texture_srv);
-                }
+                GenerateMips(command, texture, info.mip_reduction);
             }
+            command->TransitionImage(texture, ResourceState::eCommon);
         }
 
         return texture;
@@ -313,15 +267,17 @@ namespace Swift::D3D12
     {
         return CreateObject([&] { return new BufferView(this, buffer, info); }, m_buffer_views, m_free_buffer_views);
     }
-    ICommandSignature* Context::CreateCommandSignature(const std::span<IndirectArgument> indirect_arguments)
+    ICommandSignature* Context::CreateCommandSignature(const std::span<IndirectArgument> indirect_arguments,
+                                                       const uint32_t stride)
     {
-        return CreateObject([&] { return new CommandSignature(m_device, m_root_signature, indirect_arguments); },
+        return CreateObject([&] { return new CommandSignature(m_device, m_root_signature, indirect_arguments, stride); },
                             m_command_sigs,
                             m_free_command_sigs);
     }
 
     void Context::DestroyCommand(ICommand* command) { DestroyObject(command, m_commands, m_free_commands); }
     void Context::DestroyQueue(IQueue* queue) { DestroyObject(queue, m_queues, m_free_queues); }
+    void Context::DestroyFence(IFence* fence) { DestroyObject(fence, m_fences, m_free_fences); }
     void Context::DestroyBuffer(IBuffer* buffer) { DestroyObject(buffer, m_buffers, m_free_buffers); }
     void Context::DestroyTexture(ITexture* texture) { DestroyObject(texture, m_textures, m_free_textures); }
     void Context::DestroyShader(IShader* shader) { DestroyObject(shader, m_shaders, m_free_shaders); }
@@ -339,13 +295,42 @@ namespace Swift::D3D12
         DestroyObject(signature, m_command_sigs, m_free_command_sigs);
     }
 
-    void Context::NewFrame() { m_graphics_queue->Wait(GetFrameData().fence_value); }
+    void Context::NewFrame()
+    {
+        // Uploads that have already landed are released before blocking, so the CPU work overlaps the GPU finishing
+        // the frame this slot was last used for.
+        RetireUploads();
+
+        // The swapchain signals once a queued present has been retired, which paces the CPU to the display and keeps
+        // the command list of this slot idle as long as the frame latency does not exceed the frames in flight. The
+        // fence wait stays for the cases where it does, or the swapchain has no waitable object.
+        m_swapchain->WaitForFrameLatency(k_infinite_timeout);
+        if (!m_graphics_queue->IsComplete(GetFrameData().fence_value))
+        {
+            m_graphics_queue->Wait(GetFrameData().fence_value);
+            RetireUploads();
+        }
+        m_command_pool->BeginFrame(m_frame_index);
+        GetFrameData().command = m_command_pool->Acquire();
+    }
 
     void Context::Present(const bool vsync)
     {
+        FlushUploads();
         GetFrameData().fence_value = m_graphics_queue->Execute(GetFrameData().command);
+        m_command_pool->EndFrame(GetFrameData().fence_value);
         m_swapchain->Present(vsync);
-        m_frame_index = (m_frame_index + 1) % 3;
+        m_frame_index = (m_frame_index + 1) % GetFramesInFlight();
+    }
+
+    void Context::FlushUploads()
+    {
+        if (!m_upload_batch.command) return;
+
+        m_upload_batch.command->End();
+        m_upload_batch.fence_value = m_graphics_queue->Execute(m_upload_batch.command);
+        m_pending_uploads.emplace_back(std::move(m_upload_batch));
+        m_upload_batch = {};
     }
 
     void Context::ResizeBuffers(const uint32_t width, const uint32_t height)
@@ -379,7 +364,6 @@ namespace Swift::D3D12
                 CreateObject([&] { return new Texture(back_buffer, tex_create_info); }, m_textures, m_free_textures);
             m_swapchain_render_targets[i] = CreateTextureView(m_swapchain_textures[i], {});
         }
-        m_frame_index = m_swapchain->GetFrameIndex();
     }
 
     uint32_t Context::CalculateAlignedTextureSize(const TextureCreateInfo& info)
@@ -462,6 +446,15 @@ namespace Swift::D3D12
 #endif
     }
 
+    void Context::QueryFeatures(const ContextCreateInfo& create_info)
+    {
+        D3D12_FEATURE_DATA_D3D12_OPTIONS12 options12{};
+        if (SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS12, &options12, sizeof(options12))))
+        {
+            m_enhanced_barriers = create_info.enhanced_barriers && options12.EnhancedBarriersSupported;
+        }
+    }
+
     void Context::CreateAllocator()
     {
         D3D12MA::ALLOCATOR_DESC desc{
@@ -485,12 +478,14 @@ namespace Swift::D3D12
 
     typedef HRESULT(__stdcall* PFN_DxcCreateInstance)(REFCLSID rclsid, REFIID riid, LPVOID* ppv);
 
-    void Context::CreateFrameData()
+    void Context::CreateFrameData(const ContextCreateInfo& create_info)
     {
-        for (auto& [command, fence_value] : m_frame_data)
-        {
-            command = CreateCommand(m_graphics_queue);
-        }
+        const uint32_t frames_in_flight = std::max(create_info.frames_in_flight, 1u);
+        m_frame_data.resize(frames_in_flight);
+        m_command_pool = std::make_unique<CommandPool>(this, m_graphics_queue, frames_in_flight);
+        m_command_pool->Reserve(frames_in_flight);
+        m_command_pool->BeginFrame(m_frame_index);
+        GetFrameData().command = m_command_pool->Acquire();
     }
 
     void Context::CreateQueues()
@@ -502,6 +497,8 @@ namespace Swift::D3D12
     void Context::CreateTextures(const ContextCreateInfo& create_info)
     {
         constexpr auto format = Format::eRGBA8_UNORM;
+        m_swapchain_textures.resize(m_swapchain->GetBufferCount());
+        m_swapchain_render_targets.resize(m_swapchain->GetBufferCount());
         for (int i = 0; i < m_swapchain_textures.size(); i++)
         {
             ID3D12Resource* back_buffer = nullptr;
@@ -530,14 +527,101 @@ namespace Swift::D3D12
 
     void Context::CreateMipMapShader()
     {
-        std::vector<SamplerCreateInfo> sampler_descriptors;
-        sampler_descriptors.emplace_back(SamplerCreateInfo{});
         const ComputeShaderCreateInfo compute_shader_create_info{
             .code = gen_mips_code,
             .name = "Mip Map Shader",
         };
         m_mipmap_shader = CreateShader(compute_shader_create_info);
-        m_mipmap_sampler = CreateSampler({});
+        for (uint32_t i = 0; i < m_mipmap_samplers.size(); ++i)
+        {
+            m_mipmap_samplers[i] = CreateSampler({
+                .wrap_u = Wrap::eClampToEdge,
+                .wrap_y = Wrap::eClampToEdge,
+                .wrap_w = Wrap::eClampToEdge,
+                .reduction_type = static_cast<ReductionType>(i),
+            });
+        }
+    }
+
+    ICommand* Context::GetUploadCommand()
+    {
+        if (!m_upload_batch.command)
+        {
+            m_upload_batch.command = CreateCommand(m_graphics_queue, "Swift Upload Command");
+            m_upload_batch.command->Begin();
+        }
+        return m_upload_batch.command;
+    }
+
+    void Context::RetireUploads()
+    {
+        std::erase_if(m_pending_uploads,
+                      [&](const UploadBatch& batch)
+                      {
+                          if (!m_graphics_queue->IsComplete(batch.fence_value)) return false;
+
+                          for (auto* const texture_view : batch.texture_views)
+                          {
+                              DestroyTextureView(texture_view);
+                          }
+                          for (auto* const buffer : batch.buffers)
+                          {
+                              DestroyBuffer(buffer);
+                          }
+                          DestroyCommand(batch.command);
+                          return true;
+                      });
+    }
+
+    ISampler* Context::GetMipMapSampler(const ReductionType reduction) const
+    {
+        return m_mipmap_samplers[static_cast<uint32_t>(reduction)];
+    }
+
+    void Context::GenerateMips(ICommand* command, ITexture* texture, const ReductionType reduction)
+    {
+        const auto create_info = texture->GetCreateInfo();
+        command->TransitionImage(texture, ResourceState::eCommon);
+        command->BindShader(m_mipmap_shader);
+
+        for (uint32_t src_mip = 0; src_mip < create_info.mip_levels - 1; src_mip++)
+        {
+            auto* const texture_srv = CreateTextureView(texture,
+                                                        {
+                                                            .type = TextureViewType::eShaderResource,
+                                                            .base_mip_level = src_mip,
+                                                        });
+            auto* const texture_uav = CreateTextureView(texture,
+                                                        {
+                                                            .type = TextureViewType::eUnorderedAccess,
+                                                            .base_mip_level = src_mip + 1,
+                                                        });
+            m_upload_batch.texture_views.emplace_back(texture_srv);
+            m_upload_batch.texture_views.emplace_back(texture_uav);
+
+            struct PushConstant
+            {
+                uint32_t sampler_index;
+                uint32_t mip1_index;
+                uint32_t src_index;
+                std::array<float, 2> texel_size;
+            };
+
+            const uint32_t dst_width = std::max(create_info.width >> (src_mip + 1), 1u);
+            const uint32_t dst_height = std::max(create_info.height >> (src_mip + 1), 1u);
+
+            PushConstant pc{
+                .sampler_index = GetMipMapSampler(reduction)->GetDescriptorIndex(),
+                .mip1_index = texture_uav->GetDescriptorIndex(),
+                .src_index = texture_srv->GetDescriptorIndex(),
+                .texel_size = {1.0f / static_cast<float>(dst_width), 1.0f / static_cast<float>(dst_height)}};
+            command->PushConstants(&pc, sizeof(PushConstant));
+
+            // Round up so the last row and column of odd sizes are written too.
+            command->DispatchCompute((dst_width + 7) / 8, (dst_height + 7) / 8, 1);
+
+            command->UAVBarrier(texture);
+        }
     }
 
     void Context::CreateRootSignature()
@@ -0,0 +1,15 @@
+#include "d3d12/d3d12_fence.hpp"
+
+Swift::D3D12::Fence::Fence(ID3D12Device14* device, const uint64_t initial_value)
+{
+    device->CreateFence(initial_value, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence));
+}
+
+Swift::D3D12::Fence::~Fence() { m_fence->Release(); }
+
+void Swift::D3D12::Fence::SetEventOnCompletion(const uint64_t value, FenceEvent& event)
+{
+    // The runtime sets the event right away when the value has been reached already. Registrations cannot be
+    // withdrawn, a stale one only wakes a later wait of the same thread early.
+    m_fence->SetEventOnCompletion(value, static_cast<HANDLE>(event.GetHandle()));
+}
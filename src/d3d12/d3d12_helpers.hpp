@@ -327,6 +327,63 @@ namespace Swift::D3D12
         return D3D12_RESOURCE_STATE_COMMON;
     }
 
+    // Enhanced barrier equivalent of ToResourceState. The layout only applies to textures, buffers use
+    // D3D12_BARRIER_LAYOUT_UNDEFINED. Each state only synchronizes the stages that can touch it, which is what saves the
+    // full pipeline drains of legacy transitions.
+    struct BarrierState
+    {
+        D3D12_BARRIER_SYNC sync;
+        D3D12_BARRIER_ACCESS access;
+        D3D12_BARRIER_LAYOUT layout;
+    };
+
+    constexpr BarrierState ToBarrierState(const ResourceState state) noexcept
+    {
+        switch (state)
+        {
+            case ResourceState::eCommon:
+                return {D3D12_BARRIER_SYNC_ALL, D3D12_BARRIER_ACCESS_COMMON, D3D12_BARRIER_LAYOUT_COMMON};
+            case ResourceState::eCopyDest:
+                return {D3D12_BARRIER_SYNC_COPY, D3D12_BARRIER_ACCESS_COPY_DEST, D3D12_BARRIER_LAYOUT_COPY_DEST};
+            case ResourceState::eCopySource:
+                return {D3D12_BARRIER_SYNC_COPY, D3D12_BARRIER_ACCESS_COPY_SOURCE, D3D12_BARRIER_LAYOUT_COPY_SOURCE};
+            case ResourceState::eIndexBuffer:
+                return {D3D12_BARRIER_SYNC_INDEX_INPUT, D3D12_BARRIER_ACCESS_INDEX_BUFFER, D3D12_BARRIER_LAYOUT_UNDEFINED};
+            case ResourceState::eUnorderedAccess:
+                return {D3D12_BARRIER_SYNC_ALL_SHADING,
+                        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+                        D3D12_BARRIER_LAYOUT_UNORDERED_ACCESS};
+            case ResourceState::eRenderTarget:
+                return {D3D12_BARRIER_SYNC_RENDER_TARGET,
+                        D3D12_BARRIER_ACCESS_RENDER_TARGET,
+                        D3D12_BARRIER_LAYOUT_RENDER_TARGET};
+            case ResourceState::eDepthWrite:
+                return {D3D12_BARRIER_SYNC_DEPTH_STENCIL,
+                        D3D12_BARRIER_ACCESS_DEPTH_STENCIL_WRITE,
+                        D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE};
+            case ResourceState::eDepthRead:
+                return {D3D12_BARRIER_SYNC_DEPTH_STENCIL,
+                        D3D12_BARRIER_ACCESS_DEPTH_STENCIL_READ,
+                        D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_READ};
+            case ResourceState::eShaderResource:
+                return {D3D12_BARRIER_SYNC_ALL_SHADING,
+                        D3D12_BARRIER_ACCESS_SHADER_RESOURCE,
+                        D3D12_BARRIER_LAYOUT_SHADER_RESOURCE};
+            case ResourceState::ePresent:
+                // Nothing on the GPU touches the back buffer until the next frame transitions it again.
+                return {D3D12_BARRIER_SYNC_NONE, D3D12_BARRIER_ACCESS_NO_ACCESS, D3D12_BARRIER_LAYOUT_PRESENT};
+            case ResourceState::eConstant:
+                return {D3D12_BARRIER_SYNC_ALL_SHADING,
+                        D3D12_BARRIER_ACCESS_CONSTANT_BUFFER,
+                        D3D12_BARRIER_LAYOUT_UNDEFINED};
+            case ResourceState::eIndirectArgument:
+                return {D3D12_BARRIER_SYNC_EXECUTE_INDIRECT,
+                        D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT,
+                        D3D12_BARRIER_LAYOUT_UNDEFINED};
+        }
+        return {D3D12_BARRIER_SYNC_ALL, D3D12_BARRIER_ACCESS_COMMON, D3D12_BARRIER_LAYOUT_COMMON};
+    }
+
     constexpr D3D12_FILTER ToFilter(const Filter min_filter,
                                     const Filter mag_filter,
                                     const ReductionType type = ReductionType::eStandard) noexcept
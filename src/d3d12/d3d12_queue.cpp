@@ -1,8 +1,9 @@
 #include "d3d12/d3d12_queue.hpp"
 #include "d3d12_helpers.hpp"
 #include "array"
+#include "vector"
 
-Swift::D3D12::Queue::Queue(ID3D12Device14* device, const QueueCreateInfo& info) : IQueue(info.type)
+Swift::D3D12::Queue::Queue(ID3D12Device14* device, const QueueCreateInfo& info) : IQueue(info.type), m_fence(device, 0)
 {
     const D3D12_COMMAND_QUEUE_DESC queue_desc = {
         .Type = ToCommandType(info.type),
@@ -11,44 +12,69 @@ Swift::D3D12::Queue::Queue(ID3D12Device14* device, const QueueCreateInfo& info)
         .NodeMask = 0,
     };
     device->CreateCommandQueue(&queue_desc, IID_PPV_ARGS(&m_queue));
-    device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence));
     const std::wstring name{info.name.begin(), info.name.end()};
     m_queue->SetName(name.c_str());
 }
 
-Swift::D3D12::Queue::~Queue()
-{
-    m_fence->Release();
-    m_queue->Release();
-}
+Swift::D3D12::Queue::~Queue() { m_queue->Release(); }
+
+void Swift::D3D12::Queue::WaitIdle() { m_fence.Wait(Signal()); }
 
-void Swift::D3D12::Queue::Wait(const uint64_t fence_value)
+uint64_t Swift::D3D12::Queue::Submit(const SubmitInfo& info)
 {
-    if (m_fence->GetCompletedValue() < fence_value)
+    for (const auto& [fence, value] : info.waits)
+    {
+        WaitForFence(fence, value);
+    }
+
+    // Frames submit a handful of lists, those stay on the stack. Larger batches spill to the heap.
+    constexpr size_t k_inline_list_count = 16;
+    std::array<ID3D12CommandList*, k_inline_list_count> inline_lists;
+    std::vector<ID3D12CommandList*> heap_lists;
+    ID3D12CommandList** command_lists = inline_lists.data();
+    if (info.commands.size() > k_inline_list_count)
+    {
+        heap_lists.resize(info.commands.size());
+        command_lists = heap_lists.data();
+    }
+    for (size_t i = 0; i < info.commands.size(); i++)
+    {
+        command_lists[i] = static_cast<ID3D12CommandList*>(info.commands[i]->GetCommandList());
+    }
+    if (!info.commands.empty())
     {
-        m_fence->SetEventOnCompletion(fence_value, nullptr);
+        m_queue->ExecuteCommandLists(static_cast<uint32_t>(info.commands.size()), command_lists);
     }
+
+    const uint64_t fence_value = Signal();
+    for (const auto& [fence, value] : info.signals)
+    {
+        Signal(fence, value);
+    }
+    return fence_value;
 }
 
-void Swift::D3D12::Queue::WaitIdle()
+uint64_t Swift::D3D12::Queue::Signal()
 {
     m_fence_value++;
-    m_queue->Signal(m_fence, m_fence_value);
-    if (m_fence->GetCompletedValue() < m_fence_value)
+    Signal(&m_fence, m_fence_value);
+    return m_fence_value;
+}
+
+void Swift::D3D12::Queue::Signal(IFence* fence, const uint64_t value)
+{
+    if (auto* const dx_fence = static_cast<ID3D12Fence*>(fence->GetFence()))
     {
-        m_fence->SetEventOnCompletion(m_fence_value, nullptr);
+        m_queue->Signal(dx_fence, value);
     }
 }
 
-uint64_t Swift::D3D12::Queue::Execute(const std::span<ICommand*> commands)
+void Swift::D3D12::Queue::WaitForFence(IFence* fence, const uint64_t value)
 {
-    std::array<ID3D12CommandList*, 8> command_lists;
-    for (size_t i = 0; i < commands.size(); i++)
+    if (auto* const dx_fence = static_cast<ID3D12Fence*>(fence->GetFence()))
     {
-        command_lists[i] = static_cast<ID3D12CommandList*>(commands[i]->GetCommandList());
+        m_queue->Wait(dx_fence, value);
+        return;
     }
-    m_queue->ExecuteCommandLists(static_cast<uint32_t>(commands.size()), command_lists.data());
-    m_fence_value++;
-    m_queue->Signal(m_fence, m_fence_value);
-    return m_fence_value;
+    fence->Wait(value);
 }
@@ -1,11 +1,19 @@
 #include "d3d12/d3d12_swapchain.hpp"
 #include "d3d12/d3d12_helpers.hpp"
 #include "d3d12/d3d12_context.hpp"
+#include "algorithm"
+#include "swift_fence.hpp"
 
 Swift::D3D12::Swapchain::Swapchain(IDXGIFactory7* factory, ID3D12CommandQueue* queue, const ContextCreateInfo& create_info)
+    : m_buffer_count(std::clamp(create_info.swapchain_buffer_count, 2u, static_cast<uint32_t>(DXGI_MAX_SWAP_CHAIN_BUFFERS)))
 {
     auto *const hwnd = static_cast<HWND>(create_info.native_window_handle);
     constexpr auto format = Format::eRGBA8_UNORM;
+    m_flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+    if (create_info.frame_latency_waitable)
+    {
+        m_flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+    }
     const DXGI_SWAP_CHAIN_DESC1 swapchain_desc = {
         .Width = create_info.width,
         .Height = create_info.height,
@@ -13,20 +21,34 @@ Swift::D3D12::Swapchain::Swapchain(IDXGIFactory7* factory, ID3D12CommandQueue* q
         .Stereo = false,
         .SampleDesc = DXGI_SAMPLE_DESC{1, 0},
         .BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT,
-        .BufferCount = 3,
+        .BufferCount = m_buffer_count,
         .Scaling = DXGI_SCALING_STRETCH,
         .SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD,
         .AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED,
-        .Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING,
+        .Flags = m_flags,
     };
     IDXGISwapChain1* swapchain = nullptr;
 
     factory->CreateSwapChainForHwnd(queue, hwnd, &swapchain_desc, nullptr, nullptr, &swapchain);
     swapchain->QueryInterface(IID_PPV_ARGS(&m_swapchain));
+    swapchain->Release();
+
+    if (create_info.frame_latency_waitable)
+    {
+        // Latency above the frames in flight would only make NewFrame fall back to the fence wait.
+        const uint32_t frames_in_flight = std::max(create_info.frames_in_flight, 1u);
+        const uint32_t latency = create_info.max_frame_latency ? create_info.max_frame_latency : frames_in_flight;
+        m_swapchain->SetMaximumFrameLatency(std::clamp(latency, 1u, 16u));
+        m_frame_latency_waitable = m_swapchain->GetFrameLatencyWaitableObject();
+    }
 }
 
 Swift::D3D12::Swapchain::~Swapchain()
 {
+    if (m_frame_latency_waitable)
+    {
+        CloseHandle(m_frame_latency_waitable);
+    }
     m_swapchain->SetFullscreenState(false, nullptr);
     m_swapchain->Release();
 }
@@ -39,11 +61,17 @@ void Swift::D3D12::Swapchain::Present(const bool m_vsync) const
 
 void Swift::D3D12::Swapchain::Resize(const uint32_t width, const uint32_t height) const
 {
-    m_swapchain->ResizeBuffers(3,
-                               width,
-                               height,
-                               DXGI_FORMAT_R8G8B8A8_UNORM,
-                               DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING);
+    // The flags have to match the ones the swapchain was created with, the waitable object survives the resize.
+    m_swapchain->ResizeBuffers(m_buffer_count, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, m_flags);
 }
 
 uint32_t Swift::D3D12::Swapchain::GetFrameIndex() const { return m_swapchain->GetCurrentBackBufferIndex(); }
+
+bool Swift::D3D12::Swapchain::WaitForFrameLatency(const std::chrono::milliseconds timeout) const
+{
+    if (!m_frame_latency_waitable) return true;
+
+    const DWORD milliseconds =
+        timeout == k_infinite_timeout ? INFINITE : static_cast<DWORD>(std::min<int64_t>(timeout.count(), INFINITE - 1));
+    return WaitForSingleObjectEx(m_frame_latency_waitable, milliseconds, TRUE) == WAIT_OBJECT_0;
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include "chrono"
 #include "cstdint"
 #include "swift_macros.hpp"
 #include "swift_structs.hpp"
@@ -21,8 +22,16 @@ namespace Swift::D3D12
         IDXGISwapChain4* GetSwapchain() const { return m_swapchain; };
         void Resize(uint32_t width, uint32_t height) const;
         uint32_t GetFrameIndex() const;
+        uint32_t GetBufferCount() const { return m_buffer_count; }
+        // Blocks until the swapchain has room for another frame. Returns false on timeout and true right away when the
+        // swapchain was created without the frame latency waitable object.
+        bool WaitForFrameLatency(std::chrono::milliseconds timeout) const;
+        bool HasFrameLatencyWaitable() const { return m_frame_latency_waitable != nullptr; }
 
     private:
         IDXGISwapChain4* m_swapchain = nullptr;
+        HANDLE m_frame_latency_waitable = nullptr;
+        uint32_t m_buffer_count = 3;
+        UINT m_flags = 0;
     };
 }  // namespace Swift::D3D12
@@ -87,21 +87,47 @@ void Swift::D3D12::TextureView::CreateShaderResource(const Context* context,
     auto* const resource = static_cast<ID3D12Resource*>(texture->GetResource());
     auto* srv_heap = context->GetCBVSRVUAVHeap();
     m_descriptor_data = srv_heap->Allocate();
-    const bool is_cubemap = texture->GetArraySize() > 1;
+    // Only textures created with TextureFlags::eCube are sampled as cubes, a count of slices that does not fill whole
+    // cubes falls back to a plain array.
+    const uint32_t array_size = texture->GetArraySize();
+    const bool is_cube = texture->GetCreateInfo().flags & TextureFlags::eCube && array_size % 6 == 0;
+    const bool is_cube_array = is_cube && array_size > 6;
+    const bool is_array = array_size > 1 && !is_cube;
 
     D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {
         .Format = ToViewDXGIFormat(texture->GetFormat()),
-        .ViewDimension = is_cubemap ? D3D12_SRV_DIMENSION_TEXTURECUBE : D3D12_SRV_DIMENSION_TEXTURE2D,
+        .ViewDimension = is_cube_array ? D3D12_SRV_DIMENSION_TEXTURECUBEARRAY
+                         : is_cube     ? D3D12_SRV_DIMENSION_TEXTURECUBE
+                         : is_array    ? D3D12_SRV_DIMENSION_TEXTURE2DARRAY
+                                       : D3D12_SRV_DIMENSION_TEXTURE2D,
         .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
     };
 
-    if (is_cubemap)
+    if (is_cube_array)
+    {
+        srv_desc.TextureCubeArray = {
+            .MostDetailedMip = texture_view_create_info.base_mip_level,
+            .MipLevels = mip_count,
+            .First2DArrayFace = 0,
+            .NumCubes = array_size / 6,
+        };
+    }
+    else if (is_cube)
     {
         srv_desc.TextureCube = {
             .MostDetailedMip = texture_view_create_info.base_mip_level,
             .MipLevels = mip_count,
         };
     }
+    else if (is_array)
+    {
+        srv_desc.Texture2DArray = {
+            .MostDetailedMip = texture_view_create_info.base_mip_level,
+            .MipLevels = mip_count,
+            .FirstArraySlice = 0,
+            .ArraySize = array_size,
+        };
+    }
     else
     {
         srv_desc.Texture2D = {
@@ -32,47 +32,16 @@ void Swift::RG::RenderGraph::Execute()
                     }
                     m_command->BindShader(node.m_shader);
 
-                    for (auto& input : node.m_input_resources)
-                    {
-                        std::visit(
-                            [&](auto&& view)
-                            {
-                                using T = std::decay_t<decltype(view)>;
-                                if constexpr (std::is_same_v<T, ITextureView*>)
-                                {
-                                    m_command->TransitionImage(T(view)->GetTexture(), ResourceState::eShaderResource);
-                                }
-                                else if constexpr (std::is_same_v<T, IBufferView*>)
-                                {
-                                    m_command->TransitionBuffer(T(view)->GetBuffer(), ResourceState::eShaderResource);
-                                }
-                            },
-                            input.view);
-                    }
-
-                    for (auto& output : node.m_output_resources)
-                    {
-                        std::visit(
-                            [&](auto&& view)
-                            {
-                                using T = std::decay_t<decltype(view)>;
-                                if constexpr (std::is_same_v<T, ITextureView*>)
-                                {
-                                    m_command->TransitionImage(T(view)->GetTexture(), ResourceState::eUnorderedAccess);
-                                }
-                                else if constexpr (std::is_same_v<T, IBufferView*>)
-                                {
-                                    m_command->TransitionBuffer(T(view)->GetBuffer(), ResourceState::eUnorderedAccess);
-                                }
-                            },
-                            output.view);
-                    }
+                    AddTransitions(node.m_input_resources, ResourceState::eShaderResource);
+                    AddTransitions(node.m_output_resources, ResourceState::eUnorderedAccess);
 
                     std::optional<RenderAttachmentInfo> color_attachment_info{std::nullopt};
                     if (std::holds_alternative<ITextureView*>(node.m_render_target_handle.view))
                     {
-                        m_command->TransitionImage(std::get<ITextureView*>(node.m_render_target_handle.view)->GetTexture(),
-                                                   ResourceState::eRenderTarget);
+                        m_texture_transitions.emplace_back(TextureTransition{
+                            .texture = std::get<ITextureView*>(node.m_render_target_handle.view)->GetTexture(),
+                            .state = ResourceState::eRenderTarget,
+                        });
                         color_attachment_info = RenderAttachmentInfo{
                             .render_target = std::get<ITextureView*>(node.m_render_target_handle.view),
                             .load_op = node.m_render_load_op,
@@ -84,8 +53,10 @@ void Swift::RG::RenderGraph::Execute()
                     std::optional<DepthAttachmentInfo> depth_attachment_info{std::nullopt};
                     if (std::holds_alternative<ITextureView*>(node.m_depth_stencil_handle.view))
                     {
-                        m_command->TransitionImage(std::get<ITextureView*>(node.m_depth_stencil_handle.view)->GetTexture(),
-                                                   ResourceState::eDepthWrite);
+                        m_texture_transitions.emplace_back(TextureTransition{
+                            .texture = std::get<ITextureView*>(node.m_depth_stencil_handle.view)->GetTexture(),
+                            .state = ResourceState::eDepthWrite,
+                        });
                         depth_attachment_info = {
                             .depth_stencil = std::get<ITextureView*>(node.m_depth_stencil_handle.view),
                             .load_op = node.m_depth_load_op,
@@ -94,6 +65,7 @@ void Swift::RG::RenderGraph::Execute()
                             .clear_stencil = node.m_clear_stencil,
                         };
                     }
+                    FlushTransitions();
                     m_command->BeginRender(color_attachment_info, depth_attachment_info);
                     node.m_execute(m_command);
                     m_command->EndRender();
@@ -102,41 +74,9 @@ void Swift::RG::RenderGraph::Execute()
                 {
                     m_command->BindShader(node.m_shader);
 
-                    for (auto& input : node.m_input_resources)
-                    {
-                        std::visit(
-                            [&](auto&& view)
-                            {
-                                using T = std::decay_t<decltype(view)>;
-                                if constexpr (std::is_same_v<T, ITextureView*>)
-                                {
-                                    m_command->TransitionImage(T(view)->GetTexture(), ResourceState::eShaderResource);
-                                }
-                                else if constexpr (std::is_same_v<T, IBufferView*>)
-                                {
-                                    m_command->TransitionBuffer(T(view)->GetBuffer(), ResourceState::eShaderResource);
-                                }
-                            },
-                            input.view);
-                    }
-
-                    for (auto& output : node.m_output_resources)
-                    {
-                        std::visit(
-                            [&](auto&& view)
-                            {
-                                using T = std::decay_t<decltype(view)>;
-                                if constexpr (std::is_same_v<T, ITextureView*>)
-                                {
-                                    m_command->TransitionImage(T(view)->GetTexture(), ResourceState::eUnorderedAccess);
-                                }
-                                else if constexpr (std::is_same_v<T, IBufferView*>)
-                                {
-                                    m_command->TransitionBuffer(T(view)->GetBuffer(), ResourceState::eUnorderedAccess);
-                                }
-                            },
-                            output.view);
-                    }
+                    AddTransitions(node.m_input_resources, ResourceState::eShaderResource);
+                    AddTransitions(node.m_output_resources, ResourceState::eUnorderedAccess);
+                    FlushTransitions();
 
                     node.m_execute(m_command);
                 },
@@ -178,4 +118,32 @@ void Swift::RG::RenderGraph::Execute()
                 }},
             var_node);
     }
-}
\ No newline at end of file
+}
+
+void Swift::RG::RenderGraph::AddTransitions(const std::vector<ResourceHandle>& handles, const ResourceState state)
+{
+    for (const auto& handle : handles)
+    {
+        std::visit(
+            [&](auto&& view)
+            {
+                using T = std::decay_t<decltype(view)>;
+                if constexpr (std::is_same_v<T, ITextureView*>)
+                {
+                    m_texture_transitions.emplace_back(TextureTransition{.texture = view->GetTexture(), .state = state});
+                }
+                else if constexpr (std::is_same_v<T, IBufferView*>)
+                {
+                    m_buffer_transitions.emplace_back(BufferTransition{.buffer = view->GetBuffer(), .state = state});
+                }
+            },
+            handle.view);
+    }
+}
+
+void Swift::RG::RenderGraph::FlushTransitions()
+{
+    m_command->TransitionResources(m_texture_transitions, m_buffer_transitions);
+    m_texture_transitions.clear();
+    m_buffer_transitions.clear();
+}
@@ -0,0 +1,70 @@
+#include "swift_command_pool.hpp"
+#include "swift_context.hpp"
+#include "algorithm"
+
+Swift::CommandPool::CommandPool(IContext* context, IQueue* queue, const uint32_t frame_count)
+    : m_context(context), m_queue(queue), m_frames(std::max(frame_count, 1u))
+{
+}
+
+Swift::CommandPool::~CommandPool()
+{
+    uint64_t last_fence_value = 0;
+    for (const auto& frame : m_frames)
+    {
+        last_fence_value = std::max(last_fence_value, frame.fence_value);
+    }
+    m_queue->Wait(last_fence_value);
+
+    for (auto* command : m_commands)
+    {
+        m_context->DestroyCommand(command);
+    }
+}
+
+void Swift::CommandPool::BeginFrame(const uint32_t frame_index)
+{
+    m_frame_index = frame_index % GetFrameCount();
+    auto& [commands, fence_value] = m_frames[m_frame_index];
+    if (commands.empty()) return;
+
+    m_queue->Wait(fence_value);
+    std::lock_guard lock(m_mutex);
+    m_free_commands.insert(m_free_commands.end(), commands.begin(), commands.end());
+    commands.clear();
+}
+
+Swift::ICommand* Swift::CommandPool::Acquire(const std::string_view debug_name)
+{
+    std::lock_guard lock(m_mutex);
+    ICommand* command = nullptr;
+    if (!m_free_commands.empty())
+    {
+        command = m_free_commands.back();
+        m_free_commands.pop_back();
+    }
+    else
+    {
+        command = m_context->CreateCommand(m_queue, debug_name);
+        m_commands.emplace_back(command);
+    }
+    m_frames[m_frame_index].commands.emplace_back(command);
+    return command;
+}
+
+void Swift::CommandPool::EndFrame(const uint64_t fence_value)
+{
+    auto& frame = m_frames[m_frame_index];
+    frame.fence_value = std::max(frame.fence_value, fence_value);
+}
+
+void Swift::CommandPool::Reserve(const uint32_t count)
+{
+    std::lock_guard lock(m_mutex);
+    while (m_free_commands.size() < count)
+    {
+        auto* command = m_context->CreateCommand(m_queue);
+        m_commands.emplace_back(command);
+        m_free_commands.emplace_back(command);
+    }
+}
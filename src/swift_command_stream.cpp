@@ -0,0 +1,783 @@
+#include "swift_command_stream.hpp"
+#include "swift_shader.hpp"
+#include "algorithm"
+#include "array"
+#include "cstring"
+#include "format"
+
+namespace
+{
+    constexpr size_t AlignCommandSize(const size_t size)
+    {
+        return (size + Swift::k_command_alignment - 1) & ~(Swift::k_command_alignment - 1);
+    }
+
+    // Copies the command struct out of the packet, serialized data makes no promise about alignment.
+    template<typename T>
+    bool ReadCommand(const Swift::CommandHeader& header, const std::byte* packet, T& command)
+    {
+        if (header.size < sizeof(Swift::CommandHeader) + sizeof(T)) return false;
+        std::memcpy(&command, packet + sizeof(Swift::CommandHeader), sizeof(T));
+        return true;
+    }
+
+    template<typename T>
+    const std::byte* GetTrailingData(const std::byte* packet)
+    {
+        return packet + sizeof(Swift::CommandHeader) + sizeof(T);
+    }
+
+    // States only one kind of resource can be in, the rest apply to both.
+    bool IsBufferState(const Swift::ResourceState state)
+    {
+        return state == Swift::ResourceState::eConstant || state == Swift::ResourceState::eIndexBuffer ||
+               state == Swift::ResourceState::eIndirectArgument;
+    }
+
+    bool IsTextureState(const Swift::ResourceState state)
+    {
+        return state == Swift::ResourceState::eRenderTarget || state == Swift::ResourceState::eDepthWrite ||
+               state == Swift::ResourceState::eDepthRead || state == Swift::ResourceState::ePresent;
+    }
+
+    // Returns false on the first packet that does not fit the data or has an unknown type.
+    bool ReplayBlock(const std::span<const std::byte> block, Swift::ICommand* command)
+    {
+        using namespace Swift;
+        size_t offset = 0;
+        while (offset < block.size())
+        {
+            if (block.size() - offset < sizeof(CommandHeader)) return false;
+
+            CommandHeader header{};
+            const std::byte* packet = block.data() + offset;
+            std::memcpy(&header, packet, sizeof(CommandHeader));
+            if (header.size < sizeof(CommandHeader) || header.size > block.size() - offset) return false;
+            offset += header.size;
+
+            switch (header.type)
+            {
+                case CommandType::eSetViewport:
+                {
+                    SetViewportCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->SetViewport(cmd.viewport);
+                    break;
+                }
+                case CommandType::eSetScissor:
+                {
+                    SetScissorCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->SetScissor(cmd.scissor);
+                    break;
+                }
+                case CommandType::ePushConstants:
+                {
+                    PushConstantsCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    if (header.size < sizeof(CommandHeader) + sizeof(cmd) + cmd.size) return false;
+                    // Copied so the backend gets 4 byte aligned constants whatever the source alignment.
+                    std::array<uint32_t, 64> constants{};
+                    if (cmd.size > sizeof(constants)) return false;
+                    std::memcpy(constants.data(), GetTrailingData<PushConstantsCommand>(packet), cmd.size);
+                    command->PushConstants(constants.data(), cmd.size, cmd.offset);
+                    break;
+                }
+                case CommandType::eBindShader:
+                {
+                    BindShaderCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->BindShader(cmd.shader);
+                    break;
+                }
+                case CommandType::eDispatchMesh:
+                {
+                    DispatchCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->DispatchMesh(cmd.group_x, cmd.group_y, cmd.group_z);
+                    break;
+                }
+                case CommandType::eExecuteIndirect:
+                {
+                    ExecuteIndirectCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->ExecuteIndirect(cmd.signature,
+                                             cmd.max_commands,
+                                             cmd.argument_buffer,
+                                             cmd.argument_offset,
+                                             cmd.count_buffer,
+                                             cmd.count_offset);
+                    break;
+                }
+                case CommandType::eDispatchCompute:
+                {
+                    DispatchCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->DispatchCompute(cmd.group_x, cmd.group_y, cmd.group_z);
+                    break;
+                }
+                case CommandType::eCopyBufferToTexture:
+                {
+                    CopyBufferToTextureCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->CopyBufferToTexture(cmd.buffer, cmd.texture, cmd.mip_levels, cmd.array_size);
+                    break;
+                }
+                case CommandType::eCopyTextureToTexture:
+                {
+                    CopyTextureToTextureCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->CopyTextureToTexture(cmd.src, cmd.dst, cmd.region);
+                    break;
+                }
+                case CommandType::eCopyBufferToBuffer:
+                {
+                    CopyBufferToBufferCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->CopyBufferToBuffer(cmd.src, cmd.dst, cmd.region);
+                    break;
+                }
+                case CommandType::eBindConstantBuffer:
+                {
+                    BindConstantBufferCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->BindConstantBuffer(cmd.buffer, cmd.slot, cmd.offset);
+                    break;
+                }
+                case CommandType::eBeginRender:
+                {
+                    BeginRenderCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    std::array<RenderAttachmentInfo, 8> color_attachments{};
+                    if (cmd.color_count > color_attachments.size()) return false;
+                    const size_t color_size = cmd.color_count * sizeof(RenderAttachmentInfo);
+                    if (header.size < sizeof(CommandHeader) + sizeof(cmd) + color_size) return false;
+                    std::memcpy(color_attachments.data(), GetTrailingData<BeginRenderCommand>(packet), color_size);
+
+                    std::optional<const DepthAttachmentInfo> depth_attachment;
+                    if (cmd.has_depth)
+                    {
+                        depth_attachment.emplace(cmd.depth);
+                    }
+                    command->BeginRender(std::span(color_attachments.data(), cmd.color_count), depth_attachment);
+                    break;
+                }
+                case CommandType::eEndRender:
+                    command->EndRender();
+                    break;
+                case CommandType::eClearRenderTarget:
+                {
+                    ClearRenderTargetCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->ClearRenderTarget(cmd.render_target, cmd.color);
+                    break;
+                }
+                case CommandType::eClearDepthStencil:
+                {
+                    ClearDepthStencilCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->ClearDepthStencil(cmd.depth_stencil, cmd.depth, cmd.stencil);
+                    break;
+                }
+                case CommandType::eTransitionImage:
+                {
+                    TransitionImageCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->TransitionImage(cmd.texture, cmd.state);
+                    break;
+                }
+                case CommandType::eTransitionBuffer:
+                {
+                    TransitionBufferCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->TransitionBuffer(cmd.buffer, cmd.state);
+                    break;
+                }
+                case CommandType::eTransitionResources:
+                {
+                    TransitionResourcesCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    const size_t texture_size = size_t{cmd.texture_count} * sizeof(TextureTransition);
+                    const size_t buffer_size = size_t{cmd.buffer_count} * sizeof(BufferTransition);
+                    if (header.size < sizeof(CommandHeader) + sizeof(cmd) + texture_size + buffer_size) return false;
+                    std::vector<TextureTransition> textures(cmd.texture_count);
+                    std::vector<BufferTransition> buffers(cmd.buffer_count);
+                    const std::byte* data = GetTrailingData<TransitionResourcesCommand>(packet);
+                    std::memcpy(textures.data(), data, texture_size);
+                    std::memcpy(buffers.data(), data + texture_size, buffer_size);
+                    command->TransitionResources(textures, buffers);
+                    break;
+                }
+                case CommandType::eUAVBarrierBuffer:
+                {
+                    UAVBarrierBufferCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->UAVBarrier(cmd.buffer);
+                    break;
+                }
+                case CommandType::eUAVBarrierTexture:
+                {
+                    UAVBarrierTextureCommand cmd{};
+                    if (!ReadCommand(header, packet, cmd)) return false;
+                    command->UAVBarrier(cmd.texture);
+                    break;
+                }
+                case CommandType::eInvalidateState:
+                    command->InvalidateState();
+                    break;
+                default:
+                    return false;
+            }
+        }
+        return true;
+    }
+}  // namespace
+
+Swift::CommandArena::CommandArena(const size_t block_size) : m_block_size(AlignCommandSize(std::max<size_t>(block_size, 256)))
+{
+}
+
+std::byte* Swift::CommandArena::Allocate(const size_t size)
+{
+    const size_t aligned_size = AlignCommandSize(size);
+    if (m_used_blocks.empty() || m_used_blocks.back().size() + aligned_size > m_blocks[m_used_blocks.size() - 1].capacity)
+    {
+        // Reuses the blocks kept from earlier recordings before allocating, skipping any that are too small.
+        size_t index = m_used_blocks.size();
+        while (index < m_blocks.size() && m_blocks[index].capacity < aligned_size)
+        {
+            ++index;
+        }
+        if (index == m_blocks.size())
+        {
+            const size_t capacity = std::max(m_block_size, aligned_size);
+            m_blocks.emplace_back(Block{.data = std::make_unique<std::byte[]>(capacity), .capacity = capacity});
+        }
+        std::swap(m_blocks[m_used_blocks.size()], m_blocks[index]);
+        m_used_blocks.emplace_back(m_blocks[m_used_blocks.size()].data.get(), 0);
+    }
+
+    auto& used = m_used_blocks.back();
+    std::byte* data = const_cast<std::byte*>(used.data()) + used.size();
+    used = std::span<const std::byte>(used.data(), used.size() + aligned_size);
+    return data;
+}
+
+void Swift::CommandArena::Reset() { m_used_blocks.clear(); }
+
+size_t Swift::CommandArena::GetUsedSize() const
+{
+    size_t size = 0;
+    for (const auto& block : m_used_blocks)
+    {
+        size += block.size();
+    }
+    return size;
+}
+
+Swift::CommandRecorder::CommandRecorder(const size_t block_size) : m_arena(block_size) {}
+
+template<typename T>
+T& Swift::CommandRecorder::Emplace(const CommandType type, const size_t trailing_size)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    const size_t size = AlignCommandSize(sizeof(CommandHeader) + sizeof(T) + trailing_size);
+    std::byte* packet = m_arena.Allocate(size);
+    const CommandHeader header{.type = type, .size = static_cast<uint32_t>(size)};
+    std::memcpy(packet, &header, sizeof(header));
+    m_command_count++;
+    return *new (packet + sizeof(CommandHeader)) T{};
+}
+
+void Swift::CommandRecorder::Begin()
+{
+    m_arena.Reset();
+    m_command_count = 0;
+    m_recording = true;
+}
+
+void Swift::CommandRecorder::End() { m_recording = false; }
+
+void Swift::CommandRecorder::SetViewport(const Viewport& viewport)
+{
+    Emplace<SetViewportCommand>(CommandType::eSetViewport).viewport = viewport;
+}
+
+void Swift::CommandRecorder::SetScissor(const Scissor& scissor)
+{
+    Emplace<SetScissorCommand>(CommandType::eSetScissor).scissor = scissor;
+}
+
+void Swift::CommandRecorder::PushConstants(const void* data, const uint32_t size, const uint32_t offset)
+{
+    auto& cmd = Emplace<PushConstantsCommand>(CommandType::ePushConstants, size);
+    cmd = {.size = size, .offset = offset};
+    std::memcpy(reinterpret_cast<std::byte*>(&cmd) + sizeof(cmd), data, size);
+}
+
+void Swift::CommandRecorder::BindShader(IShader* shader)
+{
+    Emplace<BindShaderCommand>(CommandType::eBindShader).shader = shader;
+}
+
+void Swift::CommandRecorder::DispatchMesh(const uint32_t group_x, const uint32_t group_y, const uint32_t group_z)
+{
+    Emplace<DispatchCommand>(CommandType::eDispatchMesh) = {.group_x = group_x, .group_y = group_y, .group_z = group_z};
+}
+
+void Swift::CommandRecorder::ExecuteIndirect(ICommandSignature* signature,
+                                             const uint32_t max_commands,
+                                             IBuffer* argument_buffer,
+                                             const uint32_t argument_offset,
+                                             IBuffer* count_buffer,
+                                             const uint32_t count_offset)
+{
+    Emplace<ExecuteIndirectCommand>(CommandType::eExecuteIndirect) = {
+        .signature = signature,
+        .argument_buffer = argument_buffer,
+        .count_buffer = count_buffer,
+        .max_commands = max_commands,
+        .argument_offset = argument_offset,
+        .count_offset = count_offset,
+    };
+}
+
+void Swift::CommandRecorder::DispatchCompute(const uint32_t group_x, const uint32_t group_y, const uint32_t group_z)
+{
+    Emplace<DispatchCommand>(CommandType::eDispatchCompute) = {.group_x = group_x, .group_y = group_y, .group_z = group_z};
+}
+
+void Swift::CommandRecorder::CopyBufferToTexture(IBuffer* buffer,
+                                                 ITexture* texture,
+                                                 const uint16_t mip_levels,
+                                                 const uint16_t array_size)
+{
+    Emplace<CopyBufferToTextureCommand>(CommandType::eCopyBufferToTexture) = {
+        .buffer = buffer,
+        .texture = texture,
+        .mip_levels = mip_levels,
+        .array_size = array_size,
+    };
+}
+
+void Swift::CommandRecorder::CopyTextureToTexture(ITexture* src, ITexture* dst, const TextureCopyRegion& copy_region)
+{
+    Emplace<CopyTextureToTextureCommand>(CommandType::eCopyTextureToTexture) = {
+        .src = src,
+        .dst = dst,
+        .region = copy_region,
+    };
+}
+
+void Swift::CommandRecorder::CopyBufferToBuffer(IBuffer* src, IBuffer* dst, const BufferCopyRegion& region)
+{
+    Emplace<CopyBufferToBufferCommand>(CommandType::eCopyBufferToBuffer) = {.src = src, .dst = dst, .region = region};
+}
+
+void Swift::CommandRecorder::BindConstantBuffer(IBuffer* buffer, const uint32_t slot, const uint32_t offset)
+{
+    Emplace<BindConstantBufferCommand>(CommandType::eBindConstantBuffer) = {
+        .buffer = buffer,
+        .slot = slot,
+        .offset = offset,
+    };
+}
+
+void Swift::CommandRecorder::BeginRender(const std::span<const RenderAttachmentInfo> color_attachments,
+                                         const std::optional<const DepthAttachmentInfo>& depth_attachment)
+{
+    auto& cmd = Emplace<BeginRenderCommand>(CommandType::eBeginRender, color_attachments.size_bytes());
+    cmd = {
+        .color_count = static_cast<uint32_t>(color_attachments.size()),
+        .has_depth = depth_attachment.has_value(),
+        .depth = depth_attachment.value_or(DepthAttachmentInfo{}),
+    };
+    std::memcpy(reinterpret_cast<std::byte*>(&cmd) + sizeof(cmd), color_attachments.data(), color_attachments.size_bytes());
+}
+
+void Swift::CommandRecorder::EndRender() { Emplace<EmptyCommand>(CommandType::eEndRender); }
+
+void Swift::CommandRecorder::ClearRenderTarget(ITextureView* render_target, const Float4& color)
+{
+    Emplace<ClearRenderTargetCommand>(CommandType::eClearRenderTarget) = {.render_target = render_target, .color = color};
+}
+
+void Swift::CommandRecorder::ClearDepthStencil(ITextureView* depth_stencil, const float depth, const uint8_t stencil)
+{
+    Emplace<ClearDepthStencilCommand>(CommandType::eClearDepthStencil) = {
+        .depth_stencil = depth_stencil,
+        .depth = depth,
+        .stencil = stencil,
+    };
+}
+
+void Swift::CommandRecorder::TransitionImage(ITexture* image, const ResourceState new_state)
+{
+    Emplace<TransitionImageCommand>(CommandType::eTransitionImage) = {.texture = image, .state = new_state};
+}
+
+void Swift::CommandRecorder::TransitionBuffer(IBuffer* buffer, const ResourceState new_state)
+{
+    Emplace<TransitionBufferCommand>(CommandType::eTransitionBuffer) = {.buffer = buffer, .state = new_state};
+}
+
+void Swift::CommandRecorder::TransitionResources(const std::span<const TextureTransition> textures,
+                                                 const std::span<const BufferTransition> buffers)
+{
+    auto& cmd = Emplace<TransitionResourcesCommand>(CommandType::eTransitionResources,
+                                                    textures.size_bytes() + buffers.size_bytes());
+    cmd = {
+        .texture_count = static_cast<uint32_t>(textures.size()),
+        .buffer_count = static_cast<uint32_t>(buffers.size()),
+    };
+    std::byte* data = reinterpret_cast<std::byte*>(&cmd) + sizeof(cmd);
+    std::memcpy(data, textures.data(), textures.size_bytes());
+    std::memcpy(data + textures.size_bytes(), buffers.data(), buffers.size_bytes());
+}
+
+void Swift::CommandRecorder::UAVBarrier(IBuffer* buffer)
+{
+    Emplace<UAVBarrierBufferCommand>(CommandType::eUAVBarrierBuffer).buffer = buffer;
+}
+
+void Swift::CommandRecorder::UAVBarrier(ITexture* texture)
+{
+    Emplace<UAVBarrierTextureCommand>(CommandType::eUAVBarrierTexture).texture = texture;
+}
+
+void Swift::CommandRecorder::InvalidateState() { Emplace<EmptyCommand>(CommandType::eInvalidateState); }
+
+std::vector<std::byte> Swift::CommandRecorder::Serialize() const
+{
+    std::vector<std::byte> data;
+    data.reserve(m_arena.GetUsedSize());
+    for (const auto& block : m_arena.GetBlocks())
+    {
+        data.insert(data.end(), block.begin(), block.end());
+    }
+    return data;
+}
+
+bool Swift::ReplayCommands(const std::span<const std::span<const std::byte>> stream, ICommand* command)
+{
+    return std::ranges::all_of(stream,
+                               [command](const std::span<const std::byte> block) { return ReplayBlock(block, command); });
+}
+
+bool Swift::ReplayCommands(const std::span<const std::byte> data, ICommand* command) { return ReplayBlock(data, command); }
+
+void Swift::CommandValidator::Begin()
+{
+    m_shader = nullptr;
+    m_in_render = false;
+    m_command_index = 0;
+    m_errors.clear();
+}
+
+void Swift::CommandValidator::End()
+{
+    if (m_in_render)
+    {
+        Error("BeginRender without EndRender");
+    }
+}
+
+void Swift::CommandValidator::SetViewport(const Viewport& viewport)
+{
+    if (viewport.dimensions.x <= 0.f || viewport.dimensions.y <= 0.f)
+    {
+        Error(std::format("Empty viewport {}x{}", viewport.dimensions.x, viewport.dimensions.y));
+    }
+    if (viewport.depth_range.x < 0.f || viewport.depth_range.y > 1.f || viewport.depth_range.x > viewport.depth_range.y)
+    {
+        Error(std::format("Depth range [{}, {}] outside [0, 1]", viewport.depth_range.x, viewport.depth_range.y));
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::SetScissor(const Scissor& scissor)
+{
+    if (scissor.dimensions.x <= scissor.offset.x || scissor.dimensions.y <= scissor.offset.y)
+    {
+        Error("Empty scissor, dimensions hold the bottom right corner");
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::PushConstants(const void* data, const uint32_t size, const uint32_t offset)
+{
+    if (!m_shader)
+    {
+        Error("PushConstants before BindShader");
+    }
+    if (!data || size % sizeof(uint32_t) != 0 || size + offset * sizeof(uint32_t) > 32 * sizeof(uint32_t))
+    {
+        Error(std::format("Push constants of {} bytes at offset {} do not fit the 32 root constants", size, offset));
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::BindShader(IShader* shader)
+{
+    if (!shader)
+    {
+        Error("BindShader without a shader");
+    }
+    m_shader = shader;
+    m_command_index++;
+}
+
+void Swift::CommandValidator::DispatchMesh(const uint32_t group_x, const uint32_t group_y, const uint32_t group_z)
+{
+    RequireShader(ShaderType::eGraphics, "DispatchMesh");
+    if (!m_in_render)
+    {
+        Error("DispatchMesh outside BeginRender");
+    }
+    if (group_x > 65535 || group_y > 65535 || group_z > 65535 || uint64_t{group_x} * group_y * group_z > 1u << 22)
+    {
+        Error(std::format("DispatchMesh of {}x{}x{} groups exceeds the limits", group_x, group_y, group_z));
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::ExecuteIndirect(ICommandSignature* signature,
+                                              const uint32_t max_commands,
+                                              IBuffer* argument_buffer,
+                                              const uint32_t argument_offset,
+                                              IBuffer* count_buffer,
+                                              const uint32_t count_offset)
+{
+    if (!m_shader)
+    {
+        Error("ExecuteIndirect before BindShader");
+    }
+    if (!signature || !argument_buffer)
+    {
+        Error("ExecuteIndirect without a signature or argument buffer");
+    }
+    if (argument_offset % 4 != 0 || (count_buffer && count_offset % 4 != 0))
+    {
+        Error("ExecuteIndirect offsets have to be 4 byte aligned");
+    }
+    if (max_commands == 0)
+    {
+        Error("ExecuteIndirect with max_commands 0");
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::DispatchCompute(const uint32_t group_x, const uint32_t group_y, const uint32_t group_z)
+{
+    RequireShader(ShaderType::eCompute, "DispatchCompute");
+    RequireOutsideRender("DispatchCompute");
+    if (group_x > 65535 || group_y > 65535 || group_z > 65535)
+    {
+        Error(std::format("DispatchCompute of {}x{}x{} groups exceeds the limits", group_x, group_y, group_z));
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::CopyBufferToTexture(IBuffer* buffer,
+                                                  ITexture* texture,
+                                                  const uint16_t mip_levels,
+                                                  const uint16_t array_size)
+{
+    RequireOutsideRender("CopyBufferToTexture");
+    if (!buffer || !texture || mip_levels == 0 || array_size == 0)
+    {
+        Error("CopyBufferToTexture without resources or subresources");
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::CopyTextureToTexture(ITexture* src, ITexture* dst, const TextureCopyRegion& copy_region)
+{
+    RequireOutsideRender("CopyTextureToTexture");
+    if (!src || !dst)
+    {
+        Error("CopyTextureToTexture without resources");
+    }
+    if (copy_region.size.x == 0 || copy_region.size.y == 0 || copy_region.size.z == 0)
+    {
+        Error("CopyTextureToTexture with an empty region");
+    }
+    if (src == dst && copy_region.src_mip == copy_region.dst_mip)
+    {
+        Error(std::format("CopyTextureToTexture within mip {}", copy_region.src_mip));
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::CopyBufferToBuffer(IBuffer* src, IBuffer* dst, const BufferCopyRegion& region)
+{
+    RequireOutsideRender("CopyBufferToBuffer");
+    if (!src || !dst)
+    {
+        Error("CopyBufferToBuffer without resources");
+    }
+    const bool overlaps =
+        region.src_offset < region.dst_offset + region.size && region.dst_offset < region.src_offset + region.size;
+    if (src == dst && overlaps)
+    {
+        Error("CopyBufferToBuffer with overlapping ranges");
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::BindConstantBuffer(IBuffer* buffer, const uint32_t slot, const uint32_t offset)
+{
+    // Root parameters 1 to 3 hold the constant buffers, constant buffer views need 256 byte alignment.
+    if (!buffer)
+    {
+        Error("BindConstantBuffer without a buffer");
+    }
+    if (slot < 1 || slot > 3)
+    {
+        Error(std::format("Root parameter {} is not a constant buffer slot", slot));
+    }
+    if (offset % 256 != 0)
+    {
+        Error(std::format("Constant buffer offset {} is not 256 byte aligned", offset));
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::BeginRender(const std::span<const RenderAttachmentInfo> color_attachments,
+                                          const std::optional<const DepthAttachmentInfo>& depth_attachment)
+{
+    if (m_in_render)
+    {
+        Error("BeginRender inside BeginRender");
+    }
+    if (color_attachments.size() > 8)
+    {
+        Error(std::format("{} render targets, at most 8 can be bound", color_attachments.size()));
+    }
+    if (std::ranges::any_of(color_attachments, [](const RenderAttachmentInfo& info) { return !info.render_target; }) ||
+        (depth_attachment.has_value() && !depth_attachment->depth_stencil))
+    {
+        Error("BeginRender with an attachment without a view");
+    }
+    m_in_render = true;
+    m_command_index++;
+}
+
+void Swift::CommandValidator::EndRender()
+{
+    if (!m_in_render)
+    {
+        Error("EndRender without BeginRender");
+    }
+    m_in_render = false;
+    m_command_index++;
+}
+
+void Swift::CommandValidator::ClearRenderTarget(ITextureView* render_target, const Float4& /*color*/)
+{
+    if (!render_target)
+    {
+        Error("ClearRenderTarget without a view");
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::ClearDepthStencil(ITextureView* depth_stencil, const float depth, const uint8_t /*stencil*/)
+{
+    if (!depth_stencil)
+    {
+        Error("ClearDepthStencil without a view");
+    }
+    if (depth < 0.f || depth > 1.f)
+    {
+        Error(std::format("Clear depth {} outside [0, 1]", depth));
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::TransitionImage(ITexture* image, const ResourceState new_state)
+{
+    RequireOutsideRender("TransitionImage");
+    if (!image)
+    {
+        Error("TransitionImage without a texture");
+    }
+    if (IsBufferState(new_state))
+    {
+        Error(std::format("TransitionImage to buffer state {}", static_cast<int>(new_state)));
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::TransitionBuffer(IBuffer* buffer, const ResourceState new_state)
+{
+    RequireOutsideRender("TransitionBuffer");
+    if (!buffer)
+    {
+        Error("TransitionBuffer without a buffer");
+    }
+    if (IsTextureState(new_state))
+    {
+        Error(std::format("TransitionBuffer to texture state {}", static_cast<int>(new_state)));
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::TransitionResources(const std::span<const TextureTransition> textures,
+                                                  const std::span<const BufferTransition> buffers)
+{
+    RequireOutsideRender("TransitionResources");
+    if (std::ranges::any_of(textures, [](const TextureTransition& transition) { return !transition.texture; }) ||
+        std::ranges::any_of(buffers, [](const BufferTransition& transition) { return !transition.buffer; }))
+    {
+        Error("TransitionResources without a resource");
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::UAVBarrier(IBuffer* buffer)
+{
+    if (!buffer)
+    {
+        Error("UAVBarrier without a buffer");
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::UAVBarrier(ITexture* texture)
+{
+    if (!texture)
+    {
+        Error("UAVBarrier without a texture");
+    }
+    m_command_index++;
+}
+
+void Swift::CommandValidator::InvalidateState() { m_command_index++; }
+
+void Swift::CommandValidator::Error(std::string message)
+{
+    m_errors.emplace_back(CommandValidationError{.command_index = m_command_index, .message = std::move(message)});
+}
+
+void Swift::CommandValidator::RequireShader(const ShaderType type, const char* command)
+{
+    if (!m_shader)
+    {
+        Error(std::format("{} before BindShader", command));
+    }
+    else if (m_shader->GetShaderType() != type)
+    {
+        Error(std::format("{} with a {} shader bound",
+                          command,
+                          m_shader->GetShaderType() == ShaderType::eCompute ? "compute" : "graphics"));
+    }
+}
+
+void Swift::CommandValidator::RequireOutsideRender(const char* command)
+{
+    if (m_in_render)
+    {
+        Error(std::format("{} inside BeginRender", command));
+    }
+}
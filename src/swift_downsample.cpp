@@ -0,0 +1,74 @@
+#include "swift_downsample.hpp"
+#include "algorithm"
+
+namespace
+{
+    Swift::Float4 Reduce(const Swift::Float4& a,
+                         const Swift::Float4& b,
+                         const Swift::Float4& c,
+                         const Swift::Float4& d,
+                         const Swift::ReductionType reduction)
+    {
+        switch (reduction)
+        {
+            case Swift::ReductionType::eMinimum:
+                return {
+                    std::min(std::min(a.x, b.x), std::min(c.x, d.x)),
+                    std::min(std::min(a.y, b.y), std::min(c.y, d.y)),
+                    std::min(std::min(a.z, b.z), std::min(c.z, d.z)),
+                    std::min(std::min(a.w, b.w), std::min(c.w, d.w)),
+                };
+            case Swift::ReductionType::eMaximum:
+                return {
+                    std::max(std::max(a.x, b.x), std::max(c.x, d.x)),
+                    std::max(std::max(a.y, b.y), std::max(c.y, d.y)),
+                    std::max(std::max(a.z, b.z), std::max(c.z, d.z)),
+                    std::max(std::max(a.w, b.w), std::max(c.w, d.w)),
+                };
+            case Swift::ReductionType::eStandard:
+            case Swift::ReductionType::eComparison:
+                break;
+        }
+        return {
+            (a.x + b.x + c.x + d.x) * 0.25f,
+            (a.y + b.y + c.y + d.y) * 0.25f,
+            (a.z + b.z + c.z + d.z) * 0.25f,
+            (a.w + b.w + c.w + d.w) * 0.25f,
+        };
+    }
+}  // namespace
+
+std::vector<Swift::MipLevel> Swift::DownsampleReference(const MipLevel& base,
+                                                        const uint32_t mip_count,
+                                                        const ReductionType reduction)
+{
+    std::vector<MipLevel> mips;
+    mips.reserve(mip_count);
+
+    const MipLevel* src = &base;
+    for (uint32_t mip = 1; mip <= mip_count; ++mip)
+    {
+        const auto [width, height] = CalculateMipSize(base.width, base.height, mip);
+        MipLevel dst{
+            .width = width,
+            .height = height,
+            .texels = std::vector<Float4>(static_cast<size_t>(width) * height),
+        };
+
+        const auto load = [src](const uint32_t x, const uint32_t y) -> const Float4&
+        { return src->texels[std::min(y, src->height - 1) * src->width + std::min(x, src->width - 1)]; };
+
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                dst.texels[y * width + x] =
+                    Reduce(load(x * 2, y * 2), load(x * 2 + 1, y * 2), load(x * 2, y * 2 + 1), load(x * 2 + 1, y * 2 + 1), reduction);
+            }
+        }
+
+        mips.emplace_back(std::move(dst));
+        src = &mips.back();
+    }
+    return mips;
+}
@@ -0,0 +1,184 @@
+#include "swift_fence.hpp"
+#include "algorithm"
+#ifdef SWIFT_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include "windows.h"
+#endif
+
+namespace
+{
+    // Registrations a fence cannot cancel may still set the event during a later wait on the same thread, every wait
+    // loops on the fence values so such a wake up only costs one more check.
+    Swift::FenceEvent& GetThreadEvent()
+    {
+        thread_local Swift::FenceEvent event;
+        return event;
+    }
+
+    // Registers the event with every fence that is not done yet, then sleeps on it until done returns true or the
+    // deadline passes. done is checked once more after a timeout, so a fence completing right at the deadline counts.
+    template<typename DoneFunc>
+    bool WaitForFences(const std::span<const Swift::FenceWait> waits,
+                       const std::chrono::milliseconds timeout,
+                       DoneFunc&& done)
+    {
+        if (done())
+        {
+            return true;
+        }
+
+        auto& event = GetThreadEvent();
+        for (const auto& [fence, value] : waits)
+        {
+            if (!fence->IsComplete(value))
+            {
+                fence->SetEventOnCompletion(value, event);
+            }
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        bool result = done();
+        for (; !result; result = done())
+        {
+            auto remaining = Swift::k_infinite_timeout;
+            if (timeout != Swift::k_infinite_timeout)
+            {
+                const auto elapsed =
+                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+                if (elapsed >= timeout)
+                {
+                    break;
+                }
+                remaining = timeout - elapsed;
+            }
+            if (!event.Wait(remaining))
+            {
+                result = done();
+                break;
+            }
+        }
+
+        for (const auto& [fence, value] : waits)
+        {
+            fence->RemoveEvent(event);
+        }
+        return result;
+    }
+}  // namespace
+
+Swift::FenceEvent::FenceEvent()
+{
+#ifdef SWIFT_WINDOWS
+    m_handle = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+#endif
+}
+
+Swift::FenceEvent::~FenceEvent()
+{
+#ifdef SWIFT_WINDOWS
+    CloseHandle(m_handle);
+#endif
+}
+
+void Swift::FenceEvent::Set()
+{
+#ifdef SWIFT_WINDOWS
+    SetEvent(m_handle);
+#else
+    {
+        std::lock_guard lock(m_mutex);
+        m_signaled = true;
+    }
+    m_condition.notify_one();
+#endif
+}
+
+bool Swift::FenceEvent::Wait(const std::chrono::milliseconds timeout)
+{
+#ifdef SWIFT_WINDOWS
+    const DWORD milliseconds =
+        timeout == k_infinite_timeout ? INFINITE : static_cast<DWORD>(std::min<int64_t>(timeout.count(), INFINITE - 1));
+    return WaitForSingleObject(m_handle, milliseconds) == WAIT_OBJECT_0;
+#else
+    std::unique_lock lock(m_mutex);
+    if (timeout == k_infinite_timeout)
+    {
+        m_condition.wait(lock, [this] { return m_signaled; });
+    }
+    else if (!m_condition.wait_for(lock, timeout, [this] { return m_signaled; }))
+    {
+        return false;
+    }
+    m_signaled = false;
+    return true;
+#endif
+}
+
+bool Swift::IFence::Wait(const uint64_t value, const std::chrono::milliseconds timeout)
+{
+    const FenceWait wait{.fence = this, .value = value};
+    return WaitForAllFences(std::span(&wait, 1), timeout);
+}
+
+bool Swift::WaitForAllFences(const std::span<const FenceWait> waits, const std::chrono::milliseconds timeout)
+{
+    const auto done = [waits]
+    { return std::ranges::all_of(waits, [](const FenceWait& wait) { return wait.fence->IsComplete(wait.value); }); };
+    return WaitForFences(waits, timeout, done);
+}
+
+std::optional<size_t> Swift::WaitForAnyFence(const std::span<const FenceWait> waits, const std::chrono::milliseconds timeout)
+{
+    std::optional<size_t> completed;
+    const auto done = [waits, &completed]
+    {
+        for (size_t i = 0; i < waits.size(); ++i)
+        {
+            if (waits[i].fence->IsComplete(waits[i].value))
+            {
+                completed = i;
+                return true;
+            }
+        }
+        return false;
+    };
+    if (!WaitForFences(waits, timeout, done))
+    {
+        return std::nullopt;
+    }
+    return completed;
+}
+
+Swift::CpuFence::CpuFence(const uint64_t initial_value) : m_value(initial_value) {}
+
+void Swift::CpuFence::Signal(const uint64_t value)
+{
+    std::lock_guard lock(m_mutex);
+    const uint64_t completed = std::max(m_value.load(std::memory_order_relaxed), value);
+    m_value.store(completed, std::memory_order_release);
+    std::erase_if(m_waiters,
+                  [completed](const Waiter& waiter)
+                  {
+                      if (waiter.value > completed) return false;
+                      waiter.event->Set();
+                      return true;
+                  });
+}
+
+void Swift::CpuFence::SetEventOnCompletion(const uint64_t value, FenceEvent& event)
+{
+    std::lock_guard lock(m_mutex);
+    if (m_value.load(std::memory_order_relaxed) >= value)
+    {
+        event.Set();
+        return;
+    }
+    m_waiters.push_back({.value = value, .event = &event});
+}
+
+void Swift::CpuFence::RemoveEvent(FenceEvent& event)
+{
+    std::lock_guard lock(m_mutex);
+    std::erase_if(m_waiters, [&event](const Waiter& waiter) { return waiter.event == &event; });
+}
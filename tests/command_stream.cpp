@@ -0,0 +1,340 @@
+#include "swift_command_stream.hpp"
+#include "swift_shader.hpp"
+#include "algorithm"
+#include "cstdint"
+#include "cstdio"
+#include "format"
+#include "string"
+#include "utility"
+#include "vector"
+
+namespace
+{
+    class TestShader final : public Swift::IShader
+    {
+    public:
+        explicit TestShader(const Swift::ShaderType shader_type) : IShader(shader_type) {}
+        void* GetPipeline() const override { return nullptr; }
+    };
+
+    // Writes every call it gets as a line, two replays of the same stream have to produce the same lines.
+    class CallLog final : public Swift::ICommand
+    {
+    public:
+        void* GetCommandList() override { return nullptr; }
+        void* GetCommandAllocator() override { return nullptr; }
+        void Begin() override { Log("Begin"); }
+        void End() override { Log("End"); }
+        void SetViewport(const Swift::Viewport& viewport) override
+        {
+            Log(std::format("SetViewport {} {}", viewport.dimensions.x, viewport.dimensions.y));
+        }
+        void SetScissor(const Swift::Scissor& scissor) override
+        {
+            Log(std::format("SetScissor {} {}", scissor.dimensions.x, scissor.dimensions.y));
+        }
+        void PushConstants(const void* data, const uint32_t size, const uint32_t offset) override
+        {
+            std::string line = std::format("PushConstants {} {}", size, offset);
+            for (uint32_t i = 0; i < size; ++i)
+            {
+                line += std::format(" {}", static_cast<const uint8_t*>(data)[i]);
+            }
+            Log(std::move(line));
+        }
+        void BindShader(Swift::IShader* shader) override { Log(std::format("BindShader {}", Id(shader))); }
+        void DispatchMesh(const uint32_t group_x, const uint32_t group_y, const uint32_t group_z) override
+        {
+            Log(std::format("DispatchMesh {} {} {}", group_x, group_y, group_z));
+        }
+        void ExecuteIndirect(Swift::ICommandSignature* signature,
+                             const uint32_t max_commands,
+                             Swift::IBuffer* argument_buffer,
+                             const uint32_t argument_offset,
+                             Swift::IBuffer* count_buffer,
+                             const uint32_t count_offset) override
+        {
+            Log(std::format("ExecuteIndirect {} {} {} {} {} {}",
+                            Id(signature),
+                            max_commands,
+                            Id(argument_buffer),
+                            argument_offset,
+                            Id(count_buffer),
+                            count_offset));
+        }
+        void DispatchCompute(const uint32_t group_x, const uint32_t group_y, const uint32_t group_z) override
+        {
+            Log(std::format("DispatchCompute {} {} {}", group_x, group_y, group_z));
+        }
+        void CopyBufferToTexture(Swift::IBuffer* buffer,
+                                 Swift::ITexture* texture,
+                                 const uint16_t mip_levels,
+                                 const uint16_t array_size) override
+        {
+            Log(std::format("CopyBufferToTexture {} {} {} {}", Id(buffer), Id(texture), mip_levels, array_size));
+        }
+        void CopyTextureToTexture(Swift::ITexture* src,
+                                  Swift::ITexture* dst,
+                                  const Swift::TextureCopyRegion& copy_region) override
+        {
+            Log(std::format("CopyTextureToTexture {} {} {} {} {}",
+                            Id(src),
+                            Id(dst),
+                            copy_region.src_mip,
+                            copy_region.dst_mip,
+                            copy_region.size.x));
+        }
+        void CopyBufferToBuffer(Swift::IBuffer* src, Swift::IBuffer* dst, const Swift::BufferCopyRegion& region) override
+        {
+            Log(std::format("CopyBufferToBuffer {} {} {} {} {}",
+                            Id(src),
+                            Id(dst),
+                            region.src_offset,
+                            region.dst_offset,
+                            region.size));
+        }
+        void BindConstantBuffer(Swift::IBuffer* buffer, const uint32_t slot, const uint32_t offset) override
+        {
+            Log(std::format("BindConstantBuffer {} {} {}", Id(buffer), slot, offset));
+        }
+        void BeginRender(const std::span<const Swift::RenderAttachmentInfo> color_attachments,
+                         const std::optional<const Swift::DepthAttachmentInfo>& depth_attachment) override
+        {
+            std::string line = "BeginRender";
+            for (const auto& attachment : color_attachments)
+            {
+                line += std::format(" {} {}", Id(attachment.render_target), attachment.clear_color.y);
+            }
+            if (depth_attachment.has_value())
+            {
+                line += std::format(" depth {}", Id(depth_attachment->depth_stencil));
+            }
+            Log(std::move(line));
+        }
+        using ICommand::BeginRender;
+        void EndRender() override { Log("EndRender"); }
+        void ClearRenderTarget(Swift::ITextureView* render_target, const Swift::Float4& color) override
+        {
+            Log(std::format("ClearRenderTarget {} {}", Id(render_target), color.x));
+        }
+        void ClearDepthStencil(Swift::ITextureView* depth_stencil, const float depth, const uint8_t stencil) override
+        {
+            Log(std::format("ClearDepthStencil {} {} {}", Id(depth_stencil), depth, stencil));
+        }
+        void TransitionImage(Swift::ITexture* image, const Swift::ResourceState new_state) override
+        {
+            Log(std::format("TransitionImage {} {}", Id(image), static_cast<int>(new_state)));
+        }
+        void TransitionBuffer(Swift::IBuffer* buffer, const Swift::ResourceState new_state) override
+        {
+            Log(std::format("TransitionBuffer {} {}", Id(buffer), static_cast<int>(new_state)));
+        }
+        void TransitionResources(const std::span<const Swift::TextureTransition> textures,
+                                 const std::span<const Swift::BufferTransition> buffers) override
+        {
+            std::string line = "TransitionResources";
+            for (const auto& [texture, state] : textures)
+            {
+                line += std::format(" {} {}", Id(texture), static_cast<int>(state));
+            }
+            for (const auto& [buffer, state] : buffers)
+            {
+                line += std::format(" {} {}", Id(buffer), static_cast<int>(state));
+            }
+            Log(std::move(line));
+        }
+        void UAVBarrier(Swift::IBuffer* buffer) override { Log(std::format("UAVBarrier {}", Id(buffer))); }
+        void UAVBarrier(Swift::ITexture* texture) override { Log(std::format("UAVBarrier {}", Id(texture))); }
+        void InvalidateState() override { Log("InvalidateState"); }
+        const Swift::CommandStatistics& GetStatistics() const override { return m_statistics; }
+
+        [[nodiscard]] const std::vector<std::string>& GetCalls() const { return m_calls; }
+
+    private:
+        static uintptr_t Id(const void* pointer) { return reinterpret_cast<uintptr_t>(pointer); }
+        void Log(std::string line) { m_calls.emplace_back(std::move(line)); }
+
+        std::vector<std::string> m_calls;
+        Swift::CommandStatistics m_statistics{};
+    };
+
+    // The recorder and the validator only store and compare resource pointers, so none of them is a real resource.
+    template<typename T>
+    T* FakeResource(const uintptr_t id)
+    {
+        return reinterpret_cast<T*>(id * 16);
+    }
+
+    int g_failures = 0;
+
+    void Check(const bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            printf(std::format("FAILED: {}\n", what).c_str());
+            g_failures++;
+        }
+    }
+
+    // A frame touching every kind of packet, long enough to span several arena blocks.
+    void RecordFrame(Swift::ICommand* command, Swift::IShader* graphics_shader, Swift::IShader* compute_shader)
+    {
+        auto* render_target = FakeResource<Swift::ITextureView>(1);
+        auto* depth_stencil = FakeResource<Swift::ITextureView>(2);
+        auto* texture = FakeResource<Swift::ITexture>(3);
+        auto* other_texture = FakeResource<Swift::ITexture>(4);
+        auto* buffer = FakeResource<Swift::IBuffer>(5);
+        auto* other_buffer = FakeResource<Swift::IBuffer>(6);
+        auto* signature = FakeResource<Swift::ICommandSignature>(7);
+
+        command->Begin();
+        command->TransitionImage(texture, Swift::ResourceState::eRenderTarget);
+        command->ClearRenderTarget(render_target, Swift::Float4{0.25f, 0.5f, 0.75f, 1.f});
+        command->ClearDepthStencil(depth_stencil, 1.f, 0);
+        for (uint32_t i = 0; i < 64; ++i)
+        {
+            const uint32_t constants[3] = {i, i * 3, i * 7};
+            command->BindShader(graphics_shader);
+            command->SetViewport(Swift::Viewport{.dimensions = {static_cast<float>(i + 1), 720.f}});
+            command->SetScissor(Swift::Scissor{.dimensions = {i + 1, 720}, .offset = {0, 0}});
+            command->PushConstants(constants, sizeof(constants), 4);
+            command->BeginRender(Swift::RenderAttachmentInfo{.render_target = render_target,
+                                                              .clear_color = {0.f, static_cast<float>(i), 0.f, 1.f}},
+                                 Swift::DepthAttachmentInfo{
+                                     .depth_stencil = depth_stencil, .clear_depth = 1.f, .clear_stencil = 0});
+            command->DispatchMesh(i + 1, 1, 1);
+            command->ExecuteIndirect(signature, i + 1, buffer, i * 16, other_buffer, 0);
+            command->EndRender();
+        }
+        command->BindShader(compute_shader);
+        command->BindConstantBuffer(buffer, 1, 256);
+        command->DispatchCompute(8, 4, 1);
+        command->UAVBarrier(buffer);
+        command->UAVBarrier(texture);
+        command->CopyBufferToBuffer(buffer,
+                                    other_buffer,
+                                    Swift::BufferCopyRegion{.src_offset = 0, .dst_offset = 64, .size = 32});
+        command->CopyBufferToTexture(buffer, texture, 2, 1);
+        command->CopyTextureToTexture(texture,
+                                      other_texture,
+                                      Swift::TextureCopyRegion{.src_mip = 0,
+                                                               .dst_mip = 1,
+                                                               .src_offset = {0, 0, 0},
+                                                               .dst_offset = {0, 0, 0},
+                                                               .size = {4, 4, 1}});
+        command->TransitionBuffer(buffer, Swift::ResourceState::eIndirectArgument);
+        command->InvalidateState();
+        const Swift::TextureTransition textures[] = {{texture, Swift::ResourceState::eShaderResource},
+                                                     {other_texture, Swift::ResourceState::eCopyDest}};
+        const Swift::BufferTransition buffers[] = {{buffer, Swift::ResourceState::eCommon}};
+        command->TransitionResources(textures, buffers);
+        command->TransitionImage(texture, Swift::ResourceState::ePresent);
+        command->End();
+    }
+
+    void TestReplay()
+    {
+        TestShader graphics_shader(Swift::ShaderType::eGraphics);
+        TestShader compute_shader(Swift::ShaderType::eCompute);
+
+        CallLog direct;
+        RecordFrame(&direct, &graphics_shader, &compute_shader);
+
+        // Small blocks so the stream spans many of them, recorded twice to check Begin drops the first recording.
+        Swift::CommandRecorder recorder(512);
+        RecordFrame(&recorder, &graphics_shader, &compute_shader);
+        RecordFrame(&recorder, &graphics_shader, &compute_shader);
+        Check(!recorder.IsRecording(), "recorder stops recording at End");
+        Check(recorder.GetStream().size() > 1, "stream spans several blocks");
+
+        // Begin and End are not part of the stream, the command replayed into is opened and closed by the caller.
+        const auto& direct_calls = direct.GetCalls();
+        const std::vector expected(direct_calls.begin() + 1, direct_calls.end() - 1);
+        Check(recorder.GetCommandCount() == expected.size(), "one packet per recorded command");
+
+        CallLog replayed;
+        Check(Swift::ReplayCommands(recorder.GetStream(), &replayed), "replay the recorded stream");
+        Check(replayed.GetCalls() == expected, "replay matches the recorded calls");
+
+        const std::vector<std::byte> serialized = recorder.Serialize();
+        CallLog deserialized;
+        Check(Swift::ReplayCommands(serialized, &deserialized), "replay the serialized stream");
+        Check(deserialized.GetCalls() == expected, "serialized replay matches the recorded calls");
+
+        const std::span truncated(serialized.data(), serialized.size() - 1);
+        CallLog partial;
+        Check(!Swift::ReplayCommands(truncated, &partial), "truncated stream is rejected");
+        Check(partial.GetCalls().size() + 1 == expected.size(), "commands before the truncated packet are replayed");
+
+        Swift::CommandValidator validator;
+        validator.Begin();
+        Check(Swift::ReplayCommands(serialized, &validator), "replay into the validator");
+        validator.End();
+        for (const auto& [command_index, message] : validator.GetErrors())
+        {
+            printf(std::format("  command {}: {}\n", command_index, message).c_str());
+        }
+        Check(validator.IsValid(), "recorded frame validates");
+    }
+
+    void TestValidation()
+    {
+        TestShader graphics_shader(Swift::ShaderType::eGraphics);
+        auto* render_target = FakeResource<Swift::ITextureView>(1);
+        auto* texture = FakeResource<Swift::ITexture>(3);
+        auto* buffer = FakeResource<Swift::IBuffer>(5);
+
+        Swift::CommandRecorder recorder;
+        recorder.Begin();
+        recorder.DispatchCompute(1, 1, 1);
+        recorder.BindShader(&graphics_shader);
+        recorder.BeginRender(Swift::RenderAttachmentInfo{.render_target = render_target, .clear_color = {0.f, 0.f, 0.f, 1.f}},
+                             std::nullopt);
+        recorder.DispatchCompute(1, 1, 1);
+        recorder.CopyBufferToBuffer(buffer, buffer, Swift::BufferCopyRegion{.src_offset = 0, .dst_offset = 16, .size = 32});
+        recorder.EndRender();
+        recorder.BindConstantBuffer(buffer, 4, 12);
+        recorder.ClearDepthStencil(render_target, 2.f, 0);
+        recorder.CopyTextureToTexture(
+            texture,
+            texture,
+            Swift::TextureCopyRegion{
+                .src_mip = 0, .dst_mip = 0, .src_offset = {0, 0, 0}, .dst_offset = {0, 0, 0}, .size = {1, 1, 1}});
+        recorder.TransitionImage(texture, Swift::ResourceState::eIndirectArgument);
+        recorder.TransitionBuffer(buffer, Swift::ResourceState::eRenderTarget);
+        recorder.EndRender();
+        recorder.End();
+
+        Swift::CommandValidator validator;
+        validator.Begin();
+        Check(Swift::ReplayCommands(recorder.GetStream(), &validator), "replay the invalid stream");
+        validator.End();
+
+        // Command index and error count of every broken command above.
+        constexpr std::pair<uint32_t, size_t> k_expected[] = {
+            {0, 1}, {3, 2}, {4, 2}, {6, 2}, {7, 1}, {8, 1}, {9, 1}, {10, 1}, {11, 1},
+        };
+        for (const auto& [command_index, count] : k_expected)
+        {
+            const auto errors = std::ranges::count(validator.GetErrors(),
+                                                   command_index,
+                                                   &Swift::CommandValidationError::command_index);
+            Check(static_cast<size_t>(errors) == count,
+                  std::format("{} errors at command {}", count, command_index).c_str());
+        }
+        Check(validator.GetErrors().size() == 12, "no other errors");
+    }
+}  // namespace
+
+int main()
+{
+    TestReplay();
+    TestValidation();
+    if (g_failures > 0)
+    {
+        printf(std::format("{} checks failed\n", g_failures).c_str());
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "swift_downsample.hpp"
+#include "algorithm"
+#include "cstdint"
+#include "cstdio"
+#include "format"
+#include "vector"
+
+namespace
+{
+    int g_failures = 0;
+
+    void Check(const bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            printf(std::format("FAILED: {}\n", what).c_str());
+            g_failures++;
+        }
+    }
+
+    // Texel i of the base holds i in x, -i in y, 2i in z and 1 in w, so every channel is reduced on its own.
+    Swift::MipLevel CreateBase(const uint32_t width, const uint32_t height)
+    {
+        Swift::MipLevel base{.width = width, .height = height, .texels = {}};
+        for (uint32_t i = 0; i < width * height; ++i)
+        {
+            const auto value = static_cast<float>(i);
+            base.texels.push_back(Swift::Float4{value, -value, value * 2.f, 1.f});
+        }
+        return base;
+    }
+
+    bool Equals(const Swift::Float4& texel, const float value)
+    {
+        return texel.x == value && texel.y == -value && texel.z == value * 2.f && texel.w == 1.f;
+    }
+
+    bool HasSizes(const std::vector<Swift::MipLevel>& mips, const std::vector<Swift::UInt2>& sizes)
+    {
+        if (mips.size() != sizes.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < mips.size(); ++i)
+        {
+            if (mips[i].width != sizes[i].x || mips[i].height != sizes[i].y ||
+                mips[i].texels.size() != static_cast<size_t>(sizes[i].x) * sizes[i].y)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 5x3 goes to 2x1 and 1x1. Texel (1, 0) of mip 1 reduces texels 2, 3, 7 and 8, the last column and row are past
+    // what the 2x2 footprints reach.
+    void TestOddSize()
+    {
+        const auto base = CreateBase(5, 3);
+
+        const auto average = Swift::DownsampleReference(base, 2, Swift::ReductionType::eStandard);
+        Check(HasSizes(average, {{2, 1}, {1, 1}}), "5x3 mip sizes");
+        Check(Equals(average[0].texels[0], 3.f) && Equals(average[0].texels[1], 5.f), "5x3 average mip 1");
+        // The single row of mip 1 is clamped, so it counts twice.
+        Check(Equals(average[1].texels[0], 4.f), "5x3 average mip 2");
+
+        const auto minimum = Swift::DownsampleReference(base, 2, Swift::ReductionType::eMinimum);
+        Check(minimum[0].texels[0].x == 0.f && minimum[0].texels[1].x == 2.f, "5x3 minimum mip 1");
+        Check(minimum[0].texels[1].y == -8.f, "5x3 minimum of a negated channel");
+        Check(minimum[1].texels[0].x == 0.f, "5x3 minimum mip 2");
+
+        const auto maximum = Swift::DownsampleReference(base, 2, Swift::ReductionType::eMaximum);
+        Check(maximum[0].texels[0].x == 6.f && maximum[0].texels[1].x == 8.f, "5x3 maximum mip 1");
+        Check(maximum[0].texels[1].y == -2.f && maximum[0].texels[1].z == 16.f, "5x3 maximum of the other channels");
+        Check(maximum[1].texels[0].x == 8.f, "5x3 maximum mip 2");
+    }
+
+    // A level one texel wide or tall reads its only column or row twice in every 2x2 footprint.
+    void TestEdgeClamp()
+    {
+        const auto column = CreateBase(1, 3);
+        const auto average = Swift::DownsampleReference(column, 1, Swift::ReductionType::eStandard);
+        Check(HasSizes(average, {{1, 1}}), "1x3 mip size");
+        Check(Equals(average[0].texels[0], 0.5f), "1x3 average clamps x");
+
+        const auto maximum = Swift::DownsampleReference(column, 1, Swift::ReductionType::eMaximum);
+        Check(maximum[0].texels[0].x == 1.f, "1x3 maximum leaves out the third row");
+
+        const auto row = CreateBase(3, 1);
+        const auto minimum = Swift::DownsampleReference(row, 1, Swift::ReductionType::eMinimum);
+        Check(HasSizes(minimum, {{1, 1}}), "3x1 mip size");
+        Check(minimum[0].texels[0].x == 0.f && minimum[0].texels[0].y == -1.f, "3x1 minimum clamps y");
+    }
+
+    // 12x10 is not a power of two but halves evenly twice: 6x5, 3x2 and 1x1 with odd sizes only at the end. Mip 2 is
+    // made of whole 4x4 blocks of the base, so its texels can be checked against the base directly.
+    void TestNonPowerOfTwo()
+    {
+        constexpr uint32_t width = 12;
+        constexpr uint32_t height = 10;
+        auto base = CreateBase(width, height);
+        // Shuffle the values so the extremes of a block are not always in its last corner.
+        uint32_t seed = 7;
+        for (auto& texel : base.texels)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            const auto value = static_cast<float>(seed >> 20);
+            texel = {value, -value, value * 2.f, 1.f};
+        }
+
+        const auto minimum = Swift::DownsampleReference(base, 3, Swift::ReductionType::eMinimum);
+        const auto maximum = Swift::DownsampleReference(base, 3, Swift::ReductionType::eMaximum);
+        const auto average = Swift::DownsampleReference(base, 3, Swift::ReductionType::eStandard);
+        Check(HasSizes(maximum, {{6, 5}, {3, 2}, {1, 1}}), "12x10 mip sizes");
+
+        bool blocks_match = true;
+        for (uint32_t y = 0; y < 2; ++y)
+        {
+            for (uint32_t x = 0; x < 3; ++x)
+            {
+                float block_min = base.texels[y * 4 * width + x * 4].x;
+                float block_max = block_min;
+                float block_sum = 0.f;
+                for (uint32_t by = y * 4; by < y * 4 + 4; ++by)
+                {
+                    for (uint32_t bx = x * 4; bx < x * 4 + 4; ++bx)
+                    {
+                        const float value = base.texels[by * width + bx].x;
+                        block_min = std::min(block_min, value);
+                        block_max = std::max(block_max, value);
+                        block_sum += value;
+                    }
+                }
+                // Values stay below 4096, so the sums of the average are exact in float.
+                blocks_match = blocks_match && minimum[1].texels[y * 3 + x].x == block_min &&
+                               maximum[1].texels[y * 3 + x].x == block_max &&
+                               average[1].texels[y * 3 + x].x == block_sum / 16.f &&
+                               maximum[1].texels[y * 3 + x].y == -block_min;
+            }
+        }
+        Check(blocks_match, "12x10 mip 2 matches the 4x4 blocks of the base");
+
+        const auto& top = maximum[1].texels;
+        const float top_left = std::max({top[0].x, top[1].x, top[3].x, top[4].x});
+        Check(maximum[2].texels[0].x == top_left, "12x10 mip 3 reduces the first 2x2 texels of mip 2");
+    }
+}  // namespace
+
+int main()
+{
+    TestOddSize();
+    TestEdgeClamp();
+    TestNonPowerOfTwo();
+    if (g_failures > 0)
+    {
+        printf(std::format("{} checks failed\n", g_failures).c_str());
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include "swift_fence.hpp"
+#include "array"
+#include "atomic"
+#include "chrono"
+#include "cstdint"
+#include "cstdio"
+#include "format"
+#include "thread"
+#include "vector"
+
+namespace
+{
+    int g_failures = 0;
+
+    void Check(const bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            printf(std::format("FAILED: {}\n", what).c_str());
+            g_failures++;
+        }
+    }
+
+    using namespace std::chrono_literals;
+
+    // Long enough that a waiter released by another thread never trips it, so a failure shows up as a check and not
+    // as a hung test.
+    constexpr auto k_safety_timeout = 5000ms;
+    constexpr auto k_short_timeout = 20ms;
+
+    std::chrono::milliseconds GetElapsed(const std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    }
+
+    void TestSignalOrdering()
+    {
+        Swift::CpuFence fence(3);
+        Check(fence.GetFence() == nullptr, "a CPU fence has no API object");
+        Check(fence.GetCompletedValue() == 3, "the initial value is completed");
+        Check(fence.IsComplete(3) && !fence.IsComplete(4), "IsComplete compares with the completed value");
+
+        fence.Signal(7);
+        Check(fence.GetCompletedValue() == 7, "Signal raises the value");
+        fence.Signal(5);
+        Check(fence.GetCompletedValue() == 7, "a lower signal never moves the timeline back");
+        Check(fence.Wait(6, 0ms) && fence.Wait(7, 0ms), "waits on reached values return right away");
+        Check(!fence.Wait(8, 0ms), "a zero timeout does not wait for unreached values");
+    }
+
+    void TestTimeout()
+    {
+        Swift::CpuFence fence;
+        const auto start = std::chrono::steady_clock::now();
+        Check(!fence.Wait(1, k_short_timeout), "a wait on a fence nobody signals times out");
+        Check(GetElapsed(start) >= k_short_timeout, "the wait lasts until the timeout");
+
+        // The registration of the timed out wait is gone, signaling now must not leave a wake up behind that cuts the
+        // next wait of this thread short.
+        fence.Signal(1);
+        Swift::CpuFence other;
+        const auto next = std::chrono::steady_clock::now();
+        Check(!other.Wait(1, k_short_timeout) && GetElapsed(next) >= k_short_timeout,
+              "a stale signal does not end a later wait early");
+    }
+
+    // The waiter sees every value in order and never one that has not been signaled yet.
+    void TestSignalFromThread()
+    {
+        constexpr uint64_t count = 200;
+        Swift::CpuFence fence;
+        std::atomic<uint64_t> signaled = 0;
+        std::thread signaler(
+            [&]
+            {
+                for (uint64_t value = 1; value <= count; ++value)
+                {
+                    signaled.store(value, std::memory_order_release);
+                    fence.Signal(value);
+                }
+            });
+
+        bool in_order = true;
+        uint64_t previous = 0;
+        for (uint64_t value = 1; value <= count; ++value)
+        {
+            in_order = in_order && fence.Wait(value, k_safety_timeout);
+            const uint64_t completed = fence.GetCompletedValue();
+            in_order = in_order && completed >= value && completed >= previous &&
+                       completed <= signaled.load(std::memory_order_acquire);
+            previous = completed;
+        }
+        signaler.join();
+        Check(in_order, "waits on increasing values complete in signal order");
+        Check(fence.GetCompletedValue() == count, "every signal lands");
+    }
+
+    void TestWaitForAny()
+    {
+        std::array<Swift::CpuFence, 3> fences;
+        const std::array<Swift::FenceWait, 3> waits = {{{&fences[0], 1}, {&fences[1], 2}, {&fences[2], 3}}};
+
+        Check(!Swift::WaitForAnyFence(waits, k_short_timeout), "no completed fence times out");
+
+        fences[1].Signal(1);
+        Check(!Swift::WaitForAnyFence(waits, k_short_timeout), "a fence below its wait value does not count");
+
+        std::thread signaler(
+            [&]
+            {
+                std::this_thread::sleep_for(k_short_timeout);
+                fences[2].Signal(3);
+            });
+        const auto completed = Swift::WaitForAnyFence(waits, k_safety_timeout);
+        signaler.join();
+        Check(completed == 2u, "the fence signaled from another thread ends the wait");
+
+        fences[0].Signal(1);
+        Check(Swift::WaitForAnyFence(waits, 0ms) == 0u, "an already completed wait is returned right away");
+    }
+
+    void TestWaitForAll()
+    {
+        std::array<Swift::CpuFence, 3> fences;
+        const std::array<Swift::FenceWait, 3> waits = {{{&fences[0], 1}, {&fences[1], 1}, {&fences[2], 1}}};
+
+        fences[0].Signal(1);
+        fences[2].Signal(1);
+        Check(!Swift::WaitForAllFences(waits, k_short_timeout), "one pending fence keeps the wait from finishing");
+
+        std::thread signaler(
+            [&]
+            {
+                std::this_thread::sleep_for(k_short_timeout);
+                fences[1].Signal(1);
+            });
+        Check(Swift::WaitForAllFences(waits, k_safety_timeout), "the wait finishes once the last fence is signaled");
+        signaler.join();
+    }
+}  // namespace
+
+int main()
+{
+    TestSignalOrdering();
+    TestTimeout();
+    TestSignalFromThread();
+    TestWaitForAny();
+    TestWaitForAll();
+    if (g_failures > 0)
+    {
+        printf(std::format("{} checks failed\n", g_failures).c_str());
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
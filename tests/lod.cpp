@@ -0,0 +1,287 @@
+#include "lod.hpp"
+#include "array"
+#include "cmath"
+#include "cstdint"
+#include "cstdio"
+#include "format"
+#include "limits"
+#include "vector"
+#include "glm/trigonometric.hpp"
+#include "glm/vec4.hpp"
+
+namespace
+{
+    int g_failures = 0;
+
+    void Check(const bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            printf(std::format("FAILED: {}\n", what).c_str());
+            g_failures++;
+        }
+    }
+
+    glm::mat4 CreateTransform(const float scale, const glm::vec3& translation)
+    {
+        glm::mat4 transform(scale);
+        transform[3] = glm::vec4(translation, 1.f);
+        return transform;
+    }
+
+    // Distance from the center at which a level of the given error starts to fit, for a unit sphere.
+    float GetSwitchDistance(const float error, const float scale, const float projection_scale, const float max_pixel_error)
+    {
+        return scale + error * scale * projection_scale / max_pixel_error;
+    }
+
+    void TestSelectLod()
+    {
+        Check(std::abs(GetLodProjectionScale(glm::radians(90.f), 1000.f) - 500.f) < 1e-3f,
+              "a 90 degree view spans the viewport over twice the distance");
+
+        const std::array<MeshLod, 4> lods = {{{0, 64, 0.f}, {64, 32, 0.01f}, {96, 16, 0.1f}, {112, 8, 1.f}}};
+        const float projection_scale = GetLodProjectionScale(1.f, 1080.f);
+        const glm::vec3 center(0.f);
+        const auto select = [&](const glm::mat4& transform, const float distance, const float max_pixel_error)
+        {
+            const glm::vec3 camera(transform * glm::vec4(0.f, 0.f, 0.f, 1.f));
+            return SelectLod(lods,
+                             center,
+                             1.f,
+                             transform,
+                             camera + glm::vec3(0.f, 0.f, distance),
+                             projection_scale,
+                             max_pixel_error);
+        };
+
+        bool thresholds = true;
+        for (const float scale : {1.f, 2.f})
+        {
+            const glm::mat4 transform = CreateTransform(scale, glm::vec3(3.f, -2.f, 1.f));
+            for (const float max_pixel_error : {1.f, 4.f})
+            {
+                for (uint32_t lod = 1; lod < lods.size(); ++lod)
+                {
+                    const float distance =
+                        GetSwitchDistance(lods[lod].error, scale, projection_scale, max_pixel_error);
+                    thresholds = thresholds && select(transform, distance * 0.99f, max_pixel_error) == lod - 1 &&
+                                 select(transform, distance * 1.01f, max_pixel_error) == lod;
+                }
+            }
+        }
+        Check(thresholds, "each level is picked once its error projects within the pixel threshold");
+
+        const glm::mat4 identity(1.f);
+        Check(select(identity, 1e7f, 1.f) == lods.size() - 1, "far away meshes clamp to the coarsest level");
+        Check(select(identity, 0.5f, 1.f) == 0, "a camera inside the sphere keeps the full detail");
+        const glm::vec3 far_camera(0.f, 0.f, 1e7f);
+        const auto full_detail = std::span<const MeshLod>(lods).first(1);
+        Check(SelectLod(full_detail, center, 1.f, identity, far_camera, projection_scale) == 0,
+              "a mesh without simplified levels always draws level 0");
+        Check(SelectLod({}, center, 1.f, identity, far_camera, projection_scale) == 0, "no levels selects level 0");
+    }
+
+    constexpr float k_no_parent = std::numeric_limits<float>::infinity();
+
+    // Four leaves in a row along x, merged in pairs into groups a and b, which are merged into one root. Every
+    // simplified group is a single cluster and halves nothing, only the bounds and errors matter to the cut.
+    //   0, 1 -> 4 (a)    2, 3 -> 5 (b)    4, 5 -> 6 (root)
+    std::vector<ClusterLod> CreateHierarchy()
+    {
+        const glm::vec3 a_center(-2.f, 0.f, 0.f);
+        const glm::vec3 b_center(2.f, 0.f, 0.f);
+        const glm::vec3 root_center(0.f, 0.f, 0.f);
+        const auto leaf = [](const float x, const glm::vec3& parent_center, const float parent_error)
+        {
+            return ClusterLod{
+                .center = glm::vec3(x, 0.f, 0.f),
+                .radius = 1.f,
+                .parent_center = parent_center,
+                .parent_radius = 2.f,
+                .error = 0.f,
+                .parent_error = parent_error,
+                .triangle_count = 100,
+                .padding = 0,
+            };
+        };
+        const auto group = [&](const glm::vec3& center, const float error)
+        {
+            return ClusterLod{
+                .center = center,
+                .radius = 2.f,
+                .parent_center = root_center,
+                .parent_radius = 4.f,
+                .error = error,
+                .parent_error = 0.5f,
+                .triangle_count = 100,
+                .padding = 0,
+            };
+        };
+        return {
+            leaf(-3.f, a_center, 0.1f),
+            leaf(-1.f, a_center, 0.1f),
+            leaf(1.f, b_center, 0.02f),
+            leaf(3.f, b_center, 0.02f),
+            group(a_center, 0.1f),
+            group(b_center, 0.02f),
+            ClusterLod{
+                .center = root_center,
+                .radius = 4.f,
+                .parent_center = root_center,
+                .parent_radius = 4.f,
+                .error = 0.5f,
+                .parent_error = k_no_parent,
+                .triangle_count = 100,
+                .padding = 0,
+            },
+        };
+    }
+
+    // Every leaf down to the root, one of each chain has to be drawn for the surface to be closed.
+    constexpr std::array<std::array<uint32_t, 3>, 4> k_chains = {{{0, 4, 6}, {1, 4, 6}, {2, 5, 6}, {3, 5, 6}}};
+
+    bool IsSelected(const std::vector<uint32_t>& selected, const uint32_t cluster)
+    {
+        for (const uint32_t index : selected)
+        {
+            if (index == cluster)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool IsCrackFree(const std::vector<uint32_t>& selected)
+    {
+        for (const auto& chain : k_chains)
+        {
+            uint32_t count = 0;
+            for (const uint32_t cluster : chain)
+            {
+                count += IsSelected(selected, cluster) ? 1 : 0;
+            }
+            if (count != 1)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Cameras near and far, in front and off to either side, under an identity and a scaled and moved transform.
+    void TestClusterCutIsCrackFree()
+    {
+        const auto clusters = CreateHierarchy();
+        const float projection_scale = GetLodProjectionScale(1.f, 1080.f);
+        const std::array transforms = {CreateTransform(1.f, glm::vec3(0.f)),
+                                       CreateTransform(2.f, glm::vec3(5.f, -1.f, 3.f))};
+        bool crack_free = true;
+        bool parents_rejected = true;
+        bool saw_leaves = false;
+        bool saw_groups = false;
+        bool saw_root = false;
+        bool saw_mixed = false;
+        for (const auto& transform : transforms)
+        {
+            for (const float x : {-40.f, -6.f, 0.f, 6.f, 40.f})
+            {
+                for (float z = 2.f; z < 20000.f; z *= 1.5f)
+                {
+                    for (const float max_pixel_error : {0.5f, 1.f, 4.f})
+                    {
+                        const glm::vec3 camera(transform * glm::vec4(x, 0.f, z, 1.f));
+                        std::vector<uint32_t> selected;
+                        const uint32_t triangles =
+                            SelectClusters(clusters, transform, camera, projection_scale, max_pixel_error, selected);
+                        crack_free = crack_free && IsCrackFree(selected) && triangles == selected.size() * 100;
+                        for (const uint32_t cluster : selected)
+                        {
+                            // The parent of a selected cluster must not fit, or the coarser level would be drawn too.
+                            std::vector<uint32_t> parent;
+                            const auto& lod = clusters[cluster];
+                            const ClusterLod parent_lod{
+                                .center = lod.parent_center,
+                                .radius = lod.parent_radius,
+                                .parent_center = lod.parent_center,
+                                .parent_radius = lod.parent_radius,
+                                .error = lod.parent_error,
+                                .parent_error = k_no_parent,
+                                .triangle_count = 0,
+                                .padding = 0,
+                            };
+                            SelectClusters(std::span(&parent_lod, 1),
+                                           transform,
+                                           camera,
+                                           projection_scale,
+                                           max_pixel_error,
+                                           parent);
+                            parents_rejected = parents_rejected && parent.empty();
+                        }
+                        saw_leaves = saw_leaves || IsSelected(selected, 0);
+                        saw_groups = saw_groups || IsSelected(selected, 4);
+                        saw_root = saw_root || IsSelected(selected, 6);
+                        saw_mixed = saw_mixed || (IsSelected(selected, 0) && IsSelected(selected, 5));
+                    }
+                }
+            }
+        }
+        Check(crack_free, "every leaf is covered by exactly one selected cluster");
+        Check(parents_rejected, "a cluster is selected only when its parent is rejected");
+        Check(saw_leaves && saw_groups && saw_root, "the cut reaches every level");
+        // Group b simplified with the smaller error, so some view keeps the leaves of a while b is already replaced.
+        Check(saw_mixed, "neighbouring groups are cut at different levels");
+    }
+
+    void TestClusterBudget()
+    {
+        const auto clusters = CreateHierarchy();
+        const float projection_scale = GetLodProjectionScale(1.f, 1080.f);
+        const glm::mat4 transform(1.f);
+        const glm::vec3 camera(0.f, 0.f, 30.f);
+
+        std::vector<uint32_t> selected;
+        const float full_error = SelectClustersForBudget(clusters, transform, camera, projection_scale, 400, selected);
+        Check(selected.size() == 4 && IsSelected(selected, 0) && IsSelected(selected, 3),
+              "a budget of every leaf draws the full detail");
+        Check(full_error == 1.f / 16.f, "the full detail is reported at the smallest threshold");
+
+        uint32_t previous = 400;
+        bool within_budget = true;
+        bool monotonic = true;
+        bool consistent = true;
+        for (const uint32_t budget : {399u, 300u, 250u, 200u, 150u, 100u})
+        {
+            selected.clear();
+            const float max_pixel_error =
+                SelectClustersForBudget(clusters, transform, camera, projection_scale, budget, selected);
+            const uint32_t triangles = static_cast<uint32_t>(selected.size()) * 100;
+            within_budget = within_budget && triangles <= budget;
+            monotonic = monotonic && triangles <= previous;
+            previous = triangles;
+            std::vector<uint32_t> again;
+            consistent = consistent && IsCrackFree(selected) &&
+                         SelectClusters(clusters, transform, camera, projection_scale, max_pixel_error, again) ==
+                             triangles &&
+                         again == selected;
+        }
+        Check(within_budget, "the cut stays within the triangle budget");
+        Check(monotonic, "a smaller budget never draws more triangles");
+        Check(consistent, "the returned threshold selects the same crack free cut");
+    }
+}  // namespace
+
+int main()
+{
+    TestSelectLod();
+    TestClusterCutIsCrackFree();
+    TestClusterBudget();
+    if (g_failures > 0)
+    {
+        printf(std::format("{} checks failed\n", g_failures).c_str());
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,247 @@
+#include "meshlet_culling.hpp"
+#include "algorithm"
+#include "cmath"
+#include "cstdint"
+#include "cstdio"
+#include "format"
+#include "vector"
+#include "glm/ext/matrix_clip_space.hpp"
+
+namespace
+{
+    int g_failures = 0;
+
+    void Check(const bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            printf(std::format("FAILED: {}\n", what).c_str());
+            g_failures++;
+        }
+    }
+
+    // Signed bytes like Importer::PackCone stores meshoptimizer's cone, a cutoff of 1 never culls.
+    uint32_t PackCone(const glm::vec3& axis, const float cutoff)
+    {
+        const auto pack = [](const float value, const uint32_t shift)
+        { return uint32_t(uint8_t(int8_t(std::lround(value * 127.f)))) << shift; };
+        return pack(axis.x, 0) | pack(axis.y, 8) | pack(axis.z, 16) | pack(cutoff, 24);
+    }
+
+    CullData CreateCullData(const glm::vec3& center, const float radius, const glm::vec3& axis, const float cutoff)
+    {
+        return CullData{.center = center, .radius = radius, .cone_apex = center, .cone_packed = PackCone(axis, cutoff)};
+    }
+
+    // A mesh with a single level that covers every meshlet of cull_datas.
+    MeshletCullMesh CreateMesh(const std::vector<CullData>& cull_datas)
+    {
+        MeshletCullMesh mesh{
+            .constants = {},
+            .bounding_offset = 0,
+            .center = glm::vec3(0.f),
+            .radius = 1.f,
+            .lod_count = 1,
+            .lods = {},
+        };
+        mesh.lods[0] = MeshLod{.meshlet_offset = 0, .meshlet_count = static_cast<uint32_t>(cull_datas.size()), .error = 0.f};
+        return mesh;
+    }
+
+    // The camera sits at the origin and looks down -z with a 0 to 1 depth range, like Camera.
+    MeshletCullView CreateView(const EnumFlags<MeshletCullFlags> flags)
+    {
+        return MeshletCullView{
+            .view_proj = glm::perspectiveRH_ZO(1.2f, 1.f, 0.1f, 100.f),
+            .camera_position = glm::vec3(0.f),
+            .projection_scale = GetLodProjectionScale(1.2f, 720.f),
+            .max_pixel_error = 1.f,
+            .flags = flags,
+        };
+    }
+
+    glm::mat4 CreateTransform(const glm::vec3& x, const glm::vec3& y, const glm::vec3& z, const glm::vec3& translation)
+    {
+        glm::mat4 transform(1.f);
+        transform[0] = glm::vec4(x, 0.f);
+        transform[1] = glm::vec4(y, 0.f);
+        transform[2] = glm::vec4(z, 0.f);
+        transform[3] = glm::vec4(translation, 1.f);
+        return transform;
+    }
+
+    glm::mat4 CreateTranslation(const glm::vec3& translation)
+    {
+        return CreateTransform(glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f), glm::vec3(0.f, 0.f, 1.f), translation);
+    }
+
+    // Culls one instance of mesh and returns the meshlets it draws, in list order.
+    std::vector<uint32_t> CullInstance(const MeshletCullView& view,
+                                       const std::vector<CullData>& cull_datas,
+                                       const glm::mat4& transform)
+    {
+        const MeshletCullMesh mesh = CreateMesh(cull_datas);
+        const MeshletCullInstance instance{.mesh_index = 0, .instance_index = 0};
+        // Large enough that the instance test never gets in the way.
+        const InstanceCullData instance_bounds{.center = glm::vec3(0.f, 0.f, -10.f), .radius = 1000.f};
+        MeshletCullOutput output;
+        CullMeshlets(view,
+                     MeshletCullInput{
+                         .meshes = std::span(&mesh, 1),
+                         .instances = std::span(&instance, 1),
+                         .cull_datas = cull_datas,
+                         .transforms = std::span(&transform, 1),
+                         .instance_cull_datas = std::span(&instance_bounds, 1),
+                     },
+                     output);
+        return output.meshlet_list;
+    }
+
+    void TestFrustum()
+    {
+        const glm::vec3 no_cone(0.f, 0.f, 1.f);
+        const std::vector<CullData> cull_datas = {
+            CreateCullData(glm::vec3(0.f, 0.f, -10.f), 1.f, no_cone, 1.f),
+            // Behind the camera.
+            CreateCullData(glm::vec3(0.f, 0.f, 10.f), 1.f, no_cone, 1.f),
+            // Far to the left.
+            CreateCullData(glm::vec3(-100.f, 0.f, -10.f), 1.f, no_cone, 1.f),
+            // The left plane passes through it at x = -6.84.
+            CreateCullData(glm::vec3(-7.5f, 0.f, -10.f), 1.f, no_cone, 1.f),
+            // Past the far plane.
+            CreateCullData(glm::vec3(0.f, 0.f, -150.f), 1.f, no_cone, 1.f),
+        };
+        const glm::mat4 identity(1.f);
+        const auto frustum = CreateView(MeshletCullFlags::eFrustum);
+        Check(CullInstance(frustum, cull_datas, identity) == std::vector<uint32_t>{0, 3},
+              "the frustum test keeps spheres inside or crossing a plane");
+        Check(CullInstance(CreateView(MeshletCullFlags::eNone), cull_datas, identity).size() == cull_datas.size(),
+              "without the frustum test every meshlet is drawn");
+
+        // Stretched by 3 along x and moved back by 2, the spheres grow with the largest axis scale. At z = -8 the left
+        // plane is at x = -5.47, the sphere placed at x = -9 is 2.9 outside it and only reaches it with a radius of 3.
+        const glm::mat4 transform = CreateTransform(
+            glm::vec3(3.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f), glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 0.f, -2.f));
+        const std::vector<CullData> scaled = {
+            CreateCullData(glm::vec3(-2.f, 0.f, -6.f), 1.f, no_cone, 1.f),
+            CreateCullData(glm::vec3(-3.f, 0.f, -6.f), 1.f, no_cone, 1.f),
+            CreateCullData(glm::vec3(-5.f, 0.f, -6.f), 1.f, no_cone, 1.f),
+        };
+        Check(CullInstance(frustum, scaled, transform) == std::vector<uint32_t>{0, 1},
+              "the frustum test places and scales the spheres by the instance transform");
+    }
+
+    void TestInstances()
+    {
+        const std::vector<CullData> cull_datas = {
+            CreateCullData(glm::vec3(0.f, 0.f, 0.f), 1.f, glm::vec3(0.f, 0.f, 1.f), 1.f),
+            CreateCullData(glm::vec3(1.f, 0.f, 0.f), 1.f, glm::vec3(0.f, 0.f, 1.f), 1.f),
+        };
+        const MeshletCullMesh mesh = CreateMesh(cull_datas);
+        const std::vector<glm::mat4> transforms = {
+            CreateTranslation(glm::vec3(0.f, 0.f, -10.f)),
+            CreateTranslation(glm::vec3(0.f, 0.f, 50.f)),
+            CreateTranslation(glm::vec3(0.f, 0.f, -20.f)),
+        };
+        const std::vector<InstanceCullData> instance_cull_datas = {
+            {.center = glm::vec3(0.5f, 0.f, -10.f), .radius = 2.f},
+            {.center = glm::vec3(0.5f, 0.f, 50.f), .radius = 2.f},
+            {.center = glm::vec3(0.5f, 0.f, -20.f), .radius = 2.f},
+        };
+        const std::vector<MeshletCullInstance> instances = {
+            {.mesh_index = 0, .instance_index = 0},
+            {.mesh_index = 0, .instance_index = 1},
+            {.mesh_index = 0, .instance_index = 2},
+        };
+        const MeshletCullInput input{
+            .meshes = std::span(&mesh, 1),
+            .instances = instances,
+            .cull_datas = cull_datas,
+            .transforms = transforms,
+            .instance_cull_datas = instance_cull_datas,
+        };
+        MeshletCullOutput expected;
+        CullMeshlets(CreateView(MeshletCullFlags::eFrustum), input, expected);
+        Check(expected.commands.size() == 2, "an instance behind the camera gets no command");
+        const bool ranges = expected.commands.size() == 2 && expected.commands[0].constants.instance_offset == 0 &&
+                            expected.commands[1].constants.instance_offset == 2 &&
+                            expected.commands[1].constants.meshlet_offset == 2 && expected.commands[1].group_x == 2 &&
+                            expected.commands[1].group_y == 1;
+        Check(ranges,
+              "every drawn instance gets one command over its range of the list");
+        Check(GetMaxMeshletCommands(instances) == 3 && GetMaxMeshletListSize(input.meshes, instances) == 6,
+              "the buffers are sized for level 0 of every instance");
+
+        // The GPU may finish the instances in any order and leave gaps in the list.
+        std::vector<MeshletDrawCommand> commands = {expected.commands[1], expected.commands[0]};
+        commands[0].constants.meshlet_offset = 4;
+        commands[1].constants.meshlet_offset = 0;
+        std::vector<uint32_t> meshlet_list = {1, 0, 7, 7, 0, 1};
+        Check(GetMeshletCullMismatches(expected, commands, meshlet_list).empty(),
+              "the order of commands and meshlets does not count as a difference");
+        meshlet_list[5] = 0;
+        Check(GetMeshletCullMismatches(expected, commands, meshlet_list) == std::vector<uint32_t>{2},
+              "a different meshlet is reported for its instance");
+        meshlet_list[5] = 1;
+        commands[1].constants.meshlet_offset = 5;
+        Check(GetMeshletCullMismatches(expected, commands, meshlet_list) == std::vector<uint32_t>{0},
+              "a command past the end of the list is reported for its instance");
+    }
+
+    void TestCone()
+    {
+        const glm::vec3 away(0.f, 0.f, -1.f);
+        const glm::vec3 toward(0.f, 0.f, 1.f);
+        const std::vector<CullData> cull_datas = {
+            CreateCullData(glm::vec3(0.f, 0.f, -10.f), 1.f, away, 0.5f),
+            CreateCullData(glm::vec3(0.f, 0.f, -10.f), 1.f, toward, 0.5f),
+            CreateCullData(glm::vec3(0.f, 0.f, -10.f), 1.f, away, 1.f),
+        };
+        const auto cone = CreateView(MeshletCullFlags::eCone);
+        Check(CullInstance(cone, cull_datas, glm::mat4(1.f)) == std::vector<uint32_t>{1, 2},
+              "the cone test drops meshlets facing away unless their cutoff is 1");
+        Check(CullInstance(CreateView(MeshletCullFlags::eNone), cull_datas, glm::mat4(1.f)).size() == cull_datas.size(),
+              "without the cone test every meshlet is drawn");
+
+        // Turned half way around y and scaled by 2, the meshlets land at z = -10 again with their axes flipped.
+        const glm::mat4 turned = CreateTransform(
+            glm::vec3(-2.f, 0.f, 0.f), glm::vec3(0.f, 2.f, 0.f), glm::vec3(0.f, 0.f, -2.f), glm::vec3(0.f, 0.f, -30.f));
+        Check(CullInstance(cone, cull_datas, turned) == std::vector<uint32_t>{0, 2},
+              "the cone axis turns with a rotated and uniformly scaled instance");
+
+        // Stretching along z bends the normals of a meshlet by different angles, so its cone no longer bounds them.
+        const glm::mat4 stretched = CreateTransform(
+            glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f), glm::vec3(0.f, 0.f, 4.f), glm::vec3(0.f));
+        Check(CullInstance(cone, cull_datas, stretched).size() == cull_datas.size(),
+              "non-uniformly scaled instances skip the cone test");
+        const glm::mat4 sheared = CreateTransform(
+            glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f), glm::vec3(1.f, 0.f, 1.f), glm::vec3(0.f));
+        Check(CullInstance(cone, cull_datas, sheared).size() == cull_datas.size(), "sheared instances skip the cone test");
+    }
+
+    void TestConstants()
+    {
+        const auto constants =
+            GetMeshletCullConstants(CreateView(EnumFlags(MeshletCullFlags::eFrustum) | MeshletCullFlags::eCone));
+        Check(constants.flags == 3, "the flags are passed on to the shader");
+        const glm::vec4& near_plane = constants.frustum_planes[4];
+        Check(std::abs(near_plane.z + 1.f) < 1e-5f && std::abs(near_plane.w + 0.1f) < 1e-5f,
+              "the near plane faces down the view direction at the near distance");
+        Check(sizeof(MeshletCullConstants) % 16 == 0, "the constants fill whole 16 byte rows");
+    }
+}  // namespace
+
+int main()
+{
+    TestFrustum();
+    TestInstances();
+    TestCone();
+    TestConstants();
+    if (g_failures > 0)
+    {
+        printf(std::format("{} checks failed\n", g_failures).c_str());
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}